@@ -5,10 +5,19 @@
 #define XR_USE_GRAPHICS_API_D3D11
 
 #include "d3d.h"
+#include "constant_ring.h"
+#include "shader_cache.h"
+#include "stereo_layout.h"
+#include "env_var.h"
 #include <dxgi.h>
 #include <dxgi1_2.h>
+#include <d3d11_3.h> // D3D11_FEATURE_DATA_D3D11_OPTIONS3
 #include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
 
 using namespace DirectX;
 
@@ -16,6 +25,48 @@ using namespace DirectX;
 ID3D11Device* d3d_device = nullptr;
 ID3D11DeviceContext* d3d_context = nullptr;
 int64_t              d3d_swapchain_fmt = DXGI_FORMAT_R8G8B8A8_UNORM;
+StateFilter<ID3D11DeviceContext> d3d_state;
+
+// Late-latch constants (b2)
+struct d3d_latch_cb_t {
+	XMFLOAT4X4 hand_world[2];
+	XMFLOAT4   hand_valid;
+};
+static ID3D11Buffer* d3d_latch_cb = nullptr;
+
+// Per-view constants (b1): the blocks of the views drawn by the current pass
+struct d3d_view_cb_t {
+	d3d_view_block_t views[2];
+	uint32_t         view_count;
+	uint32_t         pad[3];
+};
+static ID3D11Buffer*   d3d_view_cb = nullptr;
+static d3d_view_cb_t   d3d_view_data = {};
+static d3d_view_block_t d3d_view_blocks[2] = {};
+bool                   d3d_single_pass_supported = false;
+uint32_t               d3d_view_count = 1;
+
+// GPU time of a frame's passes: timestamp queries, read back a few frames later without stalling
+struct d3d_gpu_timer_t {
+	ID3D11Query* disjoint;
+	ID3D11Query* begin;
+	ID3D11Query* end;
+	bool         pending;
+};
+static const uint32_t d3d_gpu_timer_count = 4;
+static d3d_gpu_timer_t d3d_gpu_timers[d3d_gpu_timer_count] = {};
+static uint32_t        d3d_gpu_timer_next = 0;
+
+// Per-draw and per-pass constants: suballocated from one dynamic buffer and bound by offset
+// (D3D11.1), instead of an UpdateSubresource into each module's own buffer for every draw
+static const uint32_t        d3d_const_ring_size = 256 * 1024;
+static ID3D11DeviceContext1* d3d_context1 = nullptr;
+static ID3D11Buffer*         d3d_const_ring = nullptr;
+static ConstantRing          d3d_const_ring_alloc;
+
+// Shaders compiled at run time (the fallback, see d3d_load_shader), cached under %LOCALAPPDATA%
+// so only the first injection pays for D3DCompile
+static ShaderCache d3d_shader_cache;
 
 bool d3d_init(LUID& adapter_luid) {
 	IDXGIAdapter1* adapter = d3d_get_adapter(adapter_luid);
@@ -29,6 +80,40 @@ bool d3d_init(LUID& adapter_luid) {
 		return false;
 
 	adapter->Release();
+	d3d_state.SetContext(d3d_context);
+
+	const std::string local = env_var("LOCALAPPDATA");
+	if (!local.empty())
+		d3d_shader_cache.SetDirectory(local + "\\VirtualExtent\\shaders");
+	d3d_shader_cache.SetCompilerId("d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION));
+
+	// Writing SV_RenderTargetArrayIndex from a vertex shader is what makes single-pass stereo cheap
+	D3D11_FEATURE_DATA_D3D11_OPTIONS3 options3 = {};
+	d3d_single_pass_supported =
+		SUCCEEDED(d3d_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS3, &options3, sizeof(options3))) &&
+		options3.VPAndRTArrayIndexFromAnyShaderFeedingRasterizer;
+
+	D3D11_BUFFER_DESC view_desc = CD3D11_BUFFER_DESC(sizeof(d3d_view_cb_t), D3D11_BIND_CONSTANT_BUFFER);
+	if (FAILED(d3d_device->CreateBuffer(&view_desc, nullptr, &d3d_view_cb)))
+		return false;
+
+	// Without offsets or NO_OVERWRITE on constant buffers, d3d_set_constants falls back to the
+	// caller's own buffer
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (SUCCEEDED(d3d_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer &&
+		SUCCEEDED(d3d_context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&d3d_context1))) {
+		D3D11_BUFFER_DESC ring_desc = CD3D11_BUFFER_DESC(d3d_const_ring_size, D3D11_BIND_CONSTANT_BUFFER,
+			D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+		if (SUCCEEDED(d3d_device->CreateBuffer(&ring_desc, nullptr, &d3d_const_ring))) {
+			d3d_const_ring_alloc.Init(d3d_const_ring_size);
+		} else {
+			d3d_context1->Release();
+			d3d_context1 = nullptr;
+		}
+	}
+	if (!d3d_const_ring)
+		OutputDebugStringA("D3D: constant buffer offsets unavailable, using UpdateSubresource\n");
 	return true;
 }
 
@@ -56,23 +141,43 @@ IDXGIAdapter1* d3d_get_adapter(LUID& adapter_luid) {
 }
 
 void d3d_shutdown() {
+	for (d3d_gpu_timer_t& t : d3d_gpu_timers) {
+		if (t.disjoint) t.disjoint->Release();
+		if (t.begin) t.begin->Release();
+		if (t.end) t.end->Release();
+		t = {};
+	}
+	d3d_gpu_timer_next = 0;
+	if (const ShaderCache::Stats& stats = d3d_shader_cache.GetStats(); stats.hits + stats.misses > 0) {
+		char msg[128];
+		snprintf(msg, sizeof(msg), "D3D: shader cache %llu hits, %llu compiled, %llu invalid\n",
+			(unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.invalid);
+		OutputDebugStringA(msg);
+	}
+	if (d3d_const_ring) {
+		char msg[128];
+		snprintf(msg, sizeof(msg), "D3D: constant ring %llu allocations, %llu wraps\n",
+			(unsigned long long)d3d_const_ring_alloc.Allocs(), (unsigned long long)d3d_const_ring_alloc.Wraps());
+		OutputDebugStringA(msg);
+		d3d_const_ring->Release();
+		d3d_const_ring = nullptr;
+	}
+	if (d3d_context1) { d3d_context1->Release(); d3d_context1 = nullptr; }
+	if (d3d_latch_cb) { d3d_latch_cb->Release(); d3d_latch_cb = nullptr; }
+	if (d3d_view_cb) { d3d_view_cb->Release(); d3d_view_cb = nullptr; }
 	if (d3d_context) { d3d_context->Release(); d3d_context = nullptr; }
 	if (d3d_device) { d3d_device->Release();  d3d_device = nullptr; }
 }
 
-swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchain_img) {
-	swapchain_surfdata_t result = {};
+bool d3d_depth_required = true; // until ve_run has asked the modules
 
+ID3D11DepthStencilView* d3d_make_depth(XrBaseInStructure& swapchain_img) {
 	XrSwapchainImageD3D11KHR& d3d_swapchain_img = (XrSwapchainImageD3D11KHR&)swapchain_img;
 	D3D11_TEXTURE2D_DESC      color_desc;
 	d3d_swapchain_img.texture->GetDesc(&color_desc);
+	const bool is_array = color_desc.ArraySize > 1;
 
-	D3D11_RENDER_TARGET_VIEW_DESC target_desc = {};
-	target_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	target_desc.Format = (DXGI_FORMAT)d3d_swapchain_fmt;
-	d3d_device->CreateRenderTargetView(d3d_swapchain_img.texture, &target_desc, &result.target_view);
-
-	ID3D11Texture2D* depth_texture;
+	ID3D11Texture2D* depth_texture = nullptr;
 	D3D11_TEXTURE2D_DESC depth_desc = {};
 	depth_desc.SampleDesc.Count = 1;
 	depth_desc.MipLevels = 1;
@@ -81,36 +186,240 @@ swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchain_img) {
 	depth_desc.ArraySize = color_desc.ArraySize;
 	depth_desc.Format = DXGI_FORMAT_R32_TYPELESS;
 	depth_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_DEPTH_STENCIL;
-	d3d_device->CreateTexture2D(&depth_desc, nullptr, &depth_texture);
+	if (FAILED(d3d_device->CreateTexture2D(&depth_desc, nullptr, &depth_texture)))
+		return nullptr;
 
+	ID3D11DepthStencilView* depth_view = nullptr;
 	D3D11_DEPTH_STENCIL_VIEW_DESC stencil_desc = {};
-	stencil_desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	stencil_desc.ViewDimension = is_array ? D3D11_DSV_DIMENSION_TEXTURE2DARRAY : D3D11_DSV_DIMENSION_TEXTURE2D;
 	stencil_desc.Format = DXGI_FORMAT_D32_FLOAT;
-	d3d_device->CreateDepthStencilView(depth_texture, &stencil_desc, &result.depth_view);
+	if (is_array) stencil_desc.Texture2DArray.ArraySize = color_desc.ArraySize;
+	d3d_device->CreateDepthStencilView(depth_texture, &stencil_desc, &depth_view);
 
 	depth_texture->Release();
+	return depth_view;
+}
+
+swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchain_img, ID3D11DepthStencilView* depth_view) {
+	swapchain_surfdata_t result = {};
+
+	XrSwapchainImageD3D11KHR& d3d_swapchain_img = (XrSwapchainImageD3D11KHR&)swapchain_img;
+	D3D11_TEXTURE2D_DESC      color_desc;
+	d3d_swapchain_img.texture->GetDesc(&color_desc);
+
+	// Array images (single-pass stereo) get views over all slices
+	const bool is_array = color_desc.ArraySize > 1;
+
+	D3D11_RENDER_TARGET_VIEW_DESC target_desc = {};
+	target_desc.ViewDimension = is_array ? D3D11_RTV_DIMENSION_TEXTURE2DARRAY : D3D11_RTV_DIMENSION_TEXTURE2D;
+	target_desc.Format = (DXGI_FORMAT)d3d_swapchain_fmt;
+	if (is_array) target_desc.Texture2DArray.ArraySize = color_desc.ArraySize;
+	d3d_device->CreateRenderTargetView(d3d_swapchain_img.texture, &target_desc, &result.target_view);
+
+	// Images are rendered one at a time, so they can all share the swapchain's depth buffer
+	result.depth_view = depth_view;
+	if (result.depth_view) result.depth_view->AddRef();
 
 	return result;
 }
 
-void d3d_render_layer(XrCompositionLayerProjectionView& view, swapchain_surfdata_t& surface) {
-	XrRect2Di& rect = view.subImage.imageRect;
+void d3d_prepare_view(uint32_t index, const XrCompositionLayerProjectionView& view) {
+	if (index >= _countof(d3d_view_blocks))
+		return;
+	d3d_view_block_t& block = d3d_view_blocks[index];
+
+	XMMATRIX camera = XMMatrixAffineTransformation(
+		DirectX::g_XMOne, DirectX::g_XMZero,
+		XMLoadFloat4((XMFLOAT4*)&view.pose.orientation),
+		XMLoadFloat3((XMFLOAT3*)&view.pose.position));
+	XMMATRIX view_mat = XMMatrixInverse(nullptr, camera);
+	XMMATRIX proj = d3d_xr_projection(view.fov, 0.05f, 100.0f);
+	XMMATRIX viewproj = view_mat * proj;
+	XMStoreFloat4x4(&block.view, XMMatrixTranspose(view_mat));
+	XMStoreFloat4x4(&block.proj, XMMatrixTranspose(proj));
+	XMStoreFloat4x4(&block.viewproj, XMMatrixTranspose(viewproj));
+	block.cam_pos = XMFLOAT4(view.pose.position.x, view.pose.position.y, view.pose.position.z, 1);
+
+	// World-space planes from the columns of viewproj (row vectors, depth 0..1), pointing inwards:
+	// left, right, bottom, top, near, far
+	XMMATRIX cols = XMMatrixTranspose(viewproj);
+	XMVECTOR planes[6] = {
+		cols.r[3] + cols.r[0], cols.r[3] - cols.r[0],
+		cols.r[3] + cols.r[1], cols.r[3] - cols.r[1],
+		cols.r[2],             cols.r[3] - cols.r[2],
+	};
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&block.frustum[i], XMPlaneNormalize(planes[i]));
+}
+
+// Uploads the blocks of the views drawn by this pass (b1), prepared by d3d_prepare_view
+static void d3d_set_views(uint32_t first, uint32_t view_count) {
+	d3d_view_data = {};
+	for (uint32_t i = 0; i < view_count && i < 2 && first + i < _countof(d3d_view_blocks); i++)
+		d3d_view_data.views[i] = d3d_view_blocks[first + i];
+	d3d_view_data.view_count = view_count;
+	d3d_view_count = view_count;
+
+	// Through the ring like every other constant upload; d3d_view_cb is only its fallback
+	d3d_set_constants(d3d_view_cb, &d3d_view_data, sizeof(d3d_view_data), d3d_view_slot, d3d_stage_vs | d3d_stage_ps);
+}
+
+bool d3d_sphere_visible(const XMFLOAT3& center, float radius) {
+	XMVECTOR c = XMVectorSetW(XMLoadFloat3(&center), 1.0f);
+	for (uint32_t v = 0; v < d3d_view_data.view_count && v < 2; v++) {
+		bool inside = true;
+		for (int i = 0; i < 6 && inside; i++)
+			inside = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&d3d_view_data.views[v].frustum[i]), c)) >= -radius;
+		if (inside)
+			return true;
+	}
+	return false;
+}
+
+// Appens draw-funktion ligger kvar i main.cpp, och kallas frn openxr.cpp via d3d_render_layer->app_draw dr.
+extern void app_draw(const XrCompositionLayerProjectionView* views, uint32_t view_count);
+
+static void d3d_begin_pass(const XrCompositionLayerProjectionView& view, swapchain_surfdata_t& surface) {
+	// Swapchain acquire/release and the quad copy run between passes and may touch the context
+	d3d_state.Invalidate();
+
+	const XrRect2Di& rect = view.subImage.imageRect;
 	D3D11_VIEWPORT viewport = CD3D11_VIEWPORT((float)rect.offset.x, (float)rect.offset.y, (float)rect.extent.width, (float)rect.extent.height);
 	d3d_context->RSSetViewports(1, &viewport);
 
-	float clear[] = { 0, 0, 0, 1 };
+	// Transparent where nothing is drawn when the desktop is composited underneath as a quad layer
+	float clear[] = { 0, 0, 0, xr_quad_layer_mode ? 0.0f : 1.0f };
 	d3d_context->ClearRenderTargetView(surface.target_view, clear);
-	d3d_context->ClearDepthStencilView(surface.depth_view, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	if (surface.depth_view)
+		d3d_context->ClearDepthStencilView(surface.depth_view, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 	d3d_context->OMSetRenderTargets(1, &surface.target_view, surface.depth_view);
+}
+
+void d3d_render_layer(uint32_t view_index, XrCompositionLayerProjectionView& view, swapchain_surfdata_t& surface) {
+	d3d_begin_pass(view, surface);
+	d3d_set_views(view_index, 1);
+	app_draw(&view, 1);
+}
+
+// Both eyes in one pass: surface views cover every slice, all views share the same image rect
+void d3d_render_layer_stereo(XrCompositionLayerProjectionView* views, uint32_t view_count, swapchain_surfdata_t& surface) {
+	d3d_begin_pass(views[0], surface);
+	d3d_set_views(0, view_count);
+	app_draw(views, view_count);
+}
+
+void d3d_draw_indexed(UINT index_count) {
+	if (d3d_view_count > 1)
+		d3d_context->DrawIndexedInstanced(index_count, StereoDrawInstances(1, d3d_view_count), 0, 0, 0);
+	else
+		d3d_context->DrawIndexed(index_count, 0, 0);
+}
+
+void d3d_draw_indexed_instanced(UINT index_count, UINT instance_count) {
+	d3d_context->DrawIndexedInstanced(index_count, StereoDrawInstances(instance_count, d3d_view_count), 0, 0, 0);
+}
+
+void d3d_set_constants(ID3D11Buffer* fallback, const void* data, UINT bytes, UINT slot, UINT stages) {
+	uint32_t offset, size;
+	bool     discard;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (d3d_const_ring && d3d_const_ring_alloc.Alloc(bytes, &offset, &size, &discard) &&
+		SUCCEEDED(d3d_context->Map(d3d_const_ring, 0, discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped))) {
+		memcpy((uint8_t*)mapped.pData + offset, data, bytes);
+		d3d_context->Unmap(d3d_const_ring, 0);
+
+		// Offsets and sizes are in 16-byte constants
+		UINT first = offset / 16;
+		UINT count = size / 16;
+		if ((stages & d3d_stage_vs) && d3d_state.VSConstantsChanged(slot, d3d_const_ring, first))
+			d3d_context1->VSSetConstantBuffers1(slot, 1, &d3d_const_ring, &first, &count);
+		if ((stages & d3d_stage_ps) && d3d_state.PSConstantsChanged(slot, d3d_const_ring, first))
+			d3d_context1->PSSetConstantBuffers1(slot, 1, &d3d_const_ring, &first, &count);
+		return;
+	}
+
+	d3d_context->UpdateSubresource(fallback, 0, nullptr, data, 0, 0);
+	if ((stages & d3d_stage_vs) && d3d_state.VSConstantsChanged(slot, fallback, 0))
+		d3d_context->VSSetConstantBuffers(slot, 1, &fallback);
+	if ((stages & d3d_stage_ps) && d3d_state.PSConstantsChanged(slot, fallback, 0))
+		d3d_context->PSSetConstantBuffers(slot, 1, &fallback);
+}
+
+void d3d_latch_poses(const XrPosef hand_pose[2], const XrBool32 hand_valid[2]) {
+	if (!d3d_latch_cb) {
+		D3D11_BUFFER_DESC desc = CD3D11_BUFFER_DESC(sizeof(d3d_latch_cb_t), D3D11_BIND_CONSTANT_BUFFER);
+		if (FAILED(d3d_device->CreateBuffer(&desc, nullptr, &d3d_latch_cb)))
+			return;
+	}
+
+	d3d_latch_cb_t cb = {};
+	for (int i = 0; i < 2; i++) {
+		XMMATRIX world = XMMatrixRotationQuaternion(XMLoadFloat4((XMFLOAT4*)&hand_pose[i].orientation)) *
+		                 XMMatrixTranslationFromVector(XMLoadFloat3((XMFLOAT3*)&hand_pose[i].position));
+		XMStoreFloat4x4(&cb.hand_world[i], XMMatrixTranspose(world));
+	}
+	cb.hand_valid = XMFLOAT4(hand_valid[0] ? 1.0f : 0.0f, hand_valid[1] ? 1.0f : 0.0f, 0, 0);
+
+	d3d_set_constants(d3d_latch_cb, &cb, sizeof(cb), d3d_latch_slot, d3d_stage_vs | d3d_stage_ps);
+}
+
+void d3d_state_frame_begin() {
+	d3d_state.EndFrame();
+}
 
-	// Appens draw-funktion ligger kvar i main.cpp, och kallas frn openxr.cpp via d3d_render_layer->app_draw dr.
-	extern void app_draw(XrCompositionLayerProjectionView & layerView);
-	app_draw(view);
+void d3d_gpu_timer_begin() {
+	d3d_gpu_timer_t& t = d3d_gpu_timers[d3d_gpu_timer_next];
+	if (t.pending) // not read back yet; skip this frame rather than wait for it
+		return;
+	if (!t.disjoint) {
+		D3D11_QUERY_DESC disjoint_desc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		D3D11_QUERY_DESC stamp_desc = { D3D11_QUERY_TIMESTAMP, 0 };
+		if (FAILED(d3d_device->CreateQuery(&disjoint_desc, &t.disjoint)) ||
+			FAILED(d3d_device->CreateQuery(&stamp_desc, &t.begin)) ||
+			FAILED(d3d_device->CreateQuery(&stamp_desc, &t.end)))
+			return;
+	}
+	d3d_context->Begin(t.disjoint);
+	d3d_context->End(t.begin);
+}
+
+void d3d_gpu_timer_end() {
+	d3d_gpu_timer_t& t = d3d_gpu_timers[d3d_gpu_timer_next];
+	if (t.pending || !t.end)
+		return;
+	d3d_context->End(t.end);
+	d3d_context->End(t.disjoint);
+	t.pending = true;
+	d3d_gpu_timer_next = (d3d_gpu_timer_next + 1) % d3d_gpu_timer_count;
+}
+
+bool d3d_gpu_timer_read(uint64_t* out_ns) {
+	// Oldest first: the slot about to be reused is the oldest one in flight
+	bool found = false;
+	for (uint32_t i = 0; i < d3d_gpu_timer_count; i++) {
+		d3d_gpu_timer_t& t = d3d_gpu_timers[(d3d_gpu_timer_next + i) % d3d_gpu_timer_count];
+		if (!t.pending)
+			continue;
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		UINT64 begin, end;
+		if (d3d_context->GetData(t.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			d3d_context->GetData(t.begin, &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			d3d_context->GetData(t.end, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			break;
+
+		t.pending = false;
+		if (!disjoint.Disjoint && disjoint.Frequency && end > begin) {
+			*out_ns = (uint64_t)((double)(end - begin) * 1e9 / (double)disjoint.Frequency);
+			found = true;
+		}
+	}
+	return found;
 }
 
 void d3d_swapchain_destroy(swapchain_t& swapchain) {
 	for (uint32_t i = 0; i < swapchain.surface_data.size(); i++) {
-		swapchain.surface_data[i].depth_view->Release();
+		if (swapchain.surface_data[i].depth_view) swapchain.surface_data[i].depth_view->Release();
 		swapchain.surface_data[i].target_view->Release();
 	}
 }
@@ -123,7 +432,23 @@ XMMATRIX d3d_xr_projection(XrFovf fov, float clip_near, float clip_far) {
 	return XMMatrixPerspectiveOffCenterRH(left, right, down, up, clip_near, clip_far);
 }
 
-ID3DBlob* d3d_compile_shader(const char* hlsl, const char* entrypoint, const char* target) {
+// Where the fallback reads .hlsl files: VE_SHADER_DIR, else shaders\ next to the DLL
+static std::string d3d_shader_dir() {
+	std::string dir = env_var("VE_SHADER_DIR");
+	if (!dir.empty())
+		return dir;
+	HMODULE module = nullptr;
+	char path[MAX_PATH];
+	if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			(LPCSTR)(void*)&d3d_shader_dir, &module) ||
+		!GetModuleFileNameA(module, path, MAX_PATH))
+		return "shaders";
+	std::string dir = path;
+	return dir.substr(0, dir.find_last_of("\\/") + 1) + "shaders";
+}
+
+// Same options as the FxCompile step in the vcxproj
+static bool d3d_compile_shader(const d3d_shader_t& shader, std::vector<uint8_t>* bytecode) {
 	DWORD flags = D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_WARNINGS_ARE_ERRORS;
 #ifdef _DEBUG
 	flags |= D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
@@ -131,10 +456,56 @@ ID3DBlob* d3d_compile_shader(const char* hlsl, const char* entrypoint, const cha
 	flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
 
-	ID3DBlob* compiled = nullptr, * errors = nullptr;
-	if (FAILED(D3DCompile(hlsl, strlen(hlsl), nullptr, nullptr, nullptr, entrypoint, target, flags, 0, &compiled, &errors)))
-		printf("Error: D3DCompile failed %s", errors ? (char*)errors->GetBufferPointer() : "(no message)");
+	const std::string path = d3d_shader_dir() + "\\" + shader.file;
+	std::ifstream file(path, std::ios::binary);
+	const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file || source.empty()) {
+		printf("Error: no shader source %s\n", path.c_str());
+		return false;
+	}
+
+	// Preprocessed first, so the cache key covers the included files and the defines too
+	const D3D_SHADER_MACRO stereo_defines[] = { { "VE_STEREO", "1" }, { nullptr, nullptr } };
+	ID3DBlob* preprocessed = nullptr, * errors = nullptr;
+	if (FAILED(D3DPreprocess(source.data(), source.size(), path.c_str(), shader.stereo ? stereo_defines : nullptr,
+			D3D_COMPILE_STANDARD_FILE_INCLUDE, &preprocessed, &errors))) {
+		printf("Error: D3DPreprocess failed %s", errors ? (char*)errors->GetBufferPointer() : "(no message)");
+		if (errors) errors->Release();
+		return false;
+	}
 	if (errors) errors->Release();
+	const std::string text((const char*)preprocessed->GetBufferPointer(), strnlen((const char*)preprocessed->GetBufferPointer(), preprocessed->GetBufferSize()));
+	preprocessed->Release();
 
-	return compiled;
+	ShaderCache::Request request = { text.c_str(), shader.entry, shader.target, shader.stereo ? "VE_STEREO=1;" : "", flags };
+	return d3d_shader_cache.Get(request, [&path](const ShaderCache::Request& r, std::vector<uint8_t>* out) {
+		ID3DBlob* compiled = nullptr, * errors = nullptr;
+		if (FAILED(D3DCompile(r.source, strlen(r.source), path.c_str(), nullptr, nullptr, r.entry, r.target, r.flags, 0, &compiled, &errors)))
+			printf("Error: D3DCompile failed %s", errors ? (char*)errors->GetBufferPointer() : "(no message)");
+		if (errors) errors->Release();
+		if (!compiled)
+			return false;
+		const uint8_t* data = (const uint8_t*)compiled->GetBufferPointer();
+		out->assign(data, data + compiled->GetBufferSize());
+		compiled->Release();
+		return true;
+	}, bytecode);
+}
+
+ID3DBlob* d3d_load_shader(const d3d_shader_t& shader) {
+	const uint8_t* data = shader.bytecode;
+	size_t size = shader.size;
+	std::vector<uint8_t> compiled;
+	if (!data || !env_var("VE_SHADER_DIR").empty()) {
+		if (!d3d_compile_shader(shader, &compiled))
+			return nullptr;
+		data = compiled.data();
+		size = compiled.size();
+	}
+
+	ID3DBlob* result = nullptr;
+	if (FAILED(D3DCreateBlob(size, &result)))
+		return nullptr;
+	memcpy(result->GetBufferPointer(), data, size);
+	return result;
 }
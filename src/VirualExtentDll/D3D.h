@@ -8,13 +8,14 @@
 #define XR_USE_GRAPHICS_API_D3D11
 #endif
 
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 
 #include <cstdint>
+#include "state_filter.h"
 #include "openxr.h" // fr swapchain_surfdata_t och swapchain_t
 
 // Globala D3D-objekt som appen anvnder
@@ -22,18 +23,100 @@ extern ID3D11Device* d3d_device;
 extern ID3D11DeviceContext* d3d_context;
 extern int64_t              d3d_swapchain_fmt;
 
+// Draw code binds pipeline state through d3d_state rather than d3d_context directly, so binds
+// that repeat what is already bound are dropped (counted per frame).
+extern StateFilter<ID3D11DeviceContext> d3d_state;
+
+// Single-pass stereo: one texture-array target, every draw instanced once per view and routed
+// to its slice with SV_RenderTargetArrayIndex from the vertex shader (needs D3D11.3 OPTIONS3).
+extern bool                    d3d_single_pass_supported;
+extern uint32_t                d3d_view_count;       // views drawn by the current pass (1 or 2)
+
 // Init/teardown
 bool           d3d_init(LUID& adapter_luid);
 void           d3d_shutdown();
 IDXGIAdapter1* d3d_get_adapter(LUID& adapter_luid);
 
 // Ytor/swapchain-hjlp
-swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchainImage);
+swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchainImage, ID3D11DepthStencilView* depthView);
+
+// Depth: one buffer per swapchain, shared by all of its images, or none when nothing drawn in
+// app_draw depth tests (d3d_depth_required, set before openxr_init; sized with depth_plan.h).
+extern bool             d3d_depth_required;
+ID3D11DepthStencilView* d3d_make_depth(XrBaseInStructure& swapchainImage);
 void                 d3d_swapchain_destroy(swapchain_t& swapchain);
 
 // Rendering och proj-matris
-void                 d3d_render_layer(XrCompositionLayerProjectionView& layerView, swapchain_surfdata_t& surface);
+void                 d3d_render_layer(uint32_t view_index, XrCompositionLayerProjectionView& layerView, swapchain_surfdata_t& surface);
+void                 d3d_render_layer_stereo(XrCompositionLayerProjectionView* views, uint32_t view_count, swapchain_surfdata_t& surface);
 DirectX::XMMATRIX    d3d_xr_projection(XrFovf fov, float clip_near, float clip_far);
 
+// Per-view constants, computed once per view by d3d_prepare_view (after the view's pose is
+// final) and bound by each pass at register(b1) for vertex and pixel shaders. Matrices are
+// stored transposed for HLSL; frustum planes are in world space and point inwards.
+struct d3d_view_block_t {
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 proj;
+	DirectX::XMFLOAT4X4 viewproj;
+	DirectX::XMFLOAT4   cam_pos;
+	DirectX::XMFLOAT4   frustum[6]; // left, right, bottom, top, near, far
+};
+void                 d3d_prepare_view(uint32_t index, const XrCompositionLayerProjectionView& view);
+// True if the sphere touches any view of the current pass
+bool                 d3d_sphere_visible(const DirectX::XMFLOAT3& center, float radius);
+
+// Shaders declare b1 by including shaders/view_cb.hlsli. Vertex shaders pick their view with
+// eye = SV_InstanceID % viewCount; draw with d3d_draw_indexed.
+static const UINT d3d_view_slot = 1;
+void                 d3d_draw_indexed(UINT index_count);
+// instance_count instances of the geometry, each drawn once per view: the vertex shader's
+// instance is SV_InstanceID / viewCount
+void                 d3d_draw_indexed_instanced(UINT index_count, UINT instance_count);
+
+// Uploads a draw's constants and binds them at `slot` for the given stages. With D3D11.1 they
+// go into a shared ring buffer bound by offset; otherwise into `fallback`, which must be a
+// DEFAULT-usage constant buffer of exactly `bytes`.
+static const UINT d3d_stage_vs = 1;
+static const UINT d3d_stage_ps = 2;
+void                 d3d_set_constants(ID3D11Buffer* fallback, const void* data, UINT bytes, UINT slot, UINT stages);
+
+// Late-latched poses, uploaded right before each eye is drawn. Shaders read them from
+// register(b2) as: cbuffer LatchCB : register(b2) { float4x4 handWorld[2]; float4 handValid; };
+static const UINT d3d_latch_slot = 2;
+void                 d3d_latch_poses(const XrPosef hand_pose[2], const XrBool32 hand_valid[2]);
+
+// Once per frame before rendering: closes the last frame's counts. The tracked state itself is
+// forgotten at the start of every pass
+void                 d3d_state_frame_begin();
+
+// GPU time of the work between begin and end (once per frame), available a few frames later.
+// read returns the newest finished measurement, false if none finished since the last call.
+void                 d3d_gpu_timer_begin();
+void                 d3d_gpu_timer_end();
+bool                 d3d_gpu_timer_read(uint64_t* out_ns);
+
 // Shaderkompilering
-ID3DBlob* d3d_compile_shader(const char* hlsl, const char* entrypoint, const char* target);
+//
+// Shaders: shaders/<module>.hlsl is compiled by the FxCompile step of the vcxproj into
+// $(IntDir)shaders/<module>_<vs|vs_stereo|ps>.h (g_<module>_<variant>), mono and VE_STEREO
+// variants alike, and the module includes the headers it uses. D3D_SHADER names one of them.
+//
+// Runtime compilation through the on-disk ShaderCache is only the fallback: in builds without
+// VE_PRECOMPILED_SHADERS, or when VE_SHADER_DIR points at a directory of .hlsl files to iterate
+// on without rebuilding. It compiles <dir>/<file> (default: shaders\ next to the DLL).
+struct d3d_shader_t {
+	const BYTE* bytecode;  // precompiled, or null
+	size_t      size;
+	const char* file;      // source under shaders/
+	const char* entry;
+	const char* target;
+	bool        stereo;    // VE_STEREO=1
+};
+#ifdef VE_PRECOMPILED_SHADERS
+#define D3D_SHADER(module, variant, entry, target, stereo) \
+	d3d_shader_t{ g_##module##_##variant, sizeof(g_##module##_##variant), #module ".hlsl", entry, target, stereo }
+#else
+#define D3D_SHADER(module, variant, entry, target, stereo) \
+	d3d_shader_t{ nullptr, 0, #module ".hlsl", entry, target, stereo }
+#endif
+ID3DBlob* d3d_load_shader(const d3d_shader_t& shader);
@@ -4,9 +4,17 @@
 #define XR_USE_GRAPHICS_API_D3D11
 
 #include "openxr.h"
+#include "d3d.h"            // depth planning
+#include "frame_timing.h"
+#include "frame_arena.h"
+#include "frame_pacer.h"
+#include "resolution_controller.h"
+#include "stereo_layout.h"
+#include "depth_plan.h"
 
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <windows.h>
 #include <cstdio>
 #include <cstring>
@@ -16,15 +24,28 @@
 // Forward declarations for functions/objects provided by main.cpp (D3D + App)
 extern bool                 d3d_init(LUID& adapter_luid);
 extern void                 d3d_swapchain_destroy(swapchain_t& swapchain);
-extern swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchainImage);
-extern void                 d3d_render_layer(XrCompositionLayerProjectionView& layerView, swapchain_surfdata_t& surface);
+extern swapchain_surfdata_t d3d_make_surface_data(XrBaseInStructure& swapchainImage, ID3D11DepthStencilView* depthView);
+extern void                 d3d_render_layer(uint32_t view_index, XrCompositionLayerProjectionView& layerView, swapchain_surfdata_t& surface);
+extern void                 d3d_gpu_timer_begin();
+extern void                 d3d_gpu_timer_end();
+extern bool                 d3d_gpu_timer_read(uint64_t* out_ns);
+extern void                 d3d_render_layer_stereo(XrCompositionLayerProjectionView* views, uint32_t view_count, swapchain_surfdata_t& surface);
+extern bool                 d3d_single_pass_supported;
+extern void                 d3d_latch_poses(const XrPosef hand_pose[2], const XrBool32 hand_valid[2]);
 
 // D3D globals provided by main.cpp
 extern ID3D11Device* d3d_device;
 extern int64_t       d3d_swapchain_fmt;
 
+// D3D globals provided by main.cpp
+extern ID3D11DeviceContext* d3d_context;
+
 // App hooks provided by main.cpp
 extern void app_update_predicted();
+extern void app_update_latched();
+extern bool app_quad_pose(const XrPosef& head_pose, XrPosef& out_pose, XrExtent2Df& out_size);
+extern void app_input_changed(XrTime change_time);
+extern void app_session_state_changed(XrSessionState state);
 
 // Function pointers for OpenXR extension methods
 static PFN_xrGetD3D11GraphicsRequirementsKHR ext_xrGetD3D11GraphicsRequirementsKHR = nullptr;
@@ -35,11 +56,20 @@ static PFN_xrDestroyDebugUtilsMessengerEXT   ext_xrDestroyDebugUtilsMessengerEXT
 const XrPosef  xr_pose_identity = { {0,0,0,1}, {0,0,0} };
 static XrInstance     xr_instance = {};
 static XrSession      xr_session = {};
-XrSessionState        xr_session_state = XR_SESSION_STATE_UNKNOWN;
+std::atomic<XrSessionState> xr_session_state = XR_SESSION_STATE_UNKNOWN;
+XrTime                      xr_session_state_time = 0;
 bool                  xr_running = false;
 static XrSpace        xr_app_space = {};
 static XrSystemId     xr_system_id = XR_NULL_SYSTEM_ID;
 input_state_t         xr_input = { };
+// Pose spaces created for the profile's mappings (MappingAction::xr_space); openxr_shutdown destroys them
+static std::vector<XrSpace> xr_mapping_spaces;
+static bool openxr_is_mapping_space(XrSpace space) {
+	return std::find(xr_mapping_spaces.begin(), xr_mapping_spaces.end(), space) != xr_mapping_spaces.end();
+}
+
+// xrStringToPath results by string, so each distinct string is converted once per instance
+static std::unordered_map<std::string, XrPath> xr_path_cache;
 static XrEnvironmentBlendMode   xr_blend = {};
 static XrDebugUtilsMessengerEXT xr_debug = {};
 
@@ -47,6 +77,29 @@ static std::vector<XrView>                  xr_views;
 static std::vector<XrViewConfigurationView> xr_config_views;
 static std::vector<swapchain_t>             xr_swapchains;
 
+// Optional quad layer: its own swapchain, only written when the app has a new image for it
+bool                  xr_quad_layer_mode = false;
+static swapchain_t    xr_quad_swapchain = {};
+static bool           xr_quad_has_image = false;
+
+// Late latch: hands are located again right before the first pass, views right before each pass
+bool                  xr_late_latch = true;
+static uint64_t       xr_hands_frame_ns = 0;   // FrameTimer::Now() of this frame's first hand sample
+
+// Single pass stereo: one arraySize = 2 swapchain (xr_swapchains[0]) that both eyes render into at once
+bool                  xr_single_pass = false;
+static StereoLayout   xr_stereo;
+
+// Pipelined frames: a pacer thread waits for frame N+1 while this thread records frame N
+bool                  xr_pipelined_frames = false;
+static FramePacer     xr_pacer;
+
+// Dynamic resolution: the submitted imageRect is a scaled part of the allocated swapchain
+bool                        xr_dynamic_resolution = false;
+static ResolutionController xr_resolution;
+static uint64_t             xr_render_cpu_ns = 0;   // this frame's CPU time recording passes
+static uint64_t             xr_render_gpu_ns = 0;   // newest GPU time read back
+
 static XrFormFactor            app_config_form = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
 static XrViewConfigurationType app_config_view = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
 
@@ -143,11 +196,23 @@ bool openxr_init(const char* app_name, int64_t swapchain_format) {
 	xr_config_views.resize(view_count, { XR_TYPE_VIEW_CONFIGURATION_VIEW });
 	xr_views.resize(view_count, { XR_TYPE_VIEW });
 	xrEnumerateViewConfigurationViews(xr_instance, xr_system_id, app_config_view, view_count, &view_count, xr_config_views.data());
-	for (uint32_t i = 0; i < view_count; i++) {
+
+	uint32_t widths[2] = {}, heights[2] = {};
+	for (uint32_t i = 0; i < view_count && i < 2; i++) {
+		widths[i] = xr_config_views[i].recommendedImageRectWidth;
+		heights[i] = xr_config_views[i].recommendedImageRectHeight;
+	}
+	xr_stereo = StereoPlan(xr_single_pass, d3d_single_pass_supported, view_count, widths, heights);
+	if (xr_single_pass && !xr_stereo.singlePass)
+		OutputDebugStringA("Single pass stereo not available, rendering one pass per eye\n");
+
+	const uint32_t swapchain_count = xr_stereo.swapchainCount;
+	uint64_t       depth_bytes = 0, depth_saved = 0;
+	for (uint32_t i = 0; i < swapchain_count; i++) {
 		XrViewConfigurationView& view = xr_config_views[i];
 		XrSwapchainCreateInfo    swapchain_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
 		XrSwapchain              handle;
-		swapchain_info.arraySize = 1;
+		swapchain_info.arraySize = xr_stereo.arraySize;
 		swapchain_info.mipCount = 1;
 		swapchain_info.faceCount = 1;
 		swapchain_info.format = (int64_t)swapchain_format;
@@ -167,33 +232,63 @@ bool openxr_init(const char* app_name, int64_t swapchain_format) {
 		swapchain.surface_images.resize(surface_count, { XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR });
 		swapchain.surface_data.resize(surface_count);
 		xrEnumerateSwapchainImages(swapchain.handle, surface_count, &surface_count, (XrSwapchainImageBaseHeader*)swapchain.surface_images.data());
+		const DepthPlan depth_plan = PlanDepth(swapchain_info.width, swapchain_info.height, swapchain_info.arraySize, surface_count, d3d_depth_required);
+		ID3D11DepthStencilView* depth_view = depth_plan.textures && surface_count ? d3d_make_depth((XrBaseInStructure&)swapchain.surface_images[0]) : nullptr;
 		for (uint32_t j = 0; j < surface_count; j++) {
-			swapchain.surface_data[j] = d3d_make_surface_data((XrBaseInStructure&)swapchain.surface_images[j]);
+			swapchain.surface_data[j] = d3d_make_surface_data((XrBaseInStructure&)swapchain.surface_images[j], depth_view);
 		}
+		if (depth_view) depth_view->Release();
 		xr_swapchains.push_back(swapchain);
+
+		depth_bytes += depth_plan.bytes;
+		depth_saved += depth_plan.savedBytes;
 	}
 
+	char depth_msg[160];
+	sprintf_s(depth_msg, "Depth buffers: %.1f MB (%.1f MB saved by sharing one per swapchain)\n",
+		depth_bytes / (1024.0 * 1024.0), depth_saved / (1024.0 * 1024.0));
+	OutputDebugStringA(depth_msg);
+
+	// Per-frame scratch, so the frame loop doesn't touch the heap. All a frame puts in it is the
+	// projection views (openxr_render_frame), so that is its size, plus room for alignment.
+	if (!g_frame_arena.Init(xr_views.size() * sizeof(XrCompositionLayerProjectionView) + alignof(std::max_align_t)))
+		return false;
+
 	return true;
 }
 
 
 
 void openxr_shutdown() {
+	xr_pacer.Stop();
 	for (size_t i = 0; i < xr_swapchains.size(); i++) {
 		xrDestroySwapchain(xr_swapchains[i].handle);
 		d3d_swapchain_destroy(xr_swapchains[i]);
 	}
 	xr_swapchains.clear();
+	g_frame_arena.Shutdown();
+
+	if (xr_quad_swapchain.handle != XR_NULL_HANDLE) xrDestroySwapchain(xr_quad_swapchain.handle);
+	xr_quad_swapchain = {};
+	xr_quad_has_image = false;
 
 	if (xr_input.actionSet != XR_NULL_HANDLE) {
-		if (xr_input.handSpace[0] != XR_NULL_HANDLE) xrDestroySpace(xr_input.handSpace[0]);
-		if (xr_input.handSpace[1] != XR_NULL_HANDLE) xrDestroySpace(xr_input.handSpace[1]);
+		// A hand space is either poseAction's own or one of the mapping spaces, never both
+		for (int32_t i = 0; i < 2; i++)
+			if (xr_input.handSpace[i] != XR_NULL_HANDLE && !openxr_is_mapping_space(xr_input.handSpace[i]))
+				xrDestroySpace(xr_input.handSpace[i]);
+		for (XrSpace space : xr_mapping_spaces)
+			xrDestroySpace(space);
 		xrDestroyActionSet(xr_input.actionSet);
 	}
+	xr_mapping_spaces.clear();
+	xr_input.handSpace[0] = xr_input.handSpace[1] = XR_NULL_HANDLE;
+	xr_input.actionSet = XR_NULL_HANDLE;
 	if (xr_app_space != XR_NULL_HANDLE) xrDestroySpace(xr_app_space);
 	if (xr_session != XR_NULL_HANDLE) xrDestroySession(xr_session);
 	if (xr_debug != XR_NULL_HANDLE && ext_xrDestroyDebugUtilsMessengerEXT) ext_xrDestroyDebugUtilsMessengerEXT(xr_debug);
 	if (xr_instance != XR_NULL_HANDLE) xrDestroyInstance(xr_instance);
+	xr_path_cache.clear();
 }
 
 void openxr_poll_events(bool& exit) {
@@ -206,6 +301,8 @@ void openxr_poll_events(bool& exit) {
 		case XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED: {
 			XrEventDataSessionStateChanged* changed = (XrEventDataSessionStateChanged*)&event_buffer;
 			xr_session_state = changed->state;
+			xr_session_state_time = changed->time;
+			app_session_state_changed(changed->state);
 
 			switch (xr_session_state) {
 			case XR_SESSION_STATE_READY: {
@@ -213,9 +310,12 @@ void openxr_poll_events(bool& exit) {
 				begin_info.primaryViewConfigurationType = app_config_view;
 				xrBeginSession(xr_session, &begin_info);
 				xr_running = true;
+				if (xr_pipelined_frames)
+					xr_pacer.Start(xr_session, xr_blend);
 			} break;
 			case XR_SESSION_STATE_STOPPING: {
 				xr_running = false;
+				xr_pacer.Stop();
 				xrEndSession(xr_session);
 			} break;
 			case XR_SESSION_STATE_EXITING:      exit = true;              break;
@@ -275,6 +375,18 @@ XrActionType determine_action_type_from_path(const std::string& path) {
 	throw std::runtime_error("Unknown action type for path: " + path);
 }
 
+static XrResult openxr_string_to_path(const std::string& str, XrPath* path) {
+	auto it = xr_path_cache.find(str);
+	if (it != xr_path_cache.end()) {
+		*path = it->second;
+		return XR_SUCCESS;
+	}
+	XrResult res = xrStringToPath(xr_instance, str.c_str(), path);
+	if (XR_SUCCEEDED(res))
+		xr_path_cache.emplace(str, *path);
+	return res;
+}
+
 bool openxr_generate_actions(ControllerProfile& profile) {
 	// Create Action Set
 
@@ -288,8 +400,8 @@ bool openxr_generate_actions(ControllerProfile& profile) {
 	}
 
 	// Create hand subpaths
-	xrStringToPath(xr_instance, "/user/hand/left", &xr_input.handSubactionPath[0]);
-	xrStringToPath(xr_instance, "/user/hand/right", &xr_input.handSubactionPath[1]);
+	openxr_string_to_path("/user/hand/left", &xr_input.handSubactionPath[0]);
+	openxr_string_to_path("/user/hand/right", &xr_input.handSubactionPath[1]);
 
 	// Pose action
 	XrActionCreateInfo action_info = { XR_TYPE_ACTION_CREATE_INFO };
@@ -312,19 +424,33 @@ bool openxr_generate_actions(ControllerProfile& profile) {
 	std::vector<XrActionSuggestedBinding> bindings;
 
 	XrPath pose_path[2];
-	xrStringToPath(xr_instance, "/user/hand/left/input/grip/pose", &pose_path[0]);
-	xrStringToPath(xr_instance, "/user/hand/right/input/grip/pose", &pose_path[1]);
+	openxr_string_to_path("/user/hand/left/input/grip/pose", &pose_path[0]);
+	openxr_string_to_path("/user/hand/right/input/grip/pose", &pose_path[1]);
 	bindings.push_back({ xr_input.poseAction, pose_path[0] });
 	bindings.push_back({ xr_input.poseAction, pose_path[1] });
 
 	
 
 	// Loop through JSON-defined mappings --------------------------------------------------
+	// One action per input path: mappings that share a path (thumbstick X and Y, both directions)
+	// share its action, binding and space, and the poll fans its state out to all of them.
+	std::unordered_map<std::string, size_t> interned;   // path -> mapping that owns its action
+	uint32_t actionCount = 0;
 	for (size_t i = 0; i < profile.map.size(); ++i) {
 		auto& m = profile.map[i];
 
+		auto owner = interned.find(m.name);
+		if (owner != interned.end()) {
+			const MappingAction& o = profile.map[owner->second];
+			m.xr_path = o.xr_path;
+			m.xr_actionType = o.xr_actionType;
+			m.xr_action = o.xr_action;
+			m.xr_space = o.xr_space;
+			continue;
+		}
+
 		// Create path for this input
-		if (XR_FAILED(xrStringToPath(xr_instance, m.name.c_str(), &m.xr_path))) {
+		if (XR_FAILED(openxr_string_to_path(m.name, &m.xr_path))) {
 			OutputDebugStringA(("Failed to convert path: " + m.name + "\n").c_str());
 			continue;
 		}
@@ -368,8 +494,10 @@ bool openxr_generate_actions(ControllerProfile& profile) {
 			continue;
 		}
 
-		// Suggested binding entry for this mapping
+		// Suggested binding entry for this input
 		bindings.push_back({ m.xr_action, m.xr_path });
+		interned.emplace(m.name, i);
+		actionCount++;
 
 		// Create pose action spaces
 		if (actionType == XR_ACTION_TYPE_POSE_INPUT) {
@@ -383,10 +511,14 @@ bool openxr_generate_actions(ControllerProfile& profile) {
 				asci.subactionPath = xr_input.handSubactionPath[1];
 
 			if (XR_SUCCEEDED(xrCreateActionSpace(xr_session, &asci, &m.xr_space))) {
-				if (m.name.starts_with("/user/hand/left"))
-					xr_input.handSpace[0] = m.xr_space;
-				else
-					xr_input.handSpace[1] = m.xr_space;
+				// The mapping's pose drives the hand. The poll still locates it through m.xr_space, so
+				// xr_mapping_spaces keeps it; the grip space created for poseAction above is no longer
+				// used and is destroyed rather than leaked.
+				const int32_t hand = m.name.starts_with("/user/hand/left") ? 0 : 1;
+				if (!openxr_is_mapping_space(xr_input.handSpace[hand]) && xr_input.handSpace[hand] != XR_NULL_HANDLE)
+					xrDestroySpace(xr_input.handSpace[hand]);
+				xr_input.handSpace[hand] = m.xr_space;
+				xr_mapping_spaces.push_back(m.xr_space);
 			}
 			else {
 				OutputDebugStringA(("Failed to create pose space for: " + m.name + "\n").c_str());
@@ -394,9 +526,13 @@ bool openxr_generate_actions(ControllerProfile& profile) {
 		}
 	}
 
+	char action_msg[128];
+	sprintf_s(action_msg, "Actions: %u for %zu mappings\n", actionCount, profile.map.size());
+	OutputDebugStringA(action_msg);
+
 	// Suggest the bindings ---------------------------------------------------------
 	XrPath profilePath;
-	if (XR_FAILED(xrStringToPath(xr_instance, profile.name.c_str(), &profilePath))) {
+	if (XR_FAILED(openxr_string_to_path(profile.name, &profilePath))) {
 		OutputDebugStringA(("Invalid interaction profile: " + profile.name + "\n").c_str());
 		return false;
 	}
@@ -425,7 +561,7 @@ bool openxr_generate_actions(ControllerProfile& profile) {
 }
 
 
-void poll_controller_profile(ControllerProfile& profile) {
+void poll_controller_profile(CompiledProfile& profile, CompiledInputState* states, uint32_t capacity) {
 	if (xr_session_state != XR_SESSION_STATE_FOCUSED)
 		return;
 
@@ -438,108 +574,70 @@ void poll_controller_profile(ControllerProfile& profile) {
 	sync_info.activeActionSets = &action_set;
 	xrSyncActions(xr_session, &sync_info);
 
-	for (auto& m : profile.map) {
+	// Each input is queried once; fan_out_input evaluates its state against every mapping bound to
+	// it, and app_input_changed is called once per input state change
+	for (uint32_t n = 0; n < (uint32_t)profile.inputs.size(); n++) {
+		const CompiledInput& in = profile.inputs[n];
+		CompiledInputState*  out = states && n < capacity ? &states[n] : nullptr;
 		XrActionStateGetInfo gi{ XR_TYPE_ACTION_STATE_GET_INFO };
-		gi.action = m.xr_action;
-		gi.subactionPath = m.name.starts_with("/user/hand/left") ?
-			xr_input.handSubactionPath[0] : xr_input.handSubactionPath[1];
+		gi.action = in.action;
+		gi.subactionPath = in.subaction;
+		if (out) out->active = false;   // until read successfully below
 
-		switch (m.xr_actionType) {
+		switch (in.type) {
 		case XR_ACTION_TYPE_BOOLEAN_INPUT: {
 			XrActionStateBoolean state{ XR_TYPE_ACTION_STATE_BOOLEAN };
 			if (XR_SUCCEEDED(xrGetActionStateBoolean(xr_session, &gi, &state)) && state.isActive) {
-				
-				bool cur_bol = state.currentState ? XR_TRUE : XR_FALSE;
-				if (cur_bol != m.last_bool_state) {
-					deal_with_bool_action(m, cur_bol);
-					m.last_bool_state = cur_bol;
-				}
-				
+				XrVector2f value = { state.currentState ? 1.0f : 0.0f, 0.0f };
+				if (out) *out = { value, out->pose, state.lastChangeTime, true };
+				if (fan_out_input(profile, n, value)) app_input_changed(state.lastChangeTime);
 			}
 			break;
 		}
 		case XR_ACTION_TYPE_FLOAT_INPUT: {
 			XrActionStateFloat state{ XR_TYPE_ACTION_STATE_FLOAT };
 			if (XR_SUCCEEDED(xrGetActionStateFloat(xr_session, &gi, &state)) && state.isActive) {
-				if (state.currentState != m.last_float_state) {
-					deal_with_float_action(m, state.currentState, m.last_float_state);
-					m.last_float_state = state.currentState;
-				}
-				
+				XrVector2f value = { state.currentState, 0.0f };
+				if (out) *out = { value, out->pose, state.lastChangeTime, true };
+				if (fan_out_input(profile, n, value)) app_input_changed(state.lastChangeTime);
 			}
 			break;
 		}
 		case XR_ACTION_TYPE_VECTOR2F_INPUT: {
 			XrActionStateVector2f state{ XR_TYPE_ACTION_STATE_VECTOR2F };
 			if (XR_SUCCEEDED(xrGetActionStateVector2f(xr_session, &gi, &state)) && state.isActive) {
-
-				if (m.is_x.has_value())
-				{
-					bool is_x = m.is_x.value();
-					float value = is_x ? state.currentState.x : state.currentState.y;
-
-					if ( value != m.last_float_state) {
-						deal_with_float_action(m, value, m.last_float_state);
-						m.last_float_state = value;
-					}
-				}
+				if (out) *out = { state.currentState, out->pose, state.lastChangeTime, true };
+				if (fan_out_input(profile, n, state.currentState)) app_input_changed(state.lastChangeTime);
 			}
 			break;
 		}
 		case XR_ACTION_TYPE_POSE_INPUT: { //seams to not work as all poses need to be a part of the same xr_space or somthing like that
-			OutputDebugStringA("pose:");
-			if (m.xr_space != XR_NULL_HANDLE) {
-				OutputDebugStringA("NOt null:");
+			XrSpace space = profile.map[profile.fanout[in.first]].space;
+			if (space != XR_NULL_HANDLE) {
 				XrSpaceLocation loc{ XR_TYPE_SPACE_LOCATION };
-
-				//XrResult res = xrLocateSpace(xr_input.handSpace[hand], xr_app_space, select_state.lastChangeTime, &space_location);
-				if (XR_SUCCEEDED(xrLocateSpace(m.xr_space, xr_app_space, 0 /* use predicted time later */, &loc)) &&
+				if (XR_SUCCEEDED(xrLocateSpace(space, xr_app_space, 0 /* use predicted time later */, &loc)) &&
 					(loc.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) &&
 					(loc.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT)) {
-
-					OutputDebugStringA("suceeed:");
-
-					bool valid_pose = (loc.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) &&
-						(loc.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT);
-
-
-					m.xr_posef = loc.pose;
-
-					if (m.name.starts_with("/user/hand/left")) {
-						xr_input.renderHand[0] = valid_pose ? XR_TRUE : XR_FALSE;
-					}
-					else {
-						xr_input.renderHand[1] = valid_pose ? XR_TRUE : XR_FALSE;
-					}
-
-					std::stringstream ss;
-					ss << "[pose] " << m.name << ": pos("
-						<< loc.pose.position.x << ", "
-						<< loc.pose.position.y << ", "
-						<< loc.pose.position.z << ") rot("
-						<< loc.pose.orientation.x << ", "
-						<< loc.pose.orientation.y << ", "
-						<< loc.pose.orientation.z << ", "
-						<< loc.pose.orientation.w << ")\n";
-					OutputDebugStringA(ss.str().c_str());
+					// Only published through states: xr_input.handPose/renderHand belong to the render
+					// thread (openxr_poll_predicted), and this may run on the input thread
+					if (out) { out->pose = loc.pose; out->active = true; }
 				}
 			}
 			break;
 		}
 		default:
-			OutputDebugStringA(("Unknown action type for: " + m.name + "\n").c_str());
 			break;
 		}
 	}
+
+	// Everything this poll produced goes out as one batch, in evaluation order
+	flush_input_commands();
 }
 
 
 
 
-void openxr_poll_predicted(XrTime predicted_time) {
-	if (xr_session_state != XR_SESSION_STATE_FOCUSED)
-		return;
-
+static void openxr_locate_hands(XrTime predicted_time) {
 	for (size_t i = 0; i < 2; i++) {
 		XrSpaceLocation spaceRelation = { XR_TYPE_SPACE_LOCATION };
 		XrResult        res = xrLocateSpace(xr_input.handSpace[i], xr_app_space, predicted_time, &spaceRelation);
@@ -555,64 +653,343 @@ void openxr_poll_predicted(XrTime predicted_time) {
 	}
 }
 
+void openxr_poll_predicted(XrTime predicted_time) {
+	if (xr_session_state != XR_SESSION_STATE_FOCUSED)
+		return;
+
+	openxr_locate_hands(predicted_time);
+	xr_hands_frame_ns = FrameTimer::Now();
+}
+
+// Right before the first pass: ask the runtime again for the hands at the same display time. By
+// now it has newer tracking samples than at xrBeginFrame, so the prediction interval (and its
+// error) is shorter. Once per frame: the pointer interaction is computed from this pose and every
+// pass draws with it, so rays, hits and the injected cursor agree in both eyes.
+static void openxr_late_latch_hands(XrTime predicted_time) {
+	if (xr_session_state != XR_SESSION_STATE_FOCUSED)
+		return;
+
+	FramePhaseScope t(FP_LateLatch);
+	openxr_locate_hands(predicted_time);
+}
+
+// Right before views [first, first + count) are drawn: the same for the views
+static void openxr_late_latch(XrTime predicted_time, XrCompositionLayerProjectionView* views, uint32_t first, uint32_t count) {
+	if (xr_session_state != XR_SESSION_STATE_FOCUSED)
+		return;
+
+	FramePhaseScope t(FP_LateLatch);
+	if (xr_hands_frame_ns)
+		g_frame_timer.SetMetric(first == 0 ? FM_LatchSavedEye0 : FM_LatchSavedEye1, FrameTimer::Now() - xr_hands_frame_ns);
+
+	uint32_t         view_count = 0;
+	XrViewState      view_state = { XR_TYPE_VIEW_STATE };
+	XrViewLocateInfo locate_info = { XR_TYPE_VIEW_LOCATE_INFO };
+	locate_info.viewConfigurationType = app_config_view;
+	locate_info.displayTime = predicted_time;
+	locate_info.space = xr_app_space;
+	if (XR_SUCCEEDED(xrLocateViews(xr_session, &locate_info, &view_state, (uint32_t)xr_views.size(), &view_count, xr_views.data())) &&
+		(view_state.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT) != 0) {
+		for (uint32_t i = first; i < first + count && i < view_count; i++) {
+			views[i].pose = xr_views[i].pose;
+			views[i].fov = xr_views[i].fov;
+		}
+	}
+}
+
 void openxr_render_frame() {
+	g_frame_arena.Reset();
+
 	XrFrameState frame_state = { XR_TYPE_FRAME_STATE };
-	xrWaitFrame(xr_session, nullptr, &frame_state);
-	xrBeginFrame(xr_session, nullptr);
+	bool         paced = false;
+	if (xr_pacer.Running()) {
+		// Waited for and begun on the pacer thread; what is left here is the time blocked on it
+		uint64_t begin_ns = 0;
+		{
+			FramePhaseScope t(FP_WaitFrame);
+			paced = xr_pacer.Acquire(&frame_state, &begin_ns);
+		}
+		if (paced)
+			g_frame_timer.Add(FP_BeginFrame, begin_ns);
+		else if (xr_pacer.Failed())
+			xr_pacer.Stop();  // its xrWaitFrame failed: wait inline from now on
+	}
+	if (!paced) {
+		{ FramePhaseScope t(FP_WaitFrame);  xrWaitFrame(xr_session, nullptr, &frame_state); }
+		{ FramePhaseScope t(FP_BeginFrame); xrBeginFrame(xr_session, nullptr); }
+	}
 
-	openxr_poll_predicted(frame_state.predictedDisplayTime);
+	{ FramePhaseScope t(FP_PollPredicted); openxr_poll_predicted(frame_state.predictedDisplayTime); }
 	app_update_predicted();
 
-	XrCompositionLayerBaseHeader* layer = nullptr;
+	XrCompositionLayerBaseHeader* layers[2] = {};
+	uint32_t                      layer_count = 0;
 	XrCompositionLayerProjection             layer_proj = { XR_TYPE_COMPOSITION_LAYER_PROJECTION };
-	std::vector<XrCompositionLayerProjectionView> views;
+	XrCompositionLayerQuad                   layer_quad = { XR_TYPE_COMPOSITION_LAYER_QUAD };
+	const uint32_t                           view_capacity = (uint32_t)xr_views.size();
+	XrCompositionLayerProjectionView*        views = g_frame_arena.AllocArray<XrCompositionLayerProjectionView>(view_capacity, { XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW });
 	bool session_active = xr_session_state == XR_SESSION_STATE_VISIBLE || xr_session_state == XR_SESSION_STATE_FOCUSED;
-	if (session_active && openxr_render_layer(frame_state.predictedDisplayTime, views, layer_proj)) {
-		layer = (XrCompositionLayerBaseHeader*)&layer_proj;
+	bool rendered = false;
+	xr_render_cpu_ns = 0;
+	if (session_active && views) {
+		d3d_state_frame_begin();
+		d3d_gpu_timer_begin();
+		rendered = openxr_render_layer(frame_state.predictedDisplayTime, views, view_capacity, layer_proj);
+		d3d_gpu_timer_end();
+	}
+	if (rendered) {
+		// Quad goes underneath; the projection (controllers etc.) is alpha blended on top of it.
+		// Without UNPREMULTIPLIED_ALPHA_BIT the runtime takes the projection as premultiplied:
+		// the clear is (0,0,0,0), transparent, and everything drawn writes alpha 1, so the blend
+		// is correct wherever the bit is honoured. No quad, no blend: the projection stays opaque.
+		if (xr_quad_layer_mode && openxr_quad_layer(layer_quad)) {
+			layers[layer_count++] = (XrCompositionLayerBaseHeader*)&layer_quad;
+			layer_proj.layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
+		}
+		layers[layer_count++] = (XrCompositionLayerBaseHeader*)&layer_proj;
 	}
 
 	XrFrameEndInfo end_info{ XR_TYPE_FRAME_END_INFO };
 	end_info.displayTime = frame_state.predictedDisplayTime;
 	end_info.environmentBlendMode = xr_blend;
-	end_info.layerCount = layer == nullptr ? 0 : 1;
-	end_info.layers = &layer;
-	xrEndFrame(xr_session, &end_info);
+	end_info.layerCount = layer_count;
+	end_info.layers = layers;
+	{ FramePhaseScope t(FP_EndFrame); xrEndFrame(xr_session, &end_info); }
+	if (paced)
+		xr_pacer.Submitted();
+
+	// Next frame's resolution, from whichever of CPU recording and GPU execution is the bottleneck
+	if (xr_dynamic_resolution && rendered) {
+		d3d_gpu_timer_read(&xr_render_gpu_ns);
+		xr_resolution.Update(std::max(xr_render_cpu_ns, xr_render_gpu_ns), (uint64_t)frame_state.predictedDisplayPeriod);
+	}
+
+	if (g_frame_timer.Enabled()) {
+		g_frame_timer.Commit(frame_state.predictedDisplayTime, frame_state.predictedDisplayPeriod);
+		if (g_frame_timer.FrameCount() % FrameTimer::kCapacity == 0) {
+			static FrameTimer::Scratch timing_scratch; // render thread only
+			char report[2048];
+			g_frame_timer.Format(report, sizeof(report), timing_scratch);
+			OutputDebugStringA(report);
+			const auto& binds = d3d_state.Total();
+			sprintf_s(report, "State filter: %llu binds issued, %llu redundant dropped\n",
+				(unsigned long long)binds.issued, (unsigned long long)binds.dropped);
+			OutputDebugStringA(report);
+		}
+	}
 }
 
-bool openxr_render_layer(XrTime predictedTime, std::vector<XrCompositionLayerProjectionView>& views, XrCompositionLayerProjection& layer) {
-	uint32_t         view_count = 0;
-	XrViewState      view_state = { XR_TYPE_VIEW_STATE };
-	XrViewLocateInfo locate_info = { XR_TYPE_VIEW_LOCATE_INFO };
-	locate_info.viewConfigurationType = app_config_view;
-	locate_info.displayTime = predictedTime;
-	locate_info.space = xr_app_space;
-	xrLocateViews(xr_session, &locate_info, &view_state, (uint32_t)xr_views.size(), &view_count, xr_views.data());
-	views.resize(view_count);
+static bool openxr_quad_create(uint32_t width, uint32_t height) {
+	if (xr_quad_swapchain.handle != XR_NULL_HANDLE) xrDestroySwapchain(xr_quad_swapchain.handle);
+	xr_quad_swapchain = {};
+	xr_quad_has_image = false;
+
+	// The image is copied straight from the desktop capture texture, so it has to be in the BGRA
+	// family, and sRGB: a UNORM swapchain would be composited with the wrong gamma. Without it the
+	// caller goes back to drawing the desktop into the projection layer.
+	uint32_t fmt_count = 0;
+	xrEnumerateSwapchainFormats(xr_session, 0, &fmt_count, nullptr);
+	std::vector<int64_t> formats(fmt_count);
+	xrEnumerateSwapchainFormats(xr_session, fmt_count, &fmt_count, formats.data());
+	const int64_t format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	if (std::find(formats.begin(), formats.end(), format) == formats.end()) {
+		OutputDebugStringA("No sRGB BGRA swapchain format for the quad layer\n");
+		return false;
+	}
 
-	for (uint32_t i = 0; i < view_count; i++) {
-		uint32_t                    img_id;
-		XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
-		xrAcquireSwapchainImage(xr_swapchains[i].handle, &acquire_info, &img_id);
+	XrSwapchainCreateInfo swapchain_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
+	swapchain_info.arraySize = 1;
+	swapchain_info.mipCount = 1;
+	swapchain_info.faceCount = 1;
+	swapchain_info.format = format;
+	swapchain_info.width = width;
+	swapchain_info.height = height;
+	swapchain_info.sampleCount = 1;
+	swapchain_info.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+	if (XR_FAILED(xrCreateSwapchain(xr_session, &swapchain_info, &xr_quad_swapchain.handle))) {
+		OutputDebugStringA("Failed to create quad layer swapchain\n");
+		xr_quad_swapchain.handle = XR_NULL_HANDLE;
+		return false;
+	}
+	xr_quad_swapchain.width = (int32_t)width;
+	xr_quad_swapchain.height = (int32_t)height;
 
-		XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
-		wait_info.timeout = XR_INFINITE_DURATION;
-		xrWaitSwapchainImage(xr_swapchains[i].handle, &wait_info);
+	uint32_t surface_count = 0;
+	xrEnumerateSwapchainImages(xr_quad_swapchain.handle, 0, &surface_count, nullptr);
+	xr_quad_swapchain.surface_images.resize(surface_count, { XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR });
+	xrEnumerateSwapchainImages(xr_quad_swapchain.handle, surface_count, &surface_count, (XrSwapchainImageBaseHeader*)xr_quad_swapchain.surface_images.data());
+	return true;
+}
+
+// Copies a new image into the quad swapchain. Only call this when the image actually changed;
+// between updates the runtime keeps compositing (and reprojecting) the last released image.
+bool openxr_quad_update(ID3D11Texture2D* src) {
+	if (!src) return false;
+
+	D3D11_TEXTURE2D_DESC desc;
+	src->GetDesc(&desc);
+	if (desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM && desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM_SRGB &&
+		desc.Format != DXGI_FORMAT_B8G8R8A8_TYPELESS) {
+		// CopyResource can't convert into the swapchain's format
+		xr_quad_layer_mode = false;
+		return false;
+	}
+	if (xr_quad_swapchain.handle == XR_NULL_HANDLE ||
+		xr_quad_swapchain.width != (int32_t)desc.Width || xr_quad_swapchain.height != (int32_t)desc.Height) {
+		if (!openxr_quad_create(desc.Width, desc.Height)) {
+			// Fall back to drawing the desktop into the projection layer
+			xr_quad_layer_mode = false;
+			return false;
+		}
+	}
+
+	uint32_t                    img_id;
+	XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+	{
+		FramePhaseScope t(FP_SwapchainAcquire);
+		if (XR_FAILED(xrAcquireSwapchainImage(xr_quad_swapchain.handle, &acquire_info, &img_id)))
+			return false;
+	}
+
+	XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+	wait_info.timeout = XR_INFINITE_DURATION;
+	{ FramePhaseScope t(FP_SwapchainWait); xrWaitSwapchainImage(xr_quad_swapchain.handle, &wait_info); }
+
+	d3d_context->CopyResource(xr_quad_swapchain.surface_images[img_id].texture, src);
+
+	XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+	{ FramePhaseScope t(FP_SwapchainRelease); xrReleaseSwapchainImage(xr_quad_swapchain.handle, &release_info); }
+	xr_quad_has_image = true;
+	return true;
+}
 
+// Fills the quad layer for this frame; false if there is nothing to show yet.
+bool openxr_quad_layer(XrCompositionLayerQuad& layer) {
+	if (!xr_quad_has_image || xr_views.empty())
+		return false;
+
+	XrPosef     pose = xr_pose_identity;
+	XrExtent2Df size = { 0, 0 };
+	if (!app_quad_pose(xr_views[0].pose, pose, size))
+		return false;
+
+	layer = { XR_TYPE_COMPOSITION_LAYER_QUAD };
+	layer.space = xr_app_space;
+	layer.eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+	layer.subImage.swapchain = xr_quad_swapchain.handle;
+	layer.subImage.imageRect.offset = { 0, 0 };
+	layer.subImage.imageRect.extent = { xr_quad_swapchain.width, xr_quad_swapchain.height };
+	layer.pose = pose;
+	layer.size = size;
+	return true;
+}
+
+static XrExtent2Di openxr_render_extent(const swapchain_t& swapchain) {
+	const float scale = xr_dynamic_resolution ? xr_resolution.Scale() : 1.0f;
+	return { std::max(1, (int32_t)(swapchain.width * scale)), std::max(1, (int32_t)(swapchain.height * scale)) };
+}
+
+float openxr_resolution_scale() {
+	return xr_dynamic_resolution ? xr_resolution.Scale() : 1.0f;
+}
+
+uint64_t openxr_resolution_changes() {
+	return xr_resolution.Changes();
+}
+
+// Single pass: both eyes go into one image, each view pointing at its own array slice
+static void openxr_render_stereo(XrTime predictedTime, XrCompositionLayerProjectionView* views, uint32_t view_count) {
+	swapchain_t& swapchain = xr_swapchains[0];
+	uint32_t                    img_id;
+	XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+	{ FramePhaseScope t(FP_SwapchainAcquire); xrAcquireSwapchainImage(swapchain.handle, &acquire_info, &img_id); }
+
+	XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+	wait_info.timeout = XR_INFINITE_DURATION;
+	{ FramePhaseScope t(FP_SwapchainWait); xrWaitSwapchainImage(swapchain.handle, &wait_info); }
+
+	for (uint32_t i = 0; i < view_count; i++) {
 		views[i] = { XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW };
 		views[i].pose = xr_views[i].pose;
 		views[i].fov = xr_views[i].fov;
-		views[i].subImage.swapchain = xr_swapchains[i].handle;
+		views[i].subImage.swapchain = swapchain.handle;
+		views[i].subImage.imageArrayIndex = xr_stereo.ViewArrayIndex(i);
 		views[i].subImage.imageRect.offset = { 0, 0 };
-		views[i].subImage.imageRect.extent = { xr_swapchains[i].width, xr_swapchains[i].height };
+		views[i].subImage.imageRect.extent = openxr_render_extent(swapchain);
+	}
+
+	if (xr_late_latch)
+		openxr_late_latch(predictedTime, views, 0, view_count);
+	d3d_latch_poses(xr_input.handPose, xr_input.renderHand);
+	for (uint32_t i = 0; i < view_count; i++)
+		d3d_prepare_view(i, views[i]);
+
+	{
+		FramePhaseScope t(FP_RenderEye0);
+		const uint64_t  start = FrameTimer::Now();
+		d3d_render_layer_stereo(views, view_count, swapchain.surface_data[img_id]);
+		xr_render_cpu_ns += FrameTimer::Now() - start;
+	}
+
+	XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+	{ FramePhaseScope t(FP_SwapchainRelease); xrReleaseSwapchainImage(swapchain.handle, &release_info); }
+}
+
+bool openxr_render_layer(XrTime predictedTime, XrCompositionLayerProjectionView* views, uint32_t view_capacity, XrCompositionLayerProjection& layer) {
+	uint32_t         view_count = 0;
+	XrViewState      view_state = { XR_TYPE_VIEW_STATE };
+	XrViewLocateInfo locate_info = { XR_TYPE_VIEW_LOCATE_INFO };
+	locate_info.viewConfigurationType = app_config_view;
+	locate_info.displayTime = predictedTime;
+	locate_info.space = xr_app_space;
+	xrLocateViews(xr_session, &locate_info, &view_state, (uint32_t)xr_views.size(), &view_count, xr_views.data());
+	if (view_count > view_capacity)
+		return false;
 
-		d3d_render_layer(views[i], xr_swapchains[i].surface_data[img_id]);
+	if (xr_late_latch)
+		openxr_late_latch_hands(predictedTime);
+	app_update_latched();
+
+	if (xr_stereo.singlePass) {
+		openxr_render_stereo(predictedTime, views, view_count);
+	} else {
+		for (uint32_t i = 0; i < view_count; i++) {
+			uint32_t                    img_id;
+			XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+			{ FramePhaseScope t(FP_SwapchainAcquire); xrAcquireSwapchainImage(xr_swapchains[i].handle, &acquire_info, &img_id); }
+
+			XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+			wait_info.timeout = XR_INFINITE_DURATION;
+			{ FramePhaseScope t(FP_SwapchainWait); xrWaitSwapchainImage(xr_swapchains[i].handle, &wait_info); }
+
+			views[i] = { XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW };
+			views[i].pose = xr_views[i].pose;
+			views[i].fov = xr_views[i].fov;
+			views[i].subImage.swapchain = xr_swapchains[i].handle;
+			views[i].subImage.imageRect.offset = { 0, 0 };
+			views[i].subImage.imageRect.extent = openxr_render_extent(xr_swapchains[i]);
+
+			// Hand poses reach the GPU through the latch constants (b2), uploaded per pass (the
+			// same pose for every pass, latched above)
+			if (xr_late_latch)
+				openxr_late_latch(predictedTime, views, i, 1);
+			d3d_latch_poses(xr_input.handPose, xr_input.renderHand);
+			d3d_prepare_view(i, views[i]);
+
+			{
+				FramePhaseScope t(i == 0 ? FP_RenderEye0 : FP_RenderEye1);
+				const uint64_t  start = FrameTimer::Now();
+				d3d_render_layer(i, views[i], xr_swapchains[i].surface_data[img_id]);
+				xr_render_cpu_ns += FrameTimer::Now() - start;
+			}
 
-		XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
-		xrReleaseSwapchainImage(xr_swapchains[i].handle, &release_info);
+			XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+			{ FramePhaseScope t(FP_SwapchainRelease); xrReleaseSwapchainImage(xr_swapchains[i].handle, &release_info); }
+		}
 	}
 
 	layer.space = xr_app_space;
-	layer.viewCount = (uint32_t)views.size();
-	layer.views = views.data();
+	layer.viewCount = view_count;
+	layer.views = views;
 	return true;
 }
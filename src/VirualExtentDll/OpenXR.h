@@ -11,6 +11,7 @@
 #include <d3d11.h>
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
+#include <atomic>
 #include <vector>
 
 #include "controller_config.h"
@@ -59,8 +60,14 @@ struct input_state_t {
 // OpenXR globals that the app (or D3D code) needs to see
 extern const XrPosef  xr_pose_identity;
 extern input_state_t  xr_input;
-extern XrSessionState xr_session_state;
+extern std::atomic<XrSessionState> xr_session_state; // written by the event loop, read by the input thread
+extern XrTime         xr_session_state_time; // runtime time of the last state change
 extern bool           xr_running;
+extern bool           xr_quad_layer_mode; // desktop goes out as its own quad layer instead of being drawn into the projection
+extern bool           xr_late_latch;      // re-locate hands before the first pass, views before each pass
+extern bool           xr_single_pass;     // render both eyes in one instanced pass (off by default; set before openxr_init; falls back if unsupported)
+extern bool           xr_dynamic_resolution; // scale the submitted imageRect to keep frame time within budget (off by default)
+extern bool           xr_pipelined_frames; // xrWaitFrame/xrBeginFrame on a pacer thread, overlapping the previous frame's rendering
 
 // OpenXR API
 bool openxr_init(const char* app_name, int64_t swapchain_format);
@@ -69,5 +76,11 @@ void openxr_shutdown();
 void openxr_poll_events(bool& exit);
 void openxr_poll_predicted(XrTime predicted_time);
 void openxr_render_frame();
-bool openxr_render_layer(XrTime predictedTime, std::vector<XrCompositionLayerProjectionView>& projectionViews, XrCompositionLayerProjection& layer);
-void poll_controller_profile(ControllerProfile& profile);
\ No newline at end of file
+bool openxr_render_layer(XrTime predictedTime, XrCompositionLayerProjectionView* views, uint32_t view_capacity, XrCompositionLayerProjection& layer);
+bool openxr_quad_update(ID3D11Texture2D* src);
+bool openxr_quad_layer(XrCompositionLayerQuad& layer);
+float    openxr_resolution_scale();    // current fraction of the allocated size, per axis
+uint64_t openxr_resolution_changes();
+// Syncs actions and evaluates the profile; states (optional) receives what was read for the
+// first `capacity` inputs
+void poll_controller_profile(CompiledProfile& profile, CompiledInputState* states = nullptr, uint32_t capacity = 0);
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "alloc_audit.h"
+
+#ifdef VE_ALLOC_AUDIT
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static thread_local uint64_t s_threadCount = 0;
+static std::atomic<uint64_t> s_totalCount{ 0 };
+
+static void* audit_alloc(size_t size, size_t align) {
+    s_threadCount++;
+    s_totalCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return malloc(size);
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    return aligned_alloc(align, (size + align - 1) & ~(align - 1));
+#endif
+}
+
+static void audit_free_aligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// The array and nothrow forms of the CRT forward to these, so they are counted too
+void* operator new(size_t size) {
+    if (void* p = audit_alloc(size, 0)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t align) {
+    if (void* p = audit_alloc(size, (size_t)align)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t align) noexcept {
+    if ((size_t)align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) audit_free_aligned(p); else free(p);
+}
+void operator delete(void* p, size_t, std::align_val_t align) noexcept { operator delete(p, align); }
+
+bool     alloc_audit_enabled() { return true; }
+uint64_t alloc_audit_thread_count() { return s_threadCount; }
+uint64_t alloc_audit_total_count() { return s_totalCount.load(std::memory_order_relaxed); }
+
+#else
+
+bool     alloc_audit_enabled() { return false; }
+uint64_t alloc_audit_thread_count() { return 0; }
+uint64_t alloc_audit_total_count() { return 0; }
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+// Heap allocation counter for checking that the steady-state frame loop does not allocate.
+//
+// Building with VE_ALLOC_AUDIT defined replaces the global operator new/delete of this dll with
+// counting versions. Without it the counters stay at zero and alloc_audit_enabled() is false.
+// Every thread of the frame loop counts its own: the render thread in ve_run, the input thread
+// in InputThread (tests/alloc_audit_test runs the same bookkeeping on Linux).
+
+bool     alloc_audit_enabled();
+
+// operator new calls made by the calling thread / by all threads, since the dll was loaded
+uint64_t alloc_audit_thread_count();
+uint64_t alloc_audit_total_count();
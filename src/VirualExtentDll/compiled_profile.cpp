@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "controller_config.h"
+
+#include <cstdio>
+#include <unordered_map>
+
+// The platform-independent half of controller_config: compiling a ControllerProfile and
+// evaluating values against its mappings. What the commands do is run_input_command's business
+// (controller_config.cpp), so this builds and runs on its own in tests/.
+
+// Resolves an action name of mapping m to a command. Keys and wheel amounts come from the mapping
+// (load_controller_config copies threshold keys up to it), as they always have.
+static InputCommand compile_action(const MappingAction& m, const std::string& act) {
+    InputCommand cmd;
+    if (act == "mouse_scrool_down" || act == "mouse_scrool_up") {
+        int amount = m.amount_down.has_value() ? m.amount_down.value() : 120;
+        cmd = { InputOp::MouseWheel, act == "mouse_scrool_up" ? amount : -amount };
+    }
+    else if (act == "left_mouse_down")  cmd = { InputOp::MouseDown, 0 };
+    else if (act == "right_mouse_down") cmd = { InputOp::MouseDown, 1 };
+    else if (act == "left_mouse_up")    cmd = { InputOp::MouseUp, 0 };
+    else if (act == "right_mouse_up")   cmd = { InputOp::MouseUp, 1 };
+    else if (act == "key_down") {
+        if (m.key_down.has_value()) cmd = { InputOp::KeyDown, m.key_down.value() };
+    }
+    else if (act == "key_up") {
+        if (m.key_up.has_value()) cmd = { InputOp::KeyUp, m.key_up.value() };
+    }
+    else if (act == "key_tap") {
+        // "amount" is how long the key is held, in ms
+        uint32_t hold = m.amount_down.has_value() && m.amount_down.value() > 0 ? (uint32_t)m.amount_down.value() : 100;
+        if (m.key_down.has_value()) cmd = { InputOp::KeyTap, m.key_down.value(), hold };
+    }
+    else {
+        const std::string msg = "Unknown action: " + act + " (" + m.name + ")\n";
+#ifdef _WIN32
+        OutputDebugStringA(msg.c_str());
+#else
+        fputs(msg.c_str(), stderr);
+#endif
+    }
+    return cmd;
+}
+
+static CompiledMapping::Threshold compile_threshold(const MappingAction& m, const std::optional<MappingAction::ThresholdAction>& ta) {
+    CompiledMapping::Threshold t;
+    if (ta.has_value()) {
+        t.value = ta->value;
+        t.cmd = compile_action(m, ta->action);
+    }
+    return t;
+}
+
+void compile_controller_profile(const ControllerProfile& profile, const XrPath handSubactionPath[2], CompiledProfile& out) {
+    out.map.clear();
+    out.map.reserve(profile.map.size());
+
+    for (const MappingAction& m : profile.map) {
+        CompiledMapping c;
+        c.action = m.xr_action;
+        c.path = m.xr_path;
+        c.type = m.xr_actionType;
+        c.space = m.xr_space;
+        c.hand = m.name.starts_with("/user/hand/left") ? 0 : 1;
+        c.subaction = handSubactionPath[c.hand];
+        if (m.is_x.has_value()) c.axis = m.is_x.value() ? 0 : 1;
+
+        if (m.if_down_action.has_value()) c.on_down = compile_action(m, m.if_down_action.value());
+        if (m.if_up_action.has_value())   c.on_up = compile_action(m, m.if_up_action.value());
+        c.passed_over = compile_threshold(m, m.if_passed_over);
+        c.passed_under = compile_threshold(m, m.if_passed_under);
+        c.over = compile_threshold(m, m.if_over);
+        c.under = compile_threshold(m, m.if_under);
+
+        out.map.push_back(c);
+    }
+
+    // Group by input path so the poll queries each input once. Every path has its own action
+    // (openxr_generate_actions), and paths are interned, so the XrPath is the key: one hash
+    // lookup per mapping. Mappings without an action, and vector2 mappings without an axis, are
+    // never evaluated and get no entry.
+    out.inputs.clear();
+    out.fanout.clear();
+    std::unordered_map<XrPath, uint32_t> inputOf;   // path -> index into out.inputs
+    std::vector<uint32_t> inputOfMapping(out.map.size(), UINT32_MAX);
+    inputOf.reserve(out.map.size());
+    for (uint32_t i = 0; i < (uint32_t)out.map.size(); i++) {
+        const CompiledMapping& c = out.map[i];
+        if (c.action == XR_NULL_HANDLE || (c.type == XR_ACTION_TYPE_VECTOR2F_INPUT && c.axis < 0))
+            continue;
+        auto [it, added] = inputOf.try_emplace(c.path, (uint32_t)out.inputs.size());
+        if (added) {
+            CompiledInput in;
+            in.action = c.action;
+            in.subaction = c.subaction;
+            in.type = c.type;
+            out.inputs.push_back(in);
+        }
+        out.inputs[it->second].count++;
+        inputOfMapping[i] = it->second;
+    }
+
+    // Counting sort of the mapping indices by input: grouped, and in map order within a group
+    uint32_t next = 0;
+    for (CompiledInput& in : out.inputs) {
+        in.first = next;
+        next += in.count;
+    }
+    out.fanout.resize(next);
+    std::vector<uint32_t> fill(out.inputs.size(), 0);
+    for (uint32_t i = 0; i < (uint32_t)out.map.size(); i++) {
+        const uint32_t k = inputOfMapping[i];
+        if (k != UINT32_MAX)
+            out.fanout[out.inputs[k].first + fill[k]++] = i;
+    }
+}
+
+void deal_with_bool_action(const CompiledMapping& m, bool state) {
+    run_input_command(state ? m.on_down : m.on_up);
+}
+
+void deal_with_float_action(const CompiledMapping& m, float value, float last_value) {
+    // Passed over threshold (value increased past boundary)
+    if (m.passed_over.cmd.op != InputOp::None && last_value < m.passed_over.value && value >= m.passed_over.value)
+        run_input_command(m.passed_over.cmd);
+
+    // Passed under threshold (value decreased past boundary)
+    if (m.passed_under.cmd.op != InputOp::None && last_value > m.passed_under.value && value <= m.passed_under.value)
+        run_input_command(m.passed_under.cmd);
+
+    // This function is only called when value changes, so the over and under might not allways be called unless teh user is moving the stick
+    if (m.over.cmd.op != InputOp::None && value >= m.over.value)
+        run_input_command(m.over.cmd);
+
+    if (m.under.cmd.op != InputOp::None && value <= m.under.value)
+        run_input_command(m.under.cmd);
+}
+
+bool fan_out_input(CompiledProfile& profile, uint32_t n, XrVector2f value) {
+    const CompiledInput& in = profile.inputs[n];
+    bool changed = false;
+    for (uint32_t k = in.first; k < in.first + in.count; k++) {
+        CompiledMapping& m = profile.map[profile.fanout[k]];
+        if (in.type == XR_ACTION_TYPE_BOOLEAN_INPUT) {
+            const bool state = value.x != 0.0f;
+            if (state == m.last_bool) continue;
+            deal_with_bool_action(m, state);
+            m.last_bool = state;
+        }
+        else {
+            const float v = m.axis == 1 ? value.y : value.x;
+            if (v == m.last_float) continue;
+            deal_with_float_action(m, v, m.last_float);
+            m.last_float = v;
+        }
+        changed = true;
+    }
+    return changed;
+}
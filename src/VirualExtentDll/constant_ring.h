@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Suballocates constant data from one large buffer, front to back, wrapping when it runs out.
+//
+// Plain C++ with no D3D dependency; D3D.cpp maps the real buffer from what Alloc reports. Ranges
+// handed out since the last wrap are never reused, so they can be written with
+// MAP_WRITE_NO_OVERWRITE while the GPU still reads earlier ones. A wrap is the point to map with
+// MAP_WRITE_DISCARD, which gives the driver a fresh buffer instead of waiting for the GPU.
+class ConstantRing {
+public:
+    static constexpr uint32_t kAlignment = 256;   // constant buffer offsets are multiples of 16 constants
+
+    void Init(uint32_t capacity) { capacity_ = capacity; head_ = capacity; allocs_ = wraps_ = 0; }
+
+    // Reserves `bytes` (rounded up to kAlignment). False if it can never fit.
+    // *outDiscard is set when this allocation wrapped, and the buffer must be discarded first.
+    bool Alloc(uint32_t bytes, uint32_t* outOffset, uint32_t* outSize, bool* outDiscard) {
+        const uint32_t size = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+        if (size == 0 || size > capacity_) return false;
+        *outDiscard = false;
+        if (head_ + size > capacity_) {
+            head_ = 0;
+            wraps_++;
+            *outDiscard = true;
+        }
+        *outOffset = head_;
+        *outSize = size;
+        head_ += size;
+        allocs_++;
+        return true;
+    }
+
+    uint32_t Capacity() const { return capacity_; }
+    uint64_t Allocs() const { return allocs_; }
+    uint64_t Wraps() const { return wraps_; }
+
+private:
+    uint32_t capacity_ = 0;
+    uint32_t head_ = 0;       // starts at capacity_, so the first allocation discards
+    uint64_t allocs_ = 0;
+    uint64_t wraps_ = 0;
+};
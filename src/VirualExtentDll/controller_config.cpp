@@ -1,5 +1,9 @@
 #include "pch.h"
 #include "controller_config.h"
+#include "input_injection.h"
+#include "key_scheduler.h"
+#include "frame_timing.h" // FrameTimer::Now
+#include "interaction.h"
 #include "nlohmann/json.hpp"
 #include <fstream>
 #include <iostream>
@@ -50,178 +54,82 @@ void print_controller_map(const ControllerProfile& profile) {
 
 
 
-static bool NeedsExtended(WORD vk) {
-    switch (vk) {
-    case VK_INSERT: case VK_DELETE: case VK_HOME: case VK_END:
-    case VK_PRIOR:  case VK_NEXT:   // PageUp/PageDown
-    case VK_RIGHT:  case VK_LEFT:   case VK_UP:   case VK_DOWN:
-    case VK_NUMLOCK: case VK_DIVIDE: case VK_RMENU: case VK_RCONTROL:
-        // NOTE: main Enter is not extended; numpad Enter would be, but shares VK_RETURN.
-        // If you specifically want numpad Enter-as-extended, set the flag yourself.
-        return true;
-    default: return false;
-    }
-}
-
-static void SendKeyDown_Scan(WORD vk) {
-    HKL kl = GetKeyboardLayout(0);
-    UINT sc = MapVirtualKeyEx(vk, MAPVK_VK_TO_VSC_EX, kl);
-    if (sc == 0) return;
-    DWORD flags = KEYEVENTF_SCANCODE | (NeedsExtended(vk) ? KEYEVENTF_EXTENDEDKEY : 0);
-
-    INPUT in{}; in.type = INPUT_KEYBOARD;
-    in.ki.wScan = (WORD)sc;
-    in.ki.dwFlags = flags;
-    SendInput(1, &in, sizeof(in));
-}
-
-static void MouseClick(bool right) {
-    INPUT inputs[2]{};
-    inputs[0].type = INPUT_MOUSE;
-    inputs[1].type = INPUT_MOUSE;
-    inputs[0].mi.dwFlags = right ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_LEFTDOWN;
-    inputs[1].mi.dwFlags = right ? MOUSEEVENTF_RIGHTUP : MOUSEEVENTF_LEFTUP;
-    SendInput(2, inputs, sizeof(INPUT));
-}
-
-static void MouseDown(bool right) {
-    INPUT input = {};
-    input.type = INPUT_MOUSE;
-    input.mi.dwFlags = right ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_LEFTDOWN;
-    SendInput(1, &input, sizeof(INPUT));
-}
-
-static void MouseUp(bool right) {
-    INPUT input = {};
-    input.type = INPUT_MOUSE;
-    input.mi.dwFlags = right ? MOUSEEVENTF_RIGHTUP : MOUSEEVENTF_LEFTUP;
-    SendInput(1, &input, sizeof(INPUT));
-}
-
-static void SendWheel(int wheelDelta) {
-
-    INPUT in{};
-    in.type = INPUT_MOUSE;
-    in.mi.dwFlags = MOUSEEVENTF_WHEEL;
-    in.mi.mouseData = wheelDelta; // +120 = scroll up, -120 = scroll down
-    SendInput(1, &in, sizeof(INPUT));
+// Mouse events go where the pointer is: move the OS cursor there first unless it already is.
+// SetCursorPos, like the hover warp, places it on the exact pixel (an absolute SendInput move
+// is rounded through 0..65535). Events queued earlier this tick were meant for where the cursor
+// is now, so they go out first; after the first warp of a tick the cursor is already there.
+static void WarpCursorForInjection() {
+    POINT cursor{};
+    if (!GetCursorPos(&cursor))
+        return;
+    int32_t x, y;
+    if (!g_cursor_warp.BeforeInjection(cursor.x, cursor.y, &x, &y))
+        return;
+    if (g_input.Pending())
+        g_input.Flush();
+    SetCursorPos(x, y);
 }
 
-static void SendKeyUp_Scan(WORD vk) {
-    HKL kl = GetKeyboardLayout(0);
-    UINT sc = MapVirtualKeyEx(vk, MAPVK_VK_TO_VSC_EX, kl);
-    if (sc == 0) return;
-    DWORD flags = KEYEVENTF_SCANCODE | KEYEVENTF_KEYUP | (NeedsExtended(vk) ? KEYEVENTF_EXTENDEDKEY : 0);
-
-    INPUT in{}; in.type = INPUT_KEYBOARD;
-    in.ki.wScan = (WORD)sc;
-    in.ki.dwFlags = flags;
-    SendInput(1, &in, sizeof(in));
+// Key-tap releases of this poll; timed from when the presses were actually submitted
+struct PendingRelease {
+    InjectedEvent up;
+    uint32_t      hold_ms;
+};
+static PendingRelease s_releases[32];
+static uint32_t       s_releaseCount = 0;
+
+static void QueueKeyTap(uint16_t vk, uint32_t hold_ms) {
+    InjectedEvent up;
+    if (!input_key_vk(g_input, vk, true) || !input_key_event(vk, false, &up))
+        return;
+    if (s_releaseCount == _countof(s_releases))
+        flush_input_commands();
+    s_releases[s_releaseCount++] = { up, hold_ms };
 }
 
-void handle_action(const MappingAction& m, std::string act) {
-
-    std::stringstream ss; ss << "Handling action: " << act << "\n"; OutputDebugStringA(ss.str().c_str());
-    if (act == "mouse_scrool_down") {
-        int amount = 120;
-        if (m.amount_down.has_value()) {
-            amount = m.amount_down.value();
-		}
-        SendWheel(-amount); // Left down
-    }
-    else if (act == "mouse_scrool_up") {
-        int amount = 120;
-        if (m.amount_down.has_value()) {
-            amount = m.amount_down.value();
-        }
-        SendWheel(amount);  // Right down
-    }
-    if (act == "left_mouse_down") {
-        MouseDown(false); // Left down
-    }
-    else if (act == "right_mouse_down") {
-        MouseDown(true);  // Right down
-    }
-    if (act == "left_mouse_up") {
-        MouseUp(false); // Left down
-    }
-    else if (act == "right_mouse_up") {
-        MouseUp(true);  // Right down
-    }
-    else if (act == "key_down") {
-        if (m.key_down.has_value()) {
-            SendKeyDown_Scan((WORD)m.key_down.value());
+void flush_input_commands() {
+    g_input.Flush();
+    if (s_releaseCount == 0)
+        return;
+
+    const uint64_t now = FrameTimer::Now();
+    bool late = false;
+    for (uint32_t i = 0; i < s_releaseCount; i++) {
+        // Without the scheduler (not started, or full) release at once rather than never
+        if (!g_key_scheduler.Schedule(now + (uint64_t)s_releases[i].hold_ms * 1000000ull, s_releases[i].up)) {
+            g_input.Queue(s_releases[i].up);
+            late = true;
         }
     }
-    else if (act == "key_up") {
-        if (m.key_up.has_value()) {
-            SendKeyUp_Scan((WORD)m.key_up.value());
-        }
-    }    
-    else {
-        OutputDebugStringA(("Unknown down action: " + act + "\n").c_str());
-    }
+    s_releaseCount = 0;
+    if (late)
+        g_input.Flush();
 }
 
-void deal_with_bool_action(const MappingAction& m, bool state) {
-    if (state) {
-        
-
-        // Handle down
-        if (m.if_down_action.has_value()) {
-            const std::string& act = m.if_down_action.value();
-            handle_action(m, act);
-        }
-    }
-    else {
-        // Handle down
-        if (m.if_up_action.has_value()) {
-            const std::string& act = m.if_up_action.value();
-            handle_action(m, act);
-        }
+// Queues the command on g_input; poll_controller_profile flushes once it evaluated every mapping
+void run_input_command(const InputCommand& cmd) {
+    switch (cmd.op) {
+    case InputOp::MouseWheel:
+        WarpCursorForInjection();
+        g_input.MouseWheel(cmd.arg);
+        break;
+    case InputOp::MouseDown:
+        WarpCursorForInjection();
+        g_input.MouseButton(cmd.arg != 0, true);
+        g_cursor_warp.ButtonDown();
+        break;
+    case InputOp::MouseUp:
+        WarpCursorForInjection();
+        g_input.MouseButton(cmd.arg != 0, false);
+        g_cursor_warp.ButtonUp();
+        break;
+    case InputOp::KeyDown:    input_key_vk(g_input, (uint16_t)cmd.arg, true);  break;
+    case InputOp::KeyUp:      input_key_vk(g_input, (uint16_t)cmd.arg, false); break;
+    case InputOp::KeyTap:     QueueKeyTap((uint16_t)cmd.arg, cmd.hold_ms);     break;
+    default:                                                                   break;
     }
 }
 
-void deal_with_float_action(const MappingAction& m, float value, float last_value) {
-
-
-    //std::stringstream ss; ss << "Handling float action for " << m.name << " with value " << value << " (last: " << last_value << ")\n"; OutputDebugStringA(ss.str().c_str());
-
-    // Passed over threshold (value increased past boundary)
-    if (m.if_passed_over.has_value()) {
-        const auto& over = m.if_passed_over.value();
-        if (last_value < over.value && value >= over.value) {
-            handle_action(m, over.action);
-        }
-    }
-
-    // Passed under threshold (value decreased past boundary)
-    if (m.if_passed_under.has_value()) {
-        const auto& under = m.if_passed_under.value();
-        if (last_value > under.value && value <= under.value) {
-            handle_action(m, under.action);
-        }
-    }
-    
-	// This function is only called when value changes, so the over and under might not allways be called unless teh user is moving the stick
-    // is over threshold (value increased past boundary)
-    if (m.if_over.has_value()) {
-        const auto& over = m.if_over.value();
-        if (value >= over.value) {
-            handle_action(m, over.action);
-        }
-    }
-    
-    // is over threshold (value decreased past boundary)
-    if (m.if_under.has_value()) {
-        const auto& under = m.if_under.value();
-        if (value <= under.value) {
-            handle_action(m, under.action);
-        }
-    }
-}
-
-
 bool load_controller_config(const std::string& path, ControllerConfig& outConfig) {
     std::ifstream file(path);
     if (!file.is_open()) {
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <cstdint>
 #include <openxr/openxr.h>
 
 struct MappingAction {
@@ -12,10 +13,6 @@ struct MappingAction {
     XrActionType xr_actionType;
     XrBool32 xr_boolean = XR_FALSE;
     XrSpace xr_space = XR_NULL_HANDLE;
-    XrPosef xr_posef = { {0, 0, 0, 1}, {0, 0, 0} };
-
-	bool last_bool_state = false;
-	float last_float_state = 0.0f;
 
     std::optional<std::string> type;
     std::optional<bool> is_x;
@@ -55,8 +52,88 @@ struct ControllerConfig {
     std::vector<ControllerProfile> controller_maps;
 };
 
+// ---------- Compiled profile ----------
+// A ControllerProfile flattened once at load time, so the per-poll evaluator only does
+// integer/float compares: action names become opcodes, keys and amounts are resolved and
+// the hand of each mapping is known up front.
+
+enum class InputOp : uint8_t {
+    None,             // nothing to do (absent, or a key action without a key)
+    MouseWheel,       // arg = wheel delta (+ up, - down)
+    MouseDown,        // arg = 0 left, 1 right
+    MouseUp,          // arg = 0 left, 1 right
+    KeyDown,          // arg = virtual-key code
+    KeyUp,            // arg = virtual-key code
+    KeyTap,           // arg = virtual-key code, down now and up hold_ms later
+};
+
+struct InputCommand {
+    InputOp  op = InputOp::None;
+    int32_t  arg = 0;
+    uint32_t hold_ms = 0;     // KeyTap
+};
+
+struct CompiledMapping {
+    XrAction     action = XR_NULL_HANDLE;
+    XrPath       path = XR_NULL_PATH;       // input path the action is bound to (interned)
+    XrPath       subaction = XR_NULL_PATH;
+    XrActionType type = XR_ACTION_TYPE_BOOLEAN_INPUT;
+    XrSpace      space = XR_NULL_HANDLE;
+    uint8_t      hand = 1;         // 0 left, 1 right
+    int8_t       axis = -1;        // vector2 inputs: 0 x, 1 y, -1 not evaluated (no is_x)
+
+    InputCommand on_down, on_up;   // boolean edges
+
+    // Float thresholds (op None when the mapping has none)
+    struct Threshold {
+        float        value = 0.0f;
+        InputCommand cmd;
+    };
+    Threshold passed_over, passed_under, over, under;
+
+    // Evaluator state
+    bool    last_bool = false;
+    float   last_float = 0.0f;
+};
+
+// One polled input (an action on a hand) and the mappings its state fans out to
+struct CompiledInput {
+    XrAction     action = XR_NULL_HANDLE;
+    XrPath       subaction = XR_NULL_PATH;
+    XrActionType type = XR_ACTION_TYPE_BOOLEAN_INPUT;
+    uint32_t     first = 0;        // into CompiledProfile::fanout
+    uint32_t     count = 0;
+};
+
+// What the last poll read for one CompiledInput (same index). This is what other threads get
+// to see of the input state: the evaluator state in CompiledMapping belongs to the polling thread.
+struct CompiledInputState {
+    XrVector2f value = { 0, 0 };              // boolean: x 0/1, float: x, vector2: x/y
+    XrPosef    pose = { {0, 0, 0, 1}, {0, 0, 0} };  // pose inputs, when located
+    XrTime     changed = 0;                   // runtime time of the last change
+    bool       active = false;
+};
+
+struct CompiledProfile {
+    std::vector<CompiledMapping> map;      // same order as ControllerProfile::map
+    std::vector<CompiledInput>   inputs;   // one per distinct input path, in order of first use
+    std::vector<uint32_t>        fanout;   // map indices, grouped by input, in map order
+};
+
 // Function declaration
 bool load_controller_config(const std::string& path, ControllerConfig& outConfig);
 void print_controller_map(const ControllerProfile& profile);
-void deal_with_float_action(const MappingAction& m, float value, float last_value);
-void deal_with_bool_action(const MappingAction& m, bool state);
\ No newline at end of file
+
+// compiled_profile.cpp. Call after the profile's actions were created; handSubactionPath =
+// /user/hand/left, /user/hand/right
+void compile_controller_profile(const ControllerProfile& profile, const XrPath handSubactionPath[2], CompiledProfile& out);
+void deal_with_float_action(const CompiledMapping& m, float value, float last_value);
+void deal_with_bool_action(const CompiledMapping& m, bool state);
+// A new state of profile.inputs[n] (boolean: x 0/1, float: x, vector2: x/y), evaluated against
+// every mapping bound to it in map order; each keeps its own edge and threshold state. Not for
+// pose inputs. True if any mapping saw a change.
+bool fan_out_input(CompiledProfile& profile, uint32_t n, XrVector2f value);
+// Queue on g_input (input_injection.h); poll_controller_profile submits them once per poll with
+// flush_input_commands, which also hands key-tap releases to g_key_scheduler
+void run_input_command(const InputCommand& cmd);
+void flush_input_commands();
\ No newline at end of file
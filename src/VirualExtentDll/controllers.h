@@ -5,8 +5,14 @@
 bool Controllers_Init();
 
 
-// Draws both hands (if active) for the current eye view
-void Controllers_Draw(const XrCompositionLayerProjectionView& view);
+// Once per frame after the hands are late-latched, before the first pass: pointer rays and
+// desktop hits into g_interaction, and the cursor warp for the hand that points at the desktop
+void Controllers_UpdateInteraction();
+
+// Draws both hands (if active) for the views of the current pass
+void Controllers_Draw(const XrCompositionLayerProjectionView* views, uint32_t viewCount);
+// True: the parts of a hand overlap and need the depth test
+bool Controllers_NeedsDepth();
 
 // Release all resources
 void Controllers_Shutdown();
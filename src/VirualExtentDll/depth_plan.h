@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+// Depth buffers of the projection swapchains: one per swapchain, shared by all of its images
+// (only one image is ever being rendered), or none at all when nothing drawn into the
+// projection layer depth tests.
+//
+// Plain C++ so the sizing can be checked without a GPU. ve_run decides from the modules app_draw
+// draws (d3d_depth_required); openxr_init plans each swapchain with PlanDepth.
+
+// One module drawn by app_draw
+struct DepthUser {
+    bool drawn;       // drawn into the projection layer in this configuration
+    bool depthTest;   // its geometry needs the depth test to come out right
+};
+
+inline bool DepthRequired(const DepthUser* users, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        if (users[i].drawn && users[i].depthTest)
+            return true;
+    return false;
+}
+
+struct DepthPlan {
+    uint32_t textures = 0;
+    uint64_t bytes = 0;
+    uint64_t savedBytes = 0;   // compared to a depth buffer per image
+};
+
+// D32 depth for an image of width x height x arraySize, swapchain of imageCount images
+inline DepthPlan PlanDepth(uint32_t width, uint32_t height, uint32_t arraySize, uint32_t imageCount, bool required) {
+    const uint64_t one = (uint64_t)width * height * arraySize * 4;
+    DepthPlan plan;
+    plan.textures = required && imageCount > 0 ? 1 : 0;
+    plan.bytes = plan.textures * one;
+    plan.savedBytes = (uint64_t)imageCount * one - plan.bytes;
+    return plan;
+}
@@ -1,59 +1,105 @@
 ﻿#include "pch.h"
 #define WIN32_LEAN_AND_MEAN
 #include "desktop_capture.h"
+#include "env_var.h"
 
 #include <cstdio>
+#include <chrono>
 #include <Windows.h> // GetTickCount64
 
 using Microsoft::WRL::ComPtr;
 
-bool DesktopCapture::Init(ID3D11Device* device, IDXGIAdapter1* adapter, int outputIndex) {
+bool DesktopCapture::Init(ID3D11Device* device, IDXGIAdapter1* adapter, int outputIndex, uint32_t timeoutMs) {
     if (!device || !adapter) return false;
 
-    device_ = device;       // cache for recovery
+    renderDevice_ = device;
     adapter_ = adapter;     // cache for recovery
     outputIndex_ = outputIndex;
+    timeoutMs_ = timeoutMs;
+
+    // A device of our own for duplication and copies, so the capture thread never needs the
+    // render thread's immediate context. Duplication requires it to be on the output's adapter.
+    const D3D_FEATURE_LEVEL levels[] = { D3D_FEATURE_LEVEL_11_1, D3D_FEATURE_LEVEL_11_0 };
+    if (FAILED(D3D11CreateDevice(adapter, D3D_DRIVER_TYPE_UNKNOWN, nullptr, D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+            levels, _countof(levels), D3D11_SDK_VERSION, &device_, nullptr, &ctx_))) {
+        renderDevice_.Reset();
+        adapter_.Reset();
+        return false;
+    }
 
     if (!tryCreateDuplication())
         return false;
 
-    // Reset cached *dimensions* so we recreate texture on first Acquire.
-    w_ = h_ = 0;
-    fmt_ = DXGI_FORMAT_B8G8R8A8_UNORM;
-    texSR_.Reset();
-    srv_.Reset();
+    // Empty ring; slot textures are (re)created on the first frame of each size/format.
+    for (int i = 0; i < 3; i++) ring_.Slot(i) = Slot{};
+    ring_.Reset();
+    history_.Reset(0, 0);
+    frameCounter_ = 0;
+    histW_ = histH_ = 0;
+    bytesCopied_ = 0;
+    bytesFull_ = 0;
+
+    // Optional: record the rect stream for tests/dirty_rects_bench
+    const std::string log = env_var("VE_DIRTY_RECT_LOG");
+    if (!log.empty() && fopen_s(&rectLog_, log.c_str(), "w") != 0)
+        rectLog_ = nullptr;
 
     needRecreateDup_ = false;
     retryBackoffMs_ = 250;
     nextRetryMs_ = 0;
+
+    stop_ = false;
+    thread_ = std::thread(&DesktopCapture::captureThread, this);
     return true;
 }
 
 void DesktopCapture::Shutdown() {
-    srv_.Reset();
-    texSR_.Reset();
+    {
+        std::lock_guard<std::mutex> lk(stopMutex_);
+        stop_ = true;
+    }
+    stopCv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+
+    if (held_) {
+        held_->ReleaseSync(0);
+        held_.Reset();
+    }
+    for (int i = 0; i < 3; i++) ring_.Slot(i) = Slot{};
+    ring_.Reset();
+    history_.Reset(0, 0);
+    metaBuf_.clear();
+    if (rectLog_) {
+        fclose(rectLog_);
+        rectLog_ = nullptr;
+    }
     dup_.Reset();
+    ctx_.Reset();
     device_.Reset();
+    renderDevice_.Reset();
     adapter_.Reset();
-    w_ = h_ = 0;
-    fmt_ = DXGI_FORMAT_B8G8R8A8_UNORM;
     outputIndex_ = 0;
     needRecreateDup_ = false;
     retryBackoffMs_ = 250;
     nextRetryMs_ = 0;
 }
 
+void DesktopCapture::GetCopyStats(uint64_t* outCopiedBytes, uint64_t* outFullBytes) const {
+    if (outCopiedBytes) *outCopiedBytes = bytesCopied_.load(std::memory_order_relaxed);
+    if (outFullBytes) *outFullBytes = bytesFull_.load(std::memory_order_relaxed);
+}
+
 void DesktopCapture::NotifyDisplayModeChange() {
-    // Don’t nuke the SRV; keep last good frame visible.
+    // Don’t nuke the ring; keep last good frame visible. The capture thread retries right away.
     needRecreateDup_ = true;
-    // retry soon
-    nextRetryMs_ = GetTickCount64();
-    retryBackoffMs_ = 250;
 }
 
-bool DesktopCapture::recreateTexture(ID3D11Device* device, uint32_t w, uint32_t h, DXGI_FORMAT fmt) {
-    // Create NEW resources and then swap them in so anyone holding the old SRV still sees something.
+bool DesktopCapture::recreateSlot(Slot& slot, uint32_t w, uint32_t h, DXGI_FORMAT fmt) {
+    // Create NEW resources and then swap them in; the render thread holds its own reference to any SRV it uses.
     ComPtr<ID3D11Texture2D>          newTex;
+    ComPtr<IDXGIKeyedMutex>          newMutex;
+    ComPtr<ID3D11Texture2D>          readTex;
+    ComPtr<IDXGIKeyedMutex>          readMutex;
     ComPtr<ID3D11ShaderResourceView> newSrv;
 
     auto toTypeless = [](DXGI_FORMAT f) -> DXGI_FORMAT {
@@ -90,9 +136,18 @@ bool DesktopCapture::recreateTexture(ID3D11Device* device, uint32_t w, uint32_t
     d.SampleDesc.Count = 1;
     d.Usage = D3D11_USAGE_DEFAULT;
     d.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    d.CPUAccessFlags = 0; d.MiscFlags = 0;
-
-    if (FAILED(device->CreateTexture2D(&d, nullptr, &newTex)))
+    d.CPUAccessFlags = 0;
+    d.MiscFlags = D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
+
+    // Written on the capture device, opened and sampled on the render device
+    ComPtr<IDXGIResource> shared;
+    HANDLE handle = nullptr;
+    if (FAILED(device_->CreateTexture2D(&d, nullptr, &newTex)) ||
+        FAILED(newTex.As(&newMutex)) ||
+        FAILED(newTex.As(&shared)) ||
+        FAILED(shared->GetSharedHandle(&handle)) ||
+        FAILED(renderDevice_->OpenSharedResource(handle, IID_PPV_ARGS(&readTex))) ||
+        FAILED(readTex.As(&readMutex)))
         return false;
 
     D3D11_SHADER_RESOURCE_VIEW_DESC sv{};
@@ -101,17 +156,18 @@ bool DesktopCapture::recreateTexture(ID3D11Device* device, uint32_t w, uint32_t
     sv.Texture2D.MostDetailedMip = 0;
     sv.Texture2D.MipLevels = 1;
 
-    HRESULT hr = device->CreateShaderResourceView(newTex.Get(), &sv, &newSrv);
+    HRESULT hr = renderDevice_->CreateShaderResourceView(readTex.Get(), &sv, &newSrv);
     if (FAILED(hr)) {
         sv.Format = fmt;
-        if (FAILED(device->CreateShaderResourceView(newTex.Get(), &sv, &newSrv)))
+        if (FAILED(renderDevice_->CreateShaderResourceView(readTex.Get(), &sv, &newSrv)))
             return false;
     }
 
-    texSR_ = newTex;
-    srv_ = newSrv;
-
-    w_ = w; h_ = h; fmt_ = fmt;
+    slot.tex = newTex;
+    slot.mutex = newMutex;
+    slot.srv = newSrv;
+    slot.readMutex = readMutex;
+    slot.w = w; slot.h = h; slot.fmt = fmt;
     return true;
 }
 
@@ -137,130 +193,197 @@ bool DesktopCapture::tryCreateDuplication() {
 
     dup_ = dup;
 
-    // Force SRV recreation on next successful frame (resolution/format may have changed)
-    w_ = h_ = 0;
-    // Keep last good SRV visible
+    DXGI_OUTDUPL_DESC dd{};
+    dup_->GetDesc(&dd);
+    rotated_ = dd.Rotation != DXGI_MODE_ROTATION_IDENTITY && dd.Rotation != DXGI_MODE_ROTATION_UNSPECIFIED;
+
+    // Keep last good frame visible; slots are recreated lazily if resolution/format changed
     needRecreateDup_ = false;
     retryBackoffMs_ = 250;
     nextRetryMs_ = 0;
     return true;
 }
 
-bool DesktopCapture::Acquire(ID3D11DeviceContext* ctx,
-    ID3D11ShaderResourceView** outSrv,
-    uint32_t* outW,
-    uint32_t* outH,
-    uint32_t timeoutMs) {
-    // Locals declared before any gotos
-    DXGI_OUTDUPL_FRAME_INFO info{};
-    ComPtr<IDXGIResource>   res;
-    HRESULT                 hr = S_OK;
-
-    // If we know we must recreate, try at controlled intervals
-    if (needRecreateDup_) {
-        const uint64_t now = GetTickCount64();
-        if (now >= nextRetryMs_) {
-            if (!tryCreateDuplication()) {
-                // schedule next retry with backoff (cap at 2s)
-                retryBackoffMs_ = (retryBackoffMs_ < 2000) ? (retryBackoffMs_ * 2) : 2000;
-                nextRetryMs_ = now + retryBackoffMs_;
+void DesktopCapture::captureThread() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lk(stopMutex_);
+            if (stop_) break;
+        }
+
+        // If we know we must recreate, try at controlled intervals
+        if (needRecreateDup_) {
+            const uint64_t now = GetTickCount64();
+            if (now >= nextRetryMs_) {
+                if (!tryCreateDuplication()) {
+                    // schedule next retry with backoff (cap at 2s)
+                    retryBackoffMs_ = (retryBackoffMs_ < 2000) ? (retryBackoffMs_ * 2) : 2000;
+                    nextRetryMs_ = now + retryBackoffMs_;
+                }
             }
         }
-        // Even if not yet recreated, keep returning last SRV below.
-    }
 
-    if (!dup_) {
-        // Not ready yet; return last known frame if any
-        goto return_last_no_new_frame;
+        if (!dup_) {
+            // Nothing to wait on; sleep until the next retry (Shutdown wakes us early)
+            const uint64_t now = GetTickCount64();
+            uint64_t waitMs = nextRetryMs_ > now ? nextRetryMs_ - now : 1;
+            std::unique_lock<std::mutex> lk(stopMutex_);
+            stopCv_.wait_for(lk, std::chrono::milliseconds(waitMs), [this] { return stop_; });
+            continue;
+        }
+
+        captureOne();
     }
+}
+
+bool DesktopCapture::captureOne() {
+    DXGI_OUTDUPL_FRAME_INFO info{};
+    ComPtr<IDXGIResource>   res;
 
-    hr = dup_->AcquireNextFrame(timeoutMs, &info, &res);
+    // Block until the desktop changes (or the timeout passes so we can check for shutdown).
+    // AccumulatedFrames > 1 needs no special handling: the acquired image is always the latest one.
+    HRESULT hr = dup_->AcquireNextFrame(timeoutMs_, &info, &res);
     if (hr == DXGI_ERROR_WAIT_TIMEOUT) {
         // No new frame this interval (could be occluded or game still switching)
-        goto return_last_no_new_frame;
+        return false;
+    }
+    if (FAILED(hr)) {
+        // Typically DXGI_ERROR_ACCESS_LOST during mode switch or exclusive transition.
+        // Mark for recreation and clear current dup
+        dup_.Reset();
+        needRecreateDup_ = true;
+        nextRetryMs_ = GetTickCount64(); // retry soon
+        return false;
     }
-	
-    if (info.AccumulatedFrames > 1) {
-        // Keep grabbing frames with zero timeout until AccumulatedFrames <= 1.
-        // IMPORTANT: Release the current frame before acquiring the next.
-        while (info.AccumulatedFrames > 1) {
-            // Release the older frame we currently hold
-            dup_->ReleaseFrame();
-
-            info = {};
-            res.Reset();
-            HRESULT hr2 = dup_->AcquireNextFrame(0, &info, &res);
-            if (hr2 == DXGI_ERROR_WAIT_TIMEOUT) {
-                // No newer frame immediately available; stop here.
-                // We do NOT have a frame held in this case, so go return last-known SRV.
-                goto return_last_no_new_frame;
-            }
-            if (FAILED(hr2)) {
-                // Something went wrong while trying to fast-forward; bail out cleanly.
-                goto return_last_no_new_frame;
-            }
 
-            // Loop again if we're still behind. When AccumulatedFrames <= 1, we stop with a valid frame held.
-        }
+    // Mouse-only updates carry no new desktop image
+    if (info.LastPresentTime.QuadPart == 0) {
+        dup_->ReleaseFrame();
+        return false;
     }
 
-    if (FAILED(hr)) {
-        // Typical during mode switch or exclusive transition
-        if (hr == DXGI_ERROR_ACCESS_LOST ||
-            hr == DXGI_ERROR_DEVICE_REMOVED ||
-            hr == DXGI_ERROR_INVALID_CALL) {
-            // Mark for recreation and clear current dup
-            dup_.Reset();
-            needRecreateDup_ = true;
-            nextRetryMs_ = GetTickCount64(); // retry soon
-            goto return_last_no_new_frame;
-        }
-        else {
-            // Unknown failure; also mark for recreate
-            dup_.Reset();
-            needRecreateDup_ = true;
-            nextRetryMs_ = GetTickCount64();
-            goto return_last_no_new_frame;
-        }
+    ComPtr<ID3D11Texture2D> frameTex;
+    if (FAILED(res.As(&frameTex))) {
+        dup_->ReleaseFrame();
+        return false;
     }
 
-    // We have a new frame
-    {
-        ComPtr<ID3D11Texture2D> frameTex;
-        if (FAILED(res.As(&frameTex))) {
+    D3D11_TEXTURE2D_DESC desc{};
+    frameTex->GetDesc(&desc);
+
+    // Record what changed in this frame (full frame if the metadata is unusable)
+    if (desc.Width != histW_ || desc.Height != histH_) {
+        history_.Reset(desc.Width, desc.Height);
+        histW_ = desc.Width; histH_ = desc.Height;
+    }
+    const bool usable = readFrameRects(info);
+    if (rectLog_)
+        WriteRecordedFrame(rectLog_, { desc.Width, desc.Height, !usable, frameRects_ });
+    if (usable)
+        MergeDirtyRects(frameRects_, desc.Width, desc.Height);
+    else
+        frameRects_.assign(1, DirtyRect{ 0, 0, (int32_t)desc.Width, (int32_t)desc.Height });
+    history_.Push(++frameCounter_, frameRects_);
+
+    // Recreate this slot's shader-readable copy if size/format changed
+    Slot& slot = ring_.WriteSlot();
+    bool recreated = false;
+    if (slot.w != desc.Width || slot.h != desc.Height || slot.fmt != desc.Format || !slot.tex) {
+        if (!recreateSlot(slot, desc.Width, desc.Height, desc.Format)) {
             dup_->ReleaseFrame();
-            goto return_last_no_new_frame;
+            return false;
         }
+        recreated = true;
+    }
 
-        D3D11_TEXTURE2D_DESC desc{};
-        frameTex->GetDesc(&desc);
+    // The slot still holds the frame it was last written with; patch only what changed since then.
+    bool partial = !recreated && history_.CollectSince(slot.frameId, patchRects_);
 
-        // Recreate our shader-readable copy if size/format changed
-        if (w_ != desc.Width || h_ != desc.Height || fmt_ != desc.Format || !texSR_) {
-            ComPtr<ID3D11Device> dev;
-            ctx->GetDevice(&dev);
-            if (!recreateTexture(dev.Get(), desc.Width, desc.Height, desc.Format)) {
-                dup_->ReleaseFrame();
-                goto return_last_no_new_frame;
-            }
+    // Copy into the slot. The render thread only ever samples the slot it picked up last; the
+    // keyed mutex orders these copies before its draws on the other device (and waits for it to
+    // let go of a slot it was handed back a moment ago).
+    if (slot.mutex->AcquireSync(0, timeoutMs_) != S_OK) {
+        dup_->ReleaseFrame();
+        return false;
+    }
+    if (partial) {
+        for (const DirtyRect& r : patchRects_) {
+            D3D11_BOX box{ (UINT)r.left, (UINT)r.top, 0, (UINT)r.right, (UINT)r.bottom, 1 };
+            ctx_->CopySubresourceRegion(slot.tex.Get(), 0, (UINT)r.left, (UINT)r.top, 0, frameTex.Get(), 0, &box);
         }
+    }
+    else {
+        ctx_->CopyResource(slot.tex.Get(), frameTex.Get());
+    }
+    slot.mutex->ReleaseSync(0);
 
-        // Copy the new frame into our SRV-backed texture
-        ctx->CopyResource(texSR_.Get(), frameTex.Get());
+    dup_->ReleaseFrame();
+    slot.frameId = frameCounter_;
 
-        if (outSrv && srv_) { *outSrv = srv_.Get(); (*outSrv)->AddRef(); }
-        if (outW) *outW = w_;
-        if (outH) *outH = h_;
+    const uint64_t fullBytes = uint64_t(desc.Width) * desc.Height * 4;
+    bytesFull_.fetch_add(fullBytes, std::memory_order_relaxed);
+    bytesCopied_.fetch_add(partial ? uint64_t(DirtyRectsArea(patchRects_)) * 4 : fullBytes, std::memory_order_relaxed);
 
-        dup_->ReleaseFrame();
-        return true; // NEW frame delivered
+    ring_.Publish();
+    return true; // NEW frame published
+}
+
+bool DesktopCapture::readFrameRects(const DXGI_OUTDUPL_FRAME_INFO& info) {
+    frameRects_.clear();
+    if (info.TotalMetadataBufferSize == 0 || rotated_)
+        return false;
+
+    if (metaBuf_.size() < info.TotalMetadataBufferSize)
+        metaBuf_.resize(info.TotalMetadataBufferSize);
+
+    // Move rects come first in the buffer, dirty rects after them
+    UINT moveBytes = 0;
+    if (FAILED(dup_->GetFrameMoveRects((UINT)metaBuf_.size(), (DXGI_OUTDUPL_MOVE_RECT*)metaBuf_.data(), &moveBytes)))
+        return false;
+
+    // Moved content is copied on the GPU straight from the new desktop image at its destination.
+    // (Moving it inside the slot would need a scratch texture: D3D11 forbids overlapping same-resource copies.)
+    const DXGI_OUTDUPL_MOVE_RECT* moves = (const DXGI_OUTDUPL_MOVE_RECT*)metaBuf_.data();
+    for (UINT i = 0; i < moveBytes / sizeof(DXGI_OUTDUPL_MOVE_RECT); i++) {
+        const RECT& d = moves[i].DestinationRect;
+        frameRects_.push_back({ d.left, d.top, d.right, d.bottom });
+    }
+
+    UINT dirtyBytes = 0;
+    RECT* dirty = (RECT*)(metaBuf_.data() + moveBytes);
+    if (FAILED(dup_->GetFrameDirtyRects((UINT)metaBuf_.size() - moveBytes, dirty, &dirtyBytes)))
+        return false;
+    for (UINT i = 0; i < dirtyBytes / sizeof(RECT); i++)
+        frameRects_.push_back({ dirty[i].left, dirty[i].top, dirty[i].right, dirty[i].bottom });
+    return true;
+}
+
+bool DesktopCapture::AcquireLatest(ID3D11ShaderResourceView** outSrv,
+    uint32_t* outW,
+    uint32_t* outH) {
+    // Swap in the newest completed slot (if any). The slot we hand out stays untouched by the
+    // capture thread until the next call, and the caller holds its own reference anyway.
+    bool fresh = ring_.Update();
+
+    const Slot& slot = ring_.ReadSlot();
+    if (fresh && slot.readMutex) {
+        // The capture thread released it before publishing, so this does not wait. The previous
+        // slot's lock goes after it: draws already submitted from it complete before the capture
+        // device may write it again.
+        ComPtr<IDXGIKeyedMutex> prev = held_;
+        held_.Reset();
+        if (slot.readMutex->AcquireSync(0, timeoutMs_) == S_OK)
+            held_ = slot.readMutex;
+        if (prev) prev->ReleaseSync(0);
+    }
+    if (!held_) {
+        // Nothing we may sample (no frame yet, or the lock could not be taken)
+        if (outSrv) *outSrv = nullptr;
+        return false;
     }
 
-return_last_no_new_frame:
-    // Provide last known SRV so caller can keep rendering if desired,
-    // but signal "no new frame" by returning false.
-    if (outSrv && srv_) { *outSrv = srv_.Get(); (*outSrv)->AddRef(); }
-    if (outW) *outW = w_;
-    if (outH) *outH = h_;
-    return false;
+    if (outSrv && slot.srv) { *outSrv = slot.srv.Get(); (*outSrv)->AddRef(); }
+    if (outW) *outW = slot.w;
+    if (outH) *outH = slot.h;
+    return fresh && slot.srv;
 }
@@ -5,45 +5,99 @@
 #include <dxgi1_2.h>
 #include <wrl/client.h>
 #include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
+#include <vector>
+
+#include "triple_buffer.h"
+#include "dirty_rects.h"
+
+// The capture thread runs on a D3D11 device of its own (same adapter), so it never touches the
+// render thread's immediate context. Ring textures are shared between the two devices and each
+// one is guarded by a keyed mutex: the capture thread holds it while copying, the render thread
+// from the moment it picks the slot up until it moves on to a newer one.
 class DesktopCapture {
 public:
-    // Initialize duplication for adapter->EnumOutputs(outputIndex)
-    bool Init(ID3D11Device* device, IDXGIAdapter1* adapter, int outputIndex);
+    // Initialize duplication for adapter->EnumOutputs(outputIndex) and start the capture thread.
+    // device is the render device the SRVs are created on. The capture thread blocks in
+    // AcquireNextFrame for up to timeoutMs per wait.
+    bool Init(ID3D11Device* device, IDXGIAdapter1* adapter, int outputIndex, uint32_t timeoutMs = 100);
+    // Render thread (it releases the slot it holds)
     void Shutdown();
 
-    // Acquire next frame.
-    // Returns true only when a NEW frame was copied this call.
-    // On false, you may still get outSrv set to the last good frame (so you can keep rendering),
-    // but you should continue calling Acquire each frame so we can recover after mode switches.
-    bool Acquire(ID3D11DeviceContext* ctx,
-        ID3D11ShaderResourceView** outSrv,
+    // Picks up the newest frame completed by the capture thread. Call once per rendered frame,
+    // from the render thread; the returned SRV may be sampled until the next call.
+    // Returns true only when a NEW frame was picked up by this call.
+    // On false, you may still get outSrv set to the last good frame (so you can keep rendering).
+    bool AcquireLatest(ID3D11ShaderResourceView** outSrv,
         uint32_t* outW,
-        uint32_t* outH,
-        uint32_t timeoutMs);
+        uint32_t* outH);
 
-    // Optional: call when you receive WM_DISPLAYCHANGE
+    // Optional: call when you receive WM_DISPLAYCHANGE (any thread)
     void NotifyDisplayModeChange();
 
+    // Bytes actually copied into the ring vs. what full-frame copies would have cost (any thread)
+    void GetCopyStats(uint64_t* outCopiedBytes, uint64_t* outFullBytes) const;
+
 private:
-    bool recreateTexture(ID3D11Device* device, uint32_t w, uint32_t h, DXGI_FORMAT fmt);
+    // One entry of the texture ring the capture thread publishes into
+    struct Slot {
+        Microsoft::WRL::ComPtr<ID3D11Texture2D>          tex;         // capture device
+        Microsoft::WRL::ComPtr<IDXGIKeyedMutex>          mutex;       // capture device's view of the lock
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;         // render device
+        Microsoft::WRL::ComPtr<IDXGIKeyedMutex>          readMutex;   // render device's view of the lock
+        uint32_t    w = 0, h = 0;
+        DXGI_FORMAT fmt = DXGI_FORMAT_UNKNOWN;
+        uint64_t    frameId = 0;   // capture frame this texture is up to date with (0 = undefined)
+    };
+
+    void captureThread();
+    bool captureOne();           // wait for and copy one frame; false on timeout/failure
+    bool readFrameRects(const DXGI_OUTDUPL_FRAME_INFO& info); // fills frameRects_, unmerged
+    bool recreateSlot(Slot& slot, uint32_t w, uint32_t h, DXGI_FORMAT fmt);
     bool tryCreateDuplication(); // attempt once; no loops
 
-    // Duplication + shader-readable copy of latest frame
+    // Duplication (only touched by the capture thread after Init)
     Microsoft::WRL::ComPtr<IDXGIOutputDuplication> dup_;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D>        texSR_;
-    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv_;
+
+    // Producer: capture thread, consumer: render thread
+    TripleBuffer<Slot> ring_;
+
+    // Render thread: lock of the slot it currently samples (kept here, not in the slot, because
+    // the capture thread may recreate that slot as soon as it is handed back)
+    Microsoft::WRL::ComPtr<IDXGIKeyedMutex>        held_;
 
     // Cached so we can transparently recover after DXGI_ERROR_ACCESS_LOST / NOT_CURRENTLY_AVAILABLE
-    Microsoft::WRL::ComPtr<ID3D11Device>   device_;
-    Microsoft::WRL::ComPtr<IDXGIAdapter1>  adapter_;
-    int                                    outputIndex_ = 0;
+    Microsoft::WRL::ComPtr<ID3D11Device>           renderDevice_;
+    Microsoft::WRL::ComPtr<ID3D11Device>           device_;   // capture device, created in Init
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext>    ctx_;      // its immediate context (capture thread only)
+    Microsoft::WRL::ComPtr<IDXGIAdapter1>          adapter_;
+    int                                            outputIndex_ = 0;
+    uint32_t                                       timeoutMs_ = 100;
+
+    // Capture thread
+    std::thread             thread_;
+    std::mutex              stopMutex_;
+    std::condition_variable stopCv_;
+    bool                    stop_ = false;
+
+    // Partial updates: changed regions of recent frames, so each slot only gets what changed since it was last written
+    DirtyRectHistory       history_;
+    uint64_t               frameCounter_ = 0;
+    uint32_t               histW_ = 0, histH_ = 0;
+    bool                   rotated_ = false;   // metadata rects are not usable on rotated outputs
+    std::vector<uint8_t>   metaBuf_;
+    std::vector<DirtyRect> frameRects_;
+    std::vector<DirtyRect> patchRects_;
+    std::FILE*             rectLog_ = nullptr;   // VE_DIRTY_RECT_LOG
+    std::atomic<uint64_t>  bytesCopied_ = 0;
+    std::atomic<uint64_t>  bytesFull_ = 0;
 
     // Recovery state
-    bool        needRecreateDup_ = false;   // set when we detect loss or you call NotifyDisplayModeChange
+    std::atomic<bool> needRecreateDup_ = false;   // set when we detect loss or you call NotifyDisplayModeChange
     uint64_t    nextRetryMs_ = 0;       // GetTickCount64() time for next retry
     uint32_t    retryBackoffMs_ = 250;     // adaptive backoff (caps at 2s)
-
-    uint32_t    w_ = 0, h_ = 0;
-    DXGI_FORMAT fmt_ = DXGI_FORMAT_B8G8R8A8_UNORM;
-};
\ No newline at end of file
+};
@@ -6,6 +6,7 @@
 #include <wrl/client.h>
 #include <openxr/openxr.h>
 #include <cmath>
+#include <cstdio>
 #include <Windows.h>
 #undef min
 #undef max
@@ -13,7 +14,7 @@
 
 #include "desktop_plane.h"
 #include "desktop_capture.h"
-#include "d3d.h" // d3d_device, d3d_context, d3d_xr_projection, d3d_compile_shader
+#include "d3d.h" // d3d_device, d3d_context, d3d_xr_projection, d3d_load_shader
 
 
 using namespace DirectX;
@@ -24,6 +25,7 @@ using Microsoft::WRL::ComPtr;
 struct PlaneVertex { XMFLOAT3 pos; XMFLOAT2 uv; };
 
 static ID3D11VertexShader* s_vs = nullptr;
+static ID3D11VertexShader* s_vsStereo = nullptr; // single pass variant, when supported
 static ID3D11PixelShader* s_ps = nullptr;
 static ID3D11InputLayout* s_il = nullptr;
 static ID3D11Buffer* s_vb = nullptr;
@@ -34,6 +36,8 @@ static ID3D11Buffer* s_cb = nullptr; // our own constant buffer
 
 static bool     s_placed = false;
 static XMFLOAT4X4 s_worldStored{};
+static XrPosef  s_poseStored = { {0,0,0,1}, {0,0,0} };  // same placement, as a pose + size for a quad layer
+static XrExtent2Df s_sizeStored = { 0, 0 };
 static float    s_widthMeters = 3.0f;
 static float    s_distance = 1.5f;
 
@@ -44,25 +48,15 @@ static int s_outputIndex = 0;
 
 
 
-// HLSL for the textured plane (mirror U to fix left-right inversion)
-static constexpr char kPlaneShaderHLSL[] = R"_(
-cbuffer TransformBuffer : register(b0) {
-    float4x4 world;
-    float4x4 viewproj;
-};
-struct vsIn { float3 pos:POSITION; float2 uv:TEXCOORD0; };
-struct psIn { float4 pos:SV_POSITION; float2 uv:TEXCOORD0; };
-psIn vs(vsIn i) {
-    psIn o;
-    o.pos = mul(float4(i.pos,1), world);
-    o.pos = mul(o.pos, viewproj);
-    o.uv  = i.uv;
-    return o;
-}
-Texture2D tex0 : register(t0);
-SamplerState s0 : register(s0);
-float4 ps(psIn i) : SV_TARGET { return tex0.Sample(s0, i.uv); }
-)_";
+// shaders/desktop_plane.hlsl, precompiled by the vcxproj (d3d_load_shader falls back to compiling it)
+#ifdef VE_PRECOMPILED_SHADERS
+#include "shaders/desktop_plane_vs.h"
+#include "shaders/desktop_plane_vs_stereo.h"
+#include "shaders/desktop_plane_ps.h"
+#endif
+static const d3d_shader_t kVS = D3D_SHADER(desktop_plane, vs, "vs", "vs_5_0", false);
+static const d3d_shader_t kVSStereo = D3D_SHADER(desktop_plane, vs_stereo, "vs", "vs_5_0", true);
+static const d3d_shader_t kPS = D3D_SHADER(desktop_plane, ps, "ps", "ps_5_0", false);
 
 static RECT s_outputRect = { 0,0,0,0 }; // desktop coords of the captured output
 extern uint32_t s_w, s_h;             // your existing capture width/height
@@ -94,12 +88,18 @@ bool DesktopPlane_Init(float widthMeters, float distanceMeters, int outputIndex)
 	s_w = s_h = 0;
 
 	// Shaders
-	ID3DBlob* vsb = d3d_compile_shader(kPlaneShaderHLSL, "vs", "vs_5_0");
-	ID3DBlob* psb = d3d_compile_shader(kPlaneShaderHLSL, "ps", "ps_5_0");
+	ID3DBlob* vsb = d3d_load_shader(kVS);
+	ID3DBlob* psb = d3d_load_shader(kPS);
 	if (!vsb || !psb) return false;
 
 	d3d_device->CreateVertexShader(vsb->GetBufferPointer(), vsb->GetBufferSize(), nullptr, &s_vs);
 	d3d_device->CreatePixelShader(psb->GetBufferPointer(), psb->GetBufferSize(), nullptr, &s_ps);
+	if (d3d_single_pass_supported) {
+		if (ID3DBlob* vss = d3d_load_shader(kVSStereo)) {
+			d3d_device->CreateVertexShader(vss->GetBufferPointer(), vss->GetBufferSize(), nullptr, &s_vsStereo);
+			vss->Release();
+		}
+	}
 
 	D3D11_INPUT_ELEMENT_DESC il[] = {
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,                            D3D11_INPUT_PER_VERTEX_DATA, 0},
@@ -126,7 +126,7 @@ bool DesktopPlane_Init(float widthMeters, float distanceMeters, int outputIndex)
 	d3d_device->CreateBuffer(&ibDesc, &ibData, &s_ib);
 
 	// Constant buffer (our own)
-	D3D11_BUFFER_DESC cbDesc = CD3D11_BUFFER_DESC(sizeof(XMFLOAT4X4) * 2, D3D11_BIND_CONSTANT_BUFFER);
+	D3D11_BUFFER_DESC cbDesc = CD3D11_BUFFER_DESC(sizeof(XMFLOAT4X4), D3D11_BIND_CONSTANT_BUFFER);
 	d3d_device->CreateBuffer(&cbDesc, nullptr, &s_cb);
 
 	// Sampler
@@ -197,99 +197,144 @@ bool DesktopPlane_UVToScreen(const DirectX::XMFLOAT2& uv, POINT* outScreenPt) {
 }
 
 
+void DesktopPlane_GetInteractionPlane(InteractionPlane* outPlane) {
+	*outPlane = {};
+	if (!s_placed) return;
+
+	// World = Scale * Yaw * Translate: rows 0 and 1 are the scaled quad axes, row 3 the center
+	const XMFLOAT4X4& w = s_worldStored;
+	outPlane->placed = true;
+	outPlane->right[0] = w._11; outPlane->right[1] = w._12; outPlane->right[2] = w._13;
+	outPlane->up[0] = w._21;    outPlane->up[1] = w._22;    outPlane->up[2] = w._23;
+	outPlane->center[0] = w._41; outPlane->center[1] = w._42; outPlane->center[2] = w._43;
+	outPlane->screenLeft = s_outputRect.left;
+	outPlane->screenTop = s_outputRect.top;
+	outPlane->screenWidth = (int32_t)s_w;
+	outPlane->screenHeight = (int32_t)s_h;
+}
+
 bool DesktopPlane_WarpCursor(const DirectX::XMFLOAT2& uv) {
 	POINT pt{};
 	if (!DesktopPlane_UVToScreen(uv, &pt)) return false;
 	return SetCursorPos(pt.x, pt.y) ? true : false;
 }
 
-void DesktopPlane_Draw(const XrCompositionLayerProjectionView& view) {
-	// Acquire latest desktop frame (non-blocking)
+bool DesktopPlane_Update() {
+	// Pick up the newest frame the capture thread finished (non-blocking)
 	ID3D11ShaderResourceView* newSrv = nullptr;
 	uint32_t newW = 0, newH = 0;
-	if (s_capture.Acquire(d3d_context, &newSrv, &newW, &newH, 0)) {
-		if (s_srv) s_srv->Release();
-		s_srv = newSrv;
-		s_w = newW; s_h = newH;
+	if (!s_capture.AcquireLatest(&newSrv, &newW, &newH)) {
+		if (newSrv) newSrv->Release();
+		return false;
 	}
-	if (!s_srv) return;
-
-	// Per-view matrices
-	XMVECTOR camOri = XMLoadFloat4((XMFLOAT4*)&view.pose.orientation);
-	XMVECTOR camPos = XMLoadFloat3((XMFLOAT3*)&view.pose.position);
-	XMMATRIX proj = d3d_xr_projection(view.fov, 0.05f, 100.0f);
-	XMMATRIX viewM = XMMatrixInverse(nullptr, XMMatrixAffineTransformation(
-		DirectX::g_XMOne, DirectX::g_XMZero, camOri, camPos));
-
-	// Place once from initial gaze
-	if (!s_placed) {
-		// Size from desktop aspect
-		float aspect = s_h ? (float)s_w / (float)s_h : (16.0f / 9.0f);
-		float width = s_widthMeters;
-		float height = width / aspect;
-
-		// Initial forward from HMD, but project to XZ (kill pitch/roll)
-		XMVECTOR fwd = XMVector3Rotate(XMVectorSet(0, 0, -1, 0), camOri);
-		XMVECTOR fwdXZ = XMVector3Normalize(XMVectorSet(XMVectorGetX(fwd), 0.0f, XMVectorGetZ(fwd), 0.0f));
-
-		// Place the plane in front of the origin along yaw-only forward
-		XMVECTOR planePos = XMVectorScale(fwdXZ, s_distance);
-
-		// Compute yaw (so +Z of the quad faces the user at origin)
-		float fx = XMVectorGetX(fwdXZ);
-		float fz = XMVectorGetZ(fwdXZ);
-		float yaw = atan2f(fx, fz) + XM_PI; // rotate +Z to -fwdXZ
-
-		// World = Scale * YawOnly * Translate; no roll/pitch, so it won't lean
-		XMMATRIX worldOnce =
-			XMMatrixScaling(width, height, 1.0f) *
-			XMMatrixRotationY(yaw) *
-			XMMatrixTranslationFromVector(planePos);
-
-		XMStoreFloat4x4(&s_worldStored, worldOnce);
-		s_placed = true;
+	if (s_srv) s_srv->Release();
+	s_srv = newSrv;
+	s_w = newW; s_h = newH;
+
+	// Quad layer mode: hand the new frame to the compositor's swapchain (only on change)
+	if (xr_quad_layer_mode) {
+		ComPtr<ID3D11Resource>  res;
+		ComPtr<ID3D11Texture2D> tex;
+		s_srv->GetResource(&res);
+		if (SUCCEEDED(res.As(&tex)))
+			openxr_quad_update(tex.Get());
 	}
+	return true;
+}
+
+// Place once from initial gaze
+static void PlaceFromHead(const XrPosef& head) {
+	if (s_placed) return;
+
+	XMVECTOR camOri = XMLoadFloat4((XMFLOAT4*)&head.orientation);
+
+	// Size from desktop aspect
+	float aspect = s_h ? (float)s_w / (float)s_h : (16.0f / 9.0f);
+	float width = s_widthMeters;
+	float height = width / aspect;
+
+	// Initial forward from HMD, but project to XZ (kill pitch/roll)
+	XMVECTOR fwd = XMVector3Rotate(XMVectorSet(0, 0, -1, 0), camOri);
+	XMVECTOR fwdXZ = XMVector3Normalize(XMVectorSet(XMVectorGetX(fwd), 0.0f, XMVectorGetZ(fwd), 0.0f));
+
+	// Place the plane in front of the origin along yaw-only forward
+	XMVECTOR planePos = XMVectorScale(fwdXZ, s_distance);
 
+	// Compute yaw (so +Z of the quad faces the user at origin)
+	float fx = XMVectorGetX(fwdXZ);
+	float fz = XMVectorGetZ(fwdXZ);
+	float yaw = atan2f(fx, fz) + XM_PI; // rotate +Z to -fwdXZ
+
+	// World = Scale * YawOnly * Translate; no roll/pitch, so it won't lean
+	XMMATRIX worldOnce =
+		XMMatrixScaling(width, height, 1.0f) *
+		XMMatrixRotationY(yaw) *
+		XMMatrixTranslationFromVector(planePos);
+
+	XMStoreFloat4x4(&s_worldStored, worldOnce);
+
+	// Same placement for the compositor (quad layers face +Z, just like our quad)
+	XMStoreFloat4((XMFLOAT4*)&s_poseStored.orientation, XMQuaternionRotationRollPitchYaw(0.0f, yaw, 0.0f));
+	XMStoreFloat3((XMFLOAT3*)&s_poseStored.position, planePos);
+	s_sizeStored = { width, height };
+	s_placed = true;
+}
+
+bool DesktopPlane_QuadPose(const XrPosef& headPose, XrPosef* outPose, XrExtent2Df* outSize) {
+	if (!s_srv) return false;
+	PlaceFromHead(headPose);
+	if (outPose) *outPose = s_poseStored;
+	if (outSize) *outSize = s_sizeStored;
+	return true;
+}
+
+bool DesktopPlane_NeedsDepth() {
+	return false;
+}
+
+void DesktopPlane_Draw(const XrCompositionLayerProjectionView* views, uint32_t viewCount) {
+	if (!s_srv || viewCount == 0) return;
+
+	// View matrices are already bound at d3d_view_slot by the pass
+	PlaceFromHead(views[0].pose);
 
 	XMMATRIX world = XMLoadFloat4x4(&s_worldStored);
 
-	// Update our own constant buffer
-	struct { XMFLOAT4X4 world; XMFLOAT4X4 viewproj; } cbData;
+	// Per-draw constants (s_cb only when the ring is unavailable)
+	struct { XMFLOAT4X4 world; } cbData;
 	XMStoreFloat4x4(&cbData.world, XMMatrixTranspose(world));
-	XMStoreFloat4x4(&cbData.viewproj, XMMatrixTranspose(viewM * proj));
-	d3d_context->UpdateSubresource(s_cb, 0, nullptr, &cbData, 0, 0);
-
-	// Set rasterizer (cull none) temporarily
-	ID3D11RasterizerState* prevRS = nullptr;
-	d3d_context->RSGetState(&prevRS);
-	d3d_context->RSSetState(s_rs);
-
-	// Bind pipeline
-	UINT stride = sizeof(PlaneVertex), offset = 0;
-	d3d_context->IASetVertexBuffers(0, 1, &s_vb, &stride, &offset);
-	d3d_context->IASetIndexBuffer(s_ib, DXGI_FORMAT_R16_UINT, 0);
-	d3d_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	d3d_context->IASetInputLayout(s_il);
-	d3d_context->VSSetShader(s_vs, nullptr, 0);
-	d3d_context->PSSetShader(s_ps, nullptr, 0);
-	d3d_context->VSSetConstantBuffers(0, 1, &s_cb);
-	d3d_context->PSSetSamplers(0, 1, &s_samp);
-	d3d_context->PSSetShaderResources(0, 1, &s_srv);
-
-	d3d_context->DrawIndexed(6, 0, 0);
-
-	// Unbind & restore
-	ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
-	d3d_context->PSSetShaderResources(0, 1, nullSRV);
-	d3d_context->RSSetState(prevRS);
-	if (prevRS) prevRS->Release();
+	d3d_set_constants(s_cb, &cbData, sizeof(cbData), 0, d3d_stage_vs);
+
+	// Bind pipeline (cull none: the plane is visible from behind too). Whoever draws next sets
+	// their own rasterizer state, so there is nothing to restore.
+	d3d_state.RSSetState(s_rs);
+	d3d_state.IASetVertexBuffer(s_vb, sizeof(PlaneVertex), 0);
+	d3d_state.IASetIndexBuffer(s_ib, DXGI_FORMAT_R16_UINT, 0);
+	d3d_state.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	d3d_state.IASetInputLayout(s_il);
+	d3d_state.VSSetShader(d3d_view_count > 1 ? s_vsStereo : s_vs);
+	d3d_state.PSSetShader(s_ps);
+	d3d_state.PSSetSampler(s_samp);
+	d3d_state.PSSetShaderResource(s_srv);
+
+	d3d_draw_indexed(6);
 }
 
 void DesktopPlane_Shutdown() {
 	if (s_srv) { s_srv->Release(); s_srv = nullptr; }
+
+	uint64_t copied = 0, full = 0;
+	s_capture.GetCopyStats(&copied, &full);
+	if (full) {
+		char msg[160];
+		sprintf_s(msg, "Desktop capture copied %llu of %llu bytes (%.1f%% saved by dirty rects)\n",
+			copied, full, 100.0 * (1.0 - (double)copied / (double)full));
+		OutputDebugStringA(msg);
+	}
 	s_capture.Shutdown();
 
 	if (s_vs) { s_vs->Release();   s_vs = nullptr; }
+	if (s_vsStereo) { s_vsStereo->Release(); s_vsStereo = nullptr; }
 	if (s_ps) { s_ps->Release();   s_ps = nullptr; }
 	if (s_il) { s_il->Release();   s_il = nullptr; }
 	if (s_vb) { s_vb->Release();   s_vb = nullptr; }
@@ -1,5 +1,6 @@
 #pragma once
 #include <openxr/openxr.h>
+#include "interaction.h"
 
 // Initializes the capture + plane resources.
 // widthMeters: plane width (X) in meters; height is derived from desktop aspect.
@@ -7,9 +8,19 @@
 // outputIndex: which monitor to capture (0 = primary).
 bool DesktopPlane_Init(float widthMeters = 3.0f, float distanceMeters = 1.5f, int outputIndex = 0);
 
-// Draws the plane for the current eye view. Keeps the plane fixed in app space,
-// placed once from the initial head orientation at first draw.
-void DesktopPlane_Draw(const XrCompositionLayerProjectionView& view);
+// Picks up the newest desktop frame from the capture thread. Call once per frame, before drawing.
+// Returns true if a new frame arrived (in quad layer mode it is then copied to the quad swapchain).
+bool DesktopPlane_Update();
+
+// Quad layer mode: pose and size (meters) of the plane in app space, placing it from headPose
+// on first use. Returns false until there is a desktop frame to show.
+bool DesktopPlane_QuadPose(const XrPosef& headPose, XrPosef* outPose, XrExtent2Df* outSize);
+
+// Draws the plane for the views of the current pass (one eye, or both in single pass stereo).
+// Keeps the plane fixed in app space, placed once from the initial head orientation at first draw.
+void DesktopPlane_Draw(const XrCompositionLayerProjectionView* views, uint32_t viewCount);
+// False: a single flat quad drawn first never needs the depth test itself
+bool DesktopPlane_NeedsDepth();
 
 // Releases all resources.
 void DesktopPlane_Shutdown();
@@ -28,5 +39,9 @@ bool DesktopPlane_Raycast(const DirectX::XMVECTOR& rayOrigin,
 // Returns false if plane not placed or capture not ready.
 bool DesktopPlane_UVToScreen(const DirectX::XMFLOAT2& uv, POINT* outScreenPt);
 
+// The placed plane and its screen mapping, for the per-frame interaction stage.
+// outPlane->placed is false until the plane has been placed.
+void DesktopPlane_GetInteractionPlane(InteractionPlane* outPlane);
+
 // Convenience: warp the system cursor; returns false if mapping failed.
 bool DesktopPlane_WarpCursor(const DirectX::XMFLOAT2& uv);
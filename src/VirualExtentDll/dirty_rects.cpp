@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "dirty_rects.h"
+
+#include <algorithm>
+
+static DirtyRect BoundingBox(const DirtyRect& a, const DirtyRect& b) {
+    return { std::min(a.left, b.left), std::min(a.top, b.top),
+             std::max(a.right, b.right), std::max(a.bottom, b.bottom) };
+}
+
+static int64_t OverlapArea(const DirtyRect& a, const DirtyRect& b) {
+    DirtyRect i{ std::max(a.left, b.left), std::max(a.top, b.top),
+                 std::min(a.right, b.right), std::min(a.bottom, b.bottom) };
+    return i.Area();
+}
+
+void MergeDirtyRects(std::vector<DirtyRect>& rects, uint32_t w, uint32_t h,
+    int64_t mergeSlackPx, size_t maxRects, float fullFrameRatio) {
+    const DirtyRect full{ 0, 0, (int32_t)w, (int32_t)h };
+    const int64_t fullArea = full.Area();
+
+    // Clip and drop empties
+    size_t n = 0;
+    for (size_t i = 0; i < rects.size(); i++) {
+        DirtyRect r = rects[i];
+        r.left = std::max(r.left, 0);   r.top = std::max(r.top, 0);
+        r.right = std::min(r.right, full.right); r.bottom = std::min(r.bottom, full.bottom);
+        if (!r.Empty()) rects[n++] = r;
+    }
+    rects.resize(n);
+    if (rects.empty()) return;
+
+    // Huge rect lists (e.g. a scrolling web page) are not worth merging one by one
+    if (rects.size() > maxRects * 8) {
+        rects.assign(1, full);
+        return;
+    }
+
+    // Greedy pairwise merge until nothing changes. Overlapping rects always merge, so the
+    // result never double-counts pixels.
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                const DirtyRect& a = rects[i];
+                const DirtyRect& b = rects[j];
+                DirtyRect box = BoundingBox(a, b);
+                int64_t covered = a.Area() + b.Area() - OverlapArea(a, b);
+                if (OverlapArea(a, b) > 0 || box.Area() - covered <= mergeSlackPx) {
+                    rects[i] = box;
+                    rects[j] = rects.back();
+                    rects.pop_back();
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (rects.size() > maxRects || (float)DirtyRectsArea(rects) > fullFrameRatio * (float)fullArea)
+        rects.assign(1, full);
+}
+
+int64_t DirtyRectsArea(const std::vector<DirtyRect>& rects) {
+    int64_t a = 0;
+    for (const DirtyRect& r : rects) a += r.Area();
+    return a;
+}
+
+void DirtyRectHistory::Reset(uint32_t w, uint32_t h) {
+    for (Entry& e : entries_) { e.frameId = 0; e.rects.clear(); }
+    latest_ = 0;
+    w_ = w; h_ = h;
+}
+
+void DirtyRectHistory::Push(uint64_t frameId, const std::vector<DirtyRect>& rects) {
+    Entry& e = entries_[frameId % kDepth];
+    e.frameId = frameId;
+    e.rects.assign(rects.begin(), rects.end()); // reuses capacity once warmed up
+    latest_ = frameId;
+}
+
+bool DirtyRectHistory::CollectSince(uint64_t sinceFrame, std::vector<DirtyRect>& out) const {
+    out.clear();
+    if (sinceFrame == 0 || sinceFrame > latest_ || latest_ - sinceFrame >= (uint64_t)kDepth)
+        return false;
+
+    for (uint64_t f = sinceFrame + 1; f <= latest_; f++) {
+        const Entry& e = entries_[f % kDepth];
+        if (e.frameId != f) return false;
+        out.insert(out.end(), e.rects.begin(), e.rects.end());
+    }
+    MergeDirtyRects(out, w_, h_);
+    return true;
+}
+
+void WriteRecordedFrame(std::FILE* f, const RecordedFrame& frame) {
+    std::fprintf(f, "%u %u %d", frame.w, frame.h, frame.full ? -1 : (int)frame.rects.size());
+    if (!frame.full)
+        for (const DirtyRect& r : frame.rects)
+            std::fprintf(f, " %d %d %d %d", r.left, r.top, r.right, r.bottom);
+    std::fputc('\n', f);
+}
+
+bool ReadRecordedFrames(std::FILE* f, std::vector<RecordedFrame>& out) {
+    out.clear();
+    RecordedFrame frame;
+    int n = 0;
+    while (std::fscanf(f, "%u %u %d", &frame.w, &frame.h, &n) == 3) {
+        frame.full = n < 0;
+        frame.rects.resize(n > 0 ? n : 0);
+        for (DirtyRect& r : frame.rects)
+            if (std::fscanf(f, "%d %d %d %d", &r.left, &r.top, &r.right, &r.bottom) != 4)
+                return false;
+        out.push_back(frame);
+    }
+    return std::feof(f) != 0;
+}
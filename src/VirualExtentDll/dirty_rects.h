@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Portable rect bookkeeping for partial desktop updates (no D3D/DXGI types in here).
+// Rects are half-open: [left, right) x [top, bottom), in pixels of the captured output.
+struct DirtyRect {
+    int32_t left = 0, top = 0, right = 0, bottom = 0;
+
+    int64_t Area() const { return (right > left && bottom > top) ? int64_t(right - left) * (bottom - top) : 0; }
+    bool    Empty() const { return right <= left || bottom <= top; }
+};
+
+// Clips rects to [0,w) x [0,h), drops empty ones and merges rects that overlap or touch
+// (or whose bounding box wastes at most mergeSlackPx extra pixels). If the result still has
+// more than maxRects entries, or covers more than fullFrameRatio of the frame, it is replaced
+// by a single full-frame rect because one big copy is cheaper than many small ones then.
+void MergeDirtyRects(std::vector<DirtyRect>& rects, uint32_t w, uint32_t h,
+    int64_t mergeSlackPx = 4096, size_t maxRects = 32, float fullFrameRatio = 0.6f);
+
+// Sum of areas (rects are assumed non-overlapping, as produced by MergeDirtyRects).
+int64_t DirtyRectsArea(const std::vector<DirtyRect>& rects);
+
+// Rect streams: what DesktopCapture saw, one line per captured frame, so the merge can be replayed
+// offline (tests/dirty_rects_bench). A line is "<w> <h> <n>" followed by n "l t r b" rects as the
+// duplication reported them, before merging; n is -1 when the frame had no usable metadata.
+struct RecordedFrame {
+    uint32_t               w = 0, h = 0;
+    bool                   full = false;   // no usable metadata: the whole frame changed
+    std::vector<DirtyRect> rects;
+};
+void WriteRecordedFrame(std::FILE* f, const RecordedFrame& frame);
+// Reads every frame up to the end of the file; false if a line is malformed
+bool ReadRecordedFrames(std::FILE* f, std::vector<RecordedFrame>& out);
+
+// Remembers the changed regions of the last few frames so a texture that was last brought
+// up to date at an older frame can be patched with just the union of what changed since.
+class DirtyRectHistory {
+public:
+    static constexpr int kDepth = 8;
+
+    void Reset(uint32_t w, uint32_t h);
+
+    // Record the (already merged) changed rects of frame `frameId`. Frame ids must increase by one.
+    void Push(uint64_t frameId, const std::vector<DirtyRect>& rects);
+
+    // Union of the rects of all frames in (sinceFrame, latest]. Returns false if that span is no
+    // longer (or never was) in the history, in which case the caller has to do a full copy.
+    bool CollectSince(uint64_t sinceFrame, std::vector<DirtyRect>& out) const;
+
+    uint64_t Latest() const { return latest_; }
+
+private:
+    struct Entry {
+        uint64_t               frameId = 0;
+        std::vector<DirtyRect> rects;
+    };
+    Entry    entries_[kDepth];
+    uint64_t latest_ = 0;
+    uint32_t w_ = 0, h_ = 0;
+};
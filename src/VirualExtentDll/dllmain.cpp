@@ -4,6 +4,7 @@
 #pragma comment(lib,"D3D11.lib")
 #pragma comment(lib,"D3dcompiler.lib")
 #pragma comment(lib,"Dxgi.lib")
+#pragma comment(lib,"Winmm.lib")
 
 #define XR_USE_PLATFORM_WIN32
 #define XR_USE_GRAPHICS_API_D3D11
@@ -28,15 +29,65 @@ using namespace DirectX;
 #include "scene_cubes.h"    // <-- NEW: cubes module
 #include "controllers.h"
 #include "controller_config.h"
+#include "frame_timing.h"
+#include "frame_arena.h"
+#include "input_thread.h"
+#include "alloc_audit.h"
+#include "idle_waiter.h"
+#include "vr_thread.h"
+#include "input_injection.h"
+#include "key_scheduler.h"
+#include "interaction.h"
+#include "depth_plan.h"
+#ifdef VE_MOCK_OPENXR
+#include "mock_openxr.h"
+#include "env_var.h"
+#include <cmath>
+#include <cstdlib>
+#endif
 
+// Loaded afresh by every ve_run, so a restart after VE_Stop does not see the last run's profile
 static ControllerConfig controllerConfig;
 static ControllerProfile* selectedProfile = nullptr;
+static CompiledProfile compiledProfile;
+
+// Used when controller_map.json is missing or empty: hand poses only, nothing injected
+static ControllerProfile fallbackProfile = { "/interaction_profiles/khr/simple_controller", {} };
+
+// Controller profile polling rate; 0 polls once per rendered frame on the render thread instead
+static uint32_t     inputRateHz = 500;
+static InputThread  inputThread;
+static InputSnapshot frameInput;    // per-frame polling's state (inputRateHz 0), render thread
+static const InputSnapshot* currentInput = &frameInput; // the input state this frame sees
+static InputLatency inputLatency;   // runtime change -> dispatch
+static InputLatency inputStateAge;  // input thread sample -> picked up by a frame
+
+// Blocks the loop while the session isn't running; Notify() it to wake the loop early
+static IdleWaiter   idleWaiter;
+
+// Runs the loop: on its own thread (VE_StartAsync) or on the caller's (VE_Start), one at a time
+static VrThread     vrThread;
+
+#ifdef VE_MOCK_OPENXR
+// Simulated CPU cost of recording one render pass (busy wait), for pipelining comparisons
+static uint32_t     mockDrawUs = 0;
+
+// Run summary lines: to the debugger and to the console of the benchmark host
+static void ve_report(const char* text) {
+	OutputDebugStringA(text);
+	printf("%s", text);
+}
+#endif
+
+static bool app_depth_required();   // next to app_draw
 
 
 
 
 extern "C" {
-    __declspec(dllexport) int VE_Start();      // start OpenXR loop
+    __declspec(dllexport) int VE_Start();      // run the OpenXR loop on the calling thread until the session exits; -1 if already running
+    __declspec(dllexport) int VE_StartAsync(); // run it on its own thread; 0 started, 1 already running
+    __declspec(dllexport) int VE_Stop();       // stop the loop (either kind) and wait for shutdown; the loop's exit code
 }
 
 BOOL APIENTRY DllMain( HMODULE hModule,
@@ -50,12 +101,65 @@ BOOL APIENTRY DllMain( HMODULE hModule,
     case DLL_THREAD_ATTACH:
     case DLL_THREAD_DETACH:
     case DLL_PROCESS_DETACH:
+        // No joining the VR thread here: it would deadlock on the loader lock. Call VE_Stop first.
         break;
     }
     return TRUE;
 }
 
-__declspec(dllexport) int VE_Start() {
+// Init, frame loop and shutdown; returns when the session exits or `stop` is set
+static int ve_run(const std::atomic<bool>& stop) {
+#ifdef VE_MOCK_OPENXR
+	// Headless benchmark run: VE_MOCK_FRAMES frames (default 2000), VE_MOCK_UNTHROTTLED=1 to
+	// let xrWaitFrame return immediately and measure the loop's own throughput
+	{
+		mock_xr_config_t mock_config;
+		const std::string frames = env_var("VE_MOCK_FRAMES");
+		mock_config.exit_after_frames = frames.empty() ? 2000 : (uint32_t)atoi(frames.c_str());
+		mock_config.throttle = env_var("VE_MOCK_UNTHROTTLED").empty();
+
+		// Input latency benchmark: VE_MOCK_INPUT=1 toggles every bound input every 125 ms (this sends
+		// real keys/clicks through the profile), VE_MOCK_INPUT_HZ picks the polling model (0 = per frame)
+		if (!env_var("VE_MOCK_INPUT").empty()) {
+			mock_config.input = [](const std::string&, double seconds) {
+				float v = fmod(seconds, 0.25) < 0.125 ? 1.0f : 0.0f;
+				return XrVector2f{ v, v };
+			};
+		}
+		const std::string hz = env_var("VE_MOCK_INPUT_HZ");
+		if (!hz.empty())
+			inputRateHz = (uint32_t)atoi(hz.c_str());
+
+		// Throughput comparison: VE_MOCK_DRAW_US=<us per pass> for a heavy draw workload,
+		// VE_MOCK_PIPELINE=1 to overlap xrWaitFrame with it on the pacer thread
+		const std::string draw = env_var("VE_MOCK_DRAW_US");
+		if (!draw.empty())
+			mockDrawUs = (uint32_t)atoi(draw.c_str());
+		xr_pipelined_frames = !env_var("VE_MOCK_PIPELINE").empty();
+		// VE_MOCK_DYNRES=1 lets the resolution controller react to that workload
+		xr_dynamic_resolution = !env_var("VE_MOCK_DYNRES").empty();
+		// VE_MOCK_SINGLE_PASS=1 renders both eyes in one instanced pass (openxr_init falls back to a
+		// pass per eye if the GPU can't)
+		xr_single_pass = !env_var("VE_MOCK_SINGLE_PASS").empty();
+
+		// Idle/state-change benchmark: VE_MOCK_READY_MS delays READY (idle before the session runs),
+		// VE_MOCK_HIDE_MS hides the session for that long once it has rendered 500 frames
+		const std::string ready = env_var("VE_MOCK_READY_MS");
+		if (!ready.empty())
+			mock_config.ready_delay_ms = (uint32_t)atoi(ready.c_str());
+		const std::string hide = env_var("VE_MOCK_HIDE_MS");
+		if (!hide.empty()) {
+			mock_config.hide_at_frame = 500;
+			mock_config.hide_ms = (uint32_t)atoi(hide.c_str());
+		}
+		mock_xr_configure(mock_config);
+		g_frame_timer.SetEnabled(true);
+	}
+#endif
+
+	// Depth buffers only if something app_draw draws depth tests
+	d3d_depth_required = app_depth_required();
+
 	if (!openxr_init("VirtualExtent", d3d_swapchain_fmt)) {
 		d3d_shutdown();
 		MessageBox(nullptr, L"OpenXR initialization failed\n", L"Error", 1);
@@ -63,6 +167,9 @@ __declspec(dllexport) int VE_Start() {
 	}
 
 	// Load controller map
+	controllerConfig = ControllerConfig();
+	selectedProfile = nullptr;
+	compiledProfile = CompiledProfile();
 	if (load_controller_config("C:\\Users\\calle\\projects\\VirtualExtent\\controller_map.json", controllerConfig)) {
 		if (!controllerConfig.controller_maps.empty()) {
 			selectedProfile = &controllerConfig.controller_maps.back();
@@ -73,30 +180,151 @@ __declspec(dllexport) int VE_Start() {
 		printf("Failed to load controller config. Using built-in fallback.\n");
 	}
 
+	if (!selectedProfile) {
+		OutputDebugStringA("No controller profile loaded: hand poses only\n");
+		selectedProfile = &fallbackProfile;
+	}
+
 	OutputDebugStringA("Controller config loaded: exe\n\n\n\n\n\n\n\n\n\n");
 	print_controller_map(*selectedProfile);
 	//OutputDebugStringA(controllerConfig.exe_name_hash.c_str());
 	openxr_generate_actions(*selectedProfile);
+	compile_controller_profile(*selectedProfile, xr_input.handSubactionPath, compiledProfile);
+
+#ifdef _DEBUG
+	// Per-phase frame timing, summarized to the debug output every FrameTimer::kCapacity frames
+	g_frame_timer.SetEnabled(true);
+#endif
 
 	// Init modules
 	//Cubes_Init();
 	DesktopPlane_Init(/*widthMeters*/3.0f, /*distanceMeters*/1.5f, /*outputIndex*/0);
 	Controllers_Init();
 
+	// Controller input on its own thread, independent of frame rate and of the idle sleep below
+	if (inputRateHz)
+		inputThread.Start(&compiledProfile, inputRateHz);
+
+	// Timed key releases (taps, held characters), on a high-resolution timer of its own
+	g_key_scheduler.Start(&input_sendinput_sink());
+
+	// Allocation audit (VE_ALLOC_AUDIT builds): heap allocations by this thread in focused frames
+	// after warm-up, plus those of the input thread's polls (it counts its own). The steady-state
+	// loop is expected to do none.
+	const uint32_t allocWarmupFrames = 120;
+	uint64_t       allocFrames = 0, allocSteady = 0, allocInput = 0;
+
+#ifdef VE_MOCK_OPENXR
+	const uint64_t runStartNs = FrameTimer::Now();
+	InputLatency   stateLatency;   // runtime state change -> seen by this loop
+	XrTime         stateTimeSeen = 0;
+#endif
+
 	bool quit = false;
-	while (!quit) {
+	while (!quit && !stop.load(std::memory_order_acquire)) {
 		openxr_poll_events(quit);
+#ifdef VE_MOCK_OPENXR
+		if (xr_session_state_time != stateTimeSeen) {
+			stateTimeSeen = xr_session_state_time;
+			stateLatency.Record(FrameTimer::Now() - (uint64_t)stateTimeSeen);
+		}
+#endif
 
 		if (xr_running) {
-			poll_controller_profile(*selectedProfile);
+			// Paced by xrWaitFrame, which the runtime throttles while the session is not visible
+			const uint64_t allocsBefore = alloc_audit_thread_count();
+			if (!inputThread.Running()) {
+				FramePhaseScope t(FP_PollProfile);
+				frameInput.inputCount = (uint32_t)std::min<size_t>(compiledProfile.inputs.size(), InputSnapshot::kMaxInputs);
+				poll_controller_profile(compiledProfile, frameInput.inputs, frameInput.inputCount);
+				frameInput.seq++;
+				frameInput.sampledNs = FrameTimer::Now();
+				frameInput.focused = xr_session_state == XR_SESSION_STATE_FOCUSED;
+			}
 			openxr_render_frame();
+			if (xr_session_state == XR_SESSION_STATE_FOCUSED && ++allocFrames > allocWarmupFrames)
+				allocSteady += alloc_audit_thread_count() - allocsBefore;
+		}
+		else if (!quit) {
+			idleWaiter.Wait();
+		}
+	}
 
-			if (xr_session_state != XR_SESSION_STATE_VISIBLE &&
-				xr_session_state != XR_SESSION_STATE_FOCUSED) {
-				this_thread::sleep_for(chrono::milliseconds(250));
-			}
+	inputThread.Stop();
+	allocInput = inputThread.SteadyAllocations();
+	g_key_scheduler.Stop();  // after the last poll: sends any release still pending
+
+#ifdef VE_MOCK_OPENXR
+	{
+		static FrameTimer::Scratch timing_scratch;
+		char report[2048];
+		g_frame_timer.Format(report, sizeof(report), timing_scratch);
+		ve_report(report);
+
+		mock_xr_stats_t stats = mock_xr_stats();
+		sprintf_s(report, "Mock OpenXR: %llu frames, %llu projection layers, %llu quad layers, %llu images released (%llu quad), %llu action syncs\n",
+			stats.frames_ended, stats.projection_layers, stats.quad_layers,
+			stats.images_released, stats.quad_images_released, stats.actions_synced);
+		ve_report(report);
+
+		sprintf_s(report, "Mock actions: %llu created, %llu path conversions, %.1f state queries per sync\n",
+			stats.actions_created, stats.paths_converted,
+			stats.actions_synced ? (double)stats.action_state_queries / stats.actions_synced : 0.0);
+		ve_report(report);
+
+		stateLatency.Format("Session state change latency", report, sizeof(report));
+		ve_report(report);
+		sprintf_s(report, "Idle: %llu wakeups (%llu notified) over %.1f ms\n",
+			idleWaiter.Wakeups(), idleWaiter.Notified(), (double)idleWaiter.IdleNs() * 1e-6);
+		ve_report(report);
+
+		const auto& binds = d3d_state.Total();
+		sprintf_s(report, "State filter: %.1f binds issued, %.1f dropped per frame\n",
+			stats.frames_ended ? (double)binds.issued / stats.frames_ended : 0.0,
+			stats.frames_ended ? (double)binds.dropped / stats.frames_ended : 0.0);
+		ve_report(report);
+
+		sprintf_s(report, "Cursor: %llu warps, %llu suppressed\n", g_cursor_warp.Warps(), g_cursor_warp.Suppressed());
+		ve_report(report);
+
+		const InputInjector::Stats injected = InputInjector::TotalStats();
+		sprintf_s(report, "Injection: %llu events in %llu SendInput calls (largest %u)\n",
+			injected.events, injected.batches, injected.largest);
+		ve_report(report);
+
+		const KeyScheduler::Stats keys = g_key_scheduler.GetStats();
+		sprintf_s(report, "Key scheduler: %llu events in %llu batches, %.3f ms late on average, %.3f ms max\n",
+			keys.fired, keys.batches, keys.fired ? (double)keys.lateSumNs / keys.fired * 1e-6 : 0.0,
+			(double)keys.lateMaxNs * 1e-6);
+		ve_report(report);
+
+		sprintf_s(report, "Resolution: scale %.2f after %llu changes\n", openxr_resolution_scale(), openxr_resolution_changes());
+		ve_report(report);
+
+		const double runSeconds = (double)(FrameTimer::Now() - runStartNs) * 1e-9;
+		sprintf_s(report, "Throughput: %.1f frames/s (%s, %u us draw per pass)\n",
+			runSeconds > 0 ? (double)stats.frames_ended / runSeconds : 0.0,
+			xr_pipelined_frames ? "pipelined" : "serial", mockDrawUs);
+		ve_report(report);
+
+		char label[64];
+		if (inputRateHz) sprintf_s(label, "Input latency (thread, %u Hz)", inputRateHz);
+		else             sprintf_s(label, "Input latency (per frame)");
+		inputLatency.Format(label, report, sizeof(report));
+		ve_report(report);
+		if (inputRateHz) {
+			inputStateAge.Format("Input state age at frame", report, sizeof(report));
+			ve_report(report);
+		}
+
+		if (alloc_audit_enabled()) {
+			sprintf_s(report, "Allocations: %llu in %llu steady-state frames (after %u warm-up), %llu on the input thread, frame arena high water %zu of %zu bytes\n",
+				allocSteady, allocFrames > allocWarmupFrames ? allocFrames - allocWarmupFrames : 0, allocWarmupFrames,
+				allocInput, g_frame_arena.HighWater(), g_frame_arena.Capacity());
+			ve_report(report);
 		}
 	}
+#endif
 
 	// Shutdown modules
 	DesktopPlane_Shutdown();
@@ -105,21 +333,98 @@ __declspec(dllexport) int VE_Start() {
 
 	openxr_shutdown();
 	d3d_shutdown();
+
+	// Audited runs fail if the steady-state loop allocated
+	if (alloc_audit_enabled() && allocSteady + allocInput != 0)
+		return 2;
 	return 0;
 }
 
+__declspec(dllexport) int VE_Start() {
+	// Through vrThread like VE_StartAsync, so the two never run the loop at once
+	int exit_code = -1;
+	if (!vrThread.Run(ve_run, [] { idleWaiter.Notify(); }, &exit_code))
+		return -1;
+	return exit_code;
+}
+
+__declspec(dllexport) int VE_StartAsync() {
+	// Stopping ends the session from our side: the loop exits and openxr_shutdown destroys it
+	return vrThread.Start(ve_run, [] { idleWaiter.Notify(); }) ? 0 : 1;
+}
+
+__declspec(dllexport) int VE_Stop() {
+	return vrThread.Stop();
+}
+
 
 void app_update_predicted() {
     // Called between xrBeginFrame and app draw; keep cube hands predicted
     Cubes_UpdatePredicted();
+
+    // Latest captured desktop frame, once per frame (not per eye)
+    DesktopPlane_Update();
+
+    // The frame sees input state only through a snapshot, taken once here; and how stale the
+    // newest one is by the time this frame sees it
+    bool fresh = false;
+    currentInput = inputThread.Running() ? &inputThread.Latest(&fresh) : &frameInput;
+    if (fresh && currentInput->focused)
+        inputStateAge.Record(FrameTimer::Now() - currentInput->sampledNs);
+}
+
+void app_update_latched() {
+    // Called once per frame after the hands are late-latched, before the first pass: pointer rays,
+    // desktop hits and the cursor warp from the pose every pass draws with, read by drawing and
+    // input alike
+    Controllers_UpdateInteraction();
+}
+
+void app_session_state_changed(XrSessionState state) {
+    (void)state;
+    // The input thread parks while the session is not focused
+    inputThread.SessionStateChanged();
+    // State changes come in runs (READY, SYNCHRONIZED, VISIBLE...): poll again without sleeping
+    idleWaiter.Notify();
 }
 
-void app_draw(XrCompositionLayerProjectionView& view) {
-    // 1) Draw the fixed desktop plane
-    DesktopPlane_Draw(view);
+void app_input_changed(XrTime change_time) {
+#ifdef VE_MOCK_OPENXR
+    // The mock's XrTime is the steady clock, so change-to-dispatch latency can be measured directly
+    inputLatency.Record(FrameTimer::Now() - (uint64_t)change_time);
+#else
+    (void)change_time;
+#endif
+}
+
+bool app_quad_pose(const XrPosef& head_pose, XrPosef& out_pose, XrExtent2Df& out_size) {
+    return DesktopPlane_QuadPose(head_pose, &out_pose, &out_size);
+}
+
+// What app_draw draws in this configuration, and which of it depth tests; keep the two in step
+static bool app_depth_required() {
+    const DepthUser users[] = {
+        { !xr_quad_layer_mode, DesktopPlane_NeedsDepth() },
+        { true,                Controllers_NeedsDepth() },
+        { false,               Cubes_NeedsDepth() },   // commented out in app_draw
+    };
+    return DepthRequired(users, (uint32_t)_countof(users));
+}
+
+void app_draw(const XrCompositionLayerProjectionView* views, uint32_t view_count) {
+#ifdef VE_MOCK_OPENXR
+    if (mockDrawUs) {
+        const uint64_t until = FrameTimer::Now() + (uint64_t)mockDrawUs * 1000;
+        while (FrameTimer::Now() < until) {}
+    }
+#endif
+
+    // 1) Draw the fixed desktop plane (unless the compositor draws it as a quad layer)
+    if (!xr_quad_layer_mode)
+        DesktopPlane_Draw(views, view_count);
 
-    Controllers_Draw(view);
+    Controllers_Draw(views, view_count);
 
     // 2) Draw the cubes
-    //Cubes_Draw(view);
+    //Cubes_Draw(views, view_count);
 }
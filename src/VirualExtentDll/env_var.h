@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdlib>
+#include <string>
+
+// Value of an environment variable, empty if it is not set. getenv is deprecated by the MSVC CRT,
+// and the dll builds with /sdl, which turns that warning (C4996) into an error.
+inline std::string env_var(const char* name) {
+    std::string value;
+#ifdef _WIN32
+    char*  buffer = nullptr;
+    size_t length = 0;
+    if (_dupenv_s(&buffer, &length, name) == 0 && buffer) {
+        value = buffer;
+        free(buffer);
+    }
+#else
+    if (const char* v = std::getenv(name))
+        value = v;
+#endif
+    return value;
+}
@@ -0,0 +1,49 @@
+#include "pch.h"
+#include "frame_arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+FrameArena g_frame_arena;
+
+static void log_message(const char* msg) {
+#ifdef _WIN32
+    OutputDebugStringA(msg);
+#else
+    fputs(msg, stderr);
+#endif
+}
+
+bool FrameArena::Init(size_t capacity) {
+    Shutdown();
+    base_ = (uint8_t*)malloc(capacity);
+    if (!base_) {
+        log_message("FrameArena: failed to reserve memory\n");
+        return false;
+    }
+    capacity_ = capacity;
+    return true;
+}
+
+void FrameArena::Shutdown() {
+    if (failures_) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "FrameArena: %llu allocations did not fit in %zu bytes\n", (unsigned long long)failures_, capacity_);
+        log_message(msg);
+    }
+    free(base_);
+    base_ = nullptr;
+    capacity_ = used_ = highWater_ = 0;
+    failures_ = 0;
+}
+
+void* FrameArena::Alloc(size_t bytes, size_t align) {
+    size_t offset = (used_ + align - 1) & ~(align - 1);
+    if (!base_ || offset + bytes > capacity_) {
+        failures_++;
+        return nullptr;
+    }
+    used_ = offset + bytes;
+    if (used_ > highWater_) highWater_ = used_;
+    return base_ + offset;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Scratch memory for one frame of the render thread.
+//
+// One block is reserved up front; Alloc bumps an offset and Reset at the top of each frame hands
+// everything back. Running out returns nullptr (and is counted) instead of falling back to the
+// heap, so the steady-state frame loop never allocates. Nothing is destructed: only put trivially
+// destructible data in here.
+class FrameArena {
+public:
+    // capacity: what one frame puts in here, worst case; HighWater() tells how much it really was
+    bool Init(size_t capacity);
+    void Shutdown();
+
+    // Render thread only
+    void  Reset() { used_ = 0; }
+    void* Alloc(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    // `count` value-initialized Ts, or nullptr when the arena is full
+    template <typename T>
+    T* AllocArray(size_t count, const T& init = T{}) {
+        T* out = (T*)Alloc(sizeof(T) * count, alignof(T));
+        if (out) {
+            for (size_t i = 0; i < count; i++)
+                new (&out[i]) T(init);
+        }
+        return out;
+    }
+
+    size_t   Capacity() const { return capacity_; }
+    size_t   HighWater() const { return highWater_; }
+    uint64_t Failures() const { return failures_; }
+
+private:
+    uint8_t* base_ = nullptr;
+    size_t   capacity_ = 0;
+    size_t   used_ = 0;
+    size_t   highWater_ = 0;
+    uint64_t failures_ = 0;
+};
+
+extern FrameArena g_frame_arena;
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "frame_pacer.h"
+#include "frame_timing.h" // FrameTimer::Now
+
+bool FramePacer::Start(XrSession session, XrEnvironmentBlendMode blend) {
+    if (Running()) return true;
+    session_ = session;
+    blend_ = blend;
+    ready_ = false;
+    ended_ = true;
+    stop_ = false;
+    failed_ = false;
+    thread_ = std::thread(&FramePacer::threadMain, this);
+    return true;
+}
+
+void FramePacer::Stop() {
+    if (!Running()) return;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    // A begun frame has to be ended before the session can stop
+    if (ready_) {
+        XrFrameEndInfo end_info{ XR_TYPE_FRAME_END_INFO };
+        end_info.displayTime = frame_.predictedDisplayTime;
+        end_info.environmentBlendMode = blend_;
+        xrEndFrame(session_, &end_info);
+        ready_ = false;
+    }
+    session_ = XR_NULL_HANDLE;
+}
+
+bool FramePacer::Acquire(XrFrameState* out, uint64_t* beginNs) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    cv_.wait(lk, [this] { return ready_ || stop_; });
+    if (!ready_) return false;
+    *out = frame_;
+    *beginNs = beginNs_;
+    ready_ = false;
+    ended_ = false;
+    return true;
+}
+
+void FramePacer::Submitted() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        ended_ = true;
+    }
+    cv_.notify_all();
+}
+
+void FramePacer::threadMain() {
+    for (;;) {
+        XrFrameState frame = { XR_TYPE_FRAME_STATE };
+        if (XR_FAILED(xrWaitFrame(session_, nullptr, &frame))) {
+            OutputDebugStringA("FramePacer: xrWaitFrame failed, the render thread takes over\n");
+            failed_.store(true, std::memory_order_release);
+            break;
+        }
+
+        // xrBeginFrame(N+1) must follow xrEndFrame(N)
+        std::unique_lock<std::mutex> lk(mutex_);
+        cv_.wait(lk, [this] { return (ended_ && !ready_) || stop_; });
+        if (stop_) break;
+
+        const uint64_t begin = FrameTimer::Now();
+        xrBeginFrame(session_, nullptr);
+        beginNs_ = FrameTimer::Now() - begin;
+
+        frame_ = frame;
+        ready_ = true;
+        lk.unlock();
+        cv_.notify_all();
+    }
+
+    // Don't leave the render thread waiting in Acquire
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+}
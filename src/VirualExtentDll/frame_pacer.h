@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "openxr.h"
+
+// Owns xrWaitFrame/xrBeginFrame on its own thread, so waiting for frame N+1 overlaps recording
+// frame N instead of following it.
+//
+// OpenXR ordering is kept: xrWaitFrame(N+1) is only called after xrBeginFrame(N), and
+// xrBeginFrame(N+1) only after the render thread's xrEndFrame(N) (Submitted()). At most one
+// begun frame is ever outstanding.
+//
+// If xrWaitFrame fails the thread exits and the pacer is Failed(): Acquire returns false, and the
+// render thread is expected to Stop() it and wait for its frames itself.
+class FramePacer {
+public:
+    // Between xrBeginSession and xrEndSession only
+    bool Start(XrSession session, XrEnvironmentBlendMode blend);
+    void Stop();    // ends a frame that was begun but never acquired
+    bool Running() const { return thread_.joinable(); }
+    bool Failed() const { return failed_.load(std::memory_order_acquire); }
+
+    // Render thread: blocks until the next frame has been begun, then records it and calls
+    // xrEndFrame. beginNs is how long xrBeginFrame took on the pacer thread. False once stopping
+    // or failed, with no frame begun.
+    bool Acquire(XrFrameState* out, uint64_t* beginNs);
+    // Render thread: after xrEndFrame of the acquired frame
+    void Submitted();
+
+private:
+    void threadMain();
+
+    XrSession               session_ = XR_NULL_HANDLE;
+    XrEnvironmentBlendMode  blend_ = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+    std::thread             thread_;
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    XrFrameState            frame_ = { XR_TYPE_FRAME_STATE };
+    uint64_t                beginNs_ = 0;     // xrBeginFrame of frame_
+    bool                    ready_ = false;   // frame_ begun, not yet acquired
+    bool                    ended_ = true;    // no acquired frame waiting for xrEndFrame
+    bool                    stop_ = false;
+    std::atomic<bool>       failed_ = false;
+};
@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "frame_timing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+FrameTimer g_frame_timer;
+
+const char* frame_phase_name(FramePhase phase) {
+    switch (phase) {
+    case FP_WaitFrame:        return "xrWaitFrame";
+    case FP_BeginFrame:       return "xrBeginFrame";
+    case FP_PollPredicted:    return "poll_predicted";
+    case FP_PollProfile:      return "poll_profile";
+    case FP_LateLatch:        return "late_latch";
+    case FP_RenderEye0:       return "render_eye0";
+    case FP_RenderEye1:       return "render_eye1";
+    case FP_SwapchainAcquire: return "sc_acquire";
+    case FP_SwapchainWait:    return "sc_wait";
+    case FP_SwapchainRelease: return "sc_release";
+    case FP_EndFrame:         return "xrEndFrame";
+    default:                  return "?";
+    }
+}
+
+const char* frame_metric_name(FrameMetric metric) {
+    switch (metric) {
+    case FM_LatchSavedEye0: return "latch_saved_eye0";
+    case FM_LatchSavedEye1: return "latch_saved_eye1";
+    default:                return "?";
+    }
+}
+
+void FrameTimer::Add(FramePhase phase, uint64_t ns) {
+    if (!Enabled() || phase >= FP_Count) return;
+    if (frameStartNs_ == 0) frameStartNs_ = Now() - ns;
+    uint64_t sum = (uint64_t)current_.phaseNs[phase] + ns;
+    current_.phaseNs[phase] = (uint32_t)std::min<uint64_t>(sum, UINT32_MAX);
+}
+
+void FrameTimer::SetMetric(FrameMetric metric, uint64_t ns) {
+    if (!Enabled() || metric >= FM_Count) return;
+    current_.metricNs[metric] = (uint32_t)std::min<uint64_t>(ns, UINT32_MAX);
+}
+
+void FrameTimer::Commit(int64_t predictedDisplayTime, int64_t predictedDisplayPeriod) {
+    if (!Enabled()) return;
+
+    // Missed frames: consecutive predicted display times should be exactly one period apart
+    current_.missedFrames = 0;
+    if (lastDisplayTime_ != 0 && predictedDisplayPeriod > 0 && predictedDisplayTime > lastDisplayTime_) {
+        int64_t periods = (predictedDisplayTime - lastDisplayTime_ + predictedDisplayPeriod / 2) / predictedDisplayPeriod;
+        if (periods > 1) current_.missedFrames = (uint32_t)(periods - 1);
+    }
+    lastDisplayTime_ = predictedDisplayTime;
+    missedTotal_ += current_.missedFrames;
+
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    current_.frameIndex = head;
+    current_.predictedDisplayTime = predictedDisplayTime;
+    current_.totalNs = frameStartNs_ ? (uint32_t)std::min<uint64_t>(Now() - frameStartNs_, UINT32_MAX) : 0;
+
+    const uint32_t slot = (uint32_t)(head % kCapacity);
+    ringSeq_[slot].store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&ring_[slot], &current_, sizeof(FrameRecord));
+    ringSeq_[slot].store(2 * head + 2, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_release);
+
+    current_ = FrameRecord{};
+    frameStartNs_ = 0;
+}
+
+uint32_t FrameTimer::Snapshot(FrameRecord* out, uint32_t maxRecords) const {
+    // The writer never blocks, so any record may be overwritten while we copy it. Each copy is
+    // kept only if its entry still holds the frame we wanted, before and after the copy.
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t want = std::min<uint64_t>({ head, (uint64_t)kCapacity, (uint64_t)maxRecords });
+    uint32_t n = 0;
+    for (uint64_t frame = head - want; frame < head; frame++) {
+        const uint32_t slot = (uint32_t)(frame % kCapacity);
+        const uint64_t expect = 2 * frame + 2;
+        if (ringSeq_[slot].load(std::memory_order_acquire) != expect)
+            continue;
+        std::memcpy(&out[n], &ring_[slot], sizeof(FrameRecord));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ringSeq_[slot].load(std::memory_order_relaxed) != expect)
+            continue;
+        n++;
+    }
+    return n;
+}
+
+uint32_t FrameTimer::Summarize(FramePhaseSummary out[kSummaryCount], uint64_t* outMissedFrames, Scratch& scratch) const {
+    FrameRecord* records = scratch.records;
+    uint32_t*    values = scratch.values;
+
+    uint32_t n = Snapshot(records, kCapacity);
+    uint64_t missed = 0;
+    for (uint32_t i = 0; i < n; i++) missed += records[i].missedFrames;
+    if (outMissedFrames) *outMissedFrames = missed;
+
+    for (int p = 0; p < kSummaryCount; p++) {
+        out[p] = FramePhaseSummary{};
+        if (n == 0) continue;
+        for (uint32_t i = 0; i < n; i++)
+            values[i] = p < FP_Count ? records[i].phaseNs[p] :
+                        p == FP_Count ? records[i].totalNs : records[i].metricNs[p - FP_Count - 1];
+
+        auto pct = [&](uint32_t q) {
+            uint32_t k = (uint32_t)(((uint64_t)(n - 1) * q) / 100);
+            std::nth_element(values, values + k, values + n);
+            return values[k];
+        };
+        out[p].p50 = pct(50);
+        out[p].p95 = pct(95);
+        out[p].p99 = pct(99);
+    }
+    return n;
+}
+
+size_t FrameTimer::Format(char* buf, size_t size, Scratch& scratch) const {
+    FramePhaseSummary s[kSummaryCount];
+    uint64_t missed = 0;
+    uint32_t n = Summarize(s, &missed, scratch);
+
+    size_t len = 0;
+    auto put = [&](const char* name, const FramePhaseSummary& v) {
+        if (len >= size) return;
+        int w = snprintf(buf + len, size - len, "  %-15s p50 %7.3f  p95 %7.3f  p99 %7.3f ms\n",
+            name, v.p50 / 1e6, v.p95 / 1e6, v.p99 / 1e6);
+        if (w > 0) len += (size_t)w;
+    };
+
+    int w = snprintf(buf, size, "=== Frame timing: %u frames, %llu missed in window, %llu missed total ===\n",
+        n, (unsigned long long)missed, (unsigned long long)missedTotal_);
+    if (w > 0) len = (size_t)w;
+    for (int p = 0; p < FP_Count; p++) put(frame_phase_name((FramePhase)p), s[p]);
+    put("frame total", s[FP_Count]);
+    for (int m = 0; m < FM_Count; m++) put(frame_metric_name((FrameMetric)m), s[FP_Count + 1 + m]);
+    return std::min(len, size ? size - 1 : 0);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Per-phase timing of the OpenXR frame loop.
+//
+// The render thread adds phase durations while it runs a frame and commits one FrameRecord per
+// frame into a fixed-size ring. Nothing allocates and nothing locks: each ring entry carries a
+// sequence number (a seqlock), so readers on other threads drop an entry that was rewritten while
+// they copied it instead of blocking the writer. When disabled at runtime the cost is one relaxed
+// load per phase; building with VE_FRAME_TIMING=0 removes it entirely.
+#ifndef VE_FRAME_TIMING
+#define VE_FRAME_TIMING 1
+#endif
+
+enum FramePhase : uint8_t {
+    FP_WaitFrame,
+    FP_BeginFrame,
+    FP_PollPredicted,
+    FP_PollProfile,
+    FP_LateLatch,          // re-locating hands/views right before each eye
+    FP_RenderEye0,
+    FP_RenderEye1,
+    FP_SwapchainAcquire,   // summed over all swapchains used this frame
+    FP_SwapchainWait,
+    FP_SwapchainRelease,
+    FP_EndFrame,
+    FP_Count
+};
+
+// Per-frame values that are not phase durations
+enum FrameMetric : uint8_t {
+    FM_LatchSavedEye0,     // how much newer the late-latched poses are than the xrBeginFrame sample
+    FM_LatchSavedEye1,
+    FM_Count
+};
+
+const char* frame_phase_name(FramePhase phase);
+const char* frame_metric_name(FrameMetric metric);
+
+struct FrameRecord {
+    uint64_t frameIndex = 0;
+    int64_t  predictedDisplayTime = 0;   // XrTime (ns)
+    uint32_t phaseNs[FP_Count] = {};
+    uint32_t metricNs[FM_Count] = {};
+    uint32_t totalNs = 0;                // first phase start to commit
+    uint32_t missedFrames = 0;           // display periods skipped before this frame
+};
+
+struct FramePhaseSummary {
+    uint32_t p50 = 0, p95 = 0, p99 = 0;  // ns
+};
+
+class FrameTimer {
+public:
+    static constexpr uint32_t kCapacity = 512;
+
+    // Summary layout: phases, frame total (index FP_Count), then metrics
+    static constexpr int kSummaryCount = FP_Count + 1 + FM_Count;
+
+    // Working memory for Summarize/Format (~40 KB), owned by the caller
+    struct Scratch {
+        FrameRecord records[kCapacity];
+        uint32_t    values[kCapacity];
+    };
+
+    static uint64_t Now() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool Enabled() const { return VE_FRAME_TIMING && enabled_.load(std::memory_order_relaxed); }
+
+    // Render thread only
+    void Add(FramePhase phase, uint64_t ns);
+    void SetMetric(FrameMetric metric, uint64_t ns);
+    void Commit(int64_t predictedDisplayTime, int64_t predictedDisplayPeriod);
+
+    // Any thread. Copies up to maxRecords of the most recent records, oldest first. Records the
+    // render thread overwrote during the copy are left out.
+    uint32_t Snapshot(FrameRecord* out, uint32_t maxRecords) const;
+
+    // Percentiles over the records currently in the ring (see kSummaryCount for the layout).
+    uint32_t Summarize(FramePhaseSummary out[kSummaryCount], uint64_t* outMissedFrames, Scratch& scratch) const;
+
+    // Human readable summary (render thread: reads missedTotal_); returns the number of characters written.
+    size_t Format(char* buf, size_t size, Scratch& scratch) const;
+
+    uint64_t FrameCount() const { return head_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool>     enabled_ = false;
+    std::atomic<uint64_t> head_ = 0;       // frames committed so far
+    FrameRecord           current_;
+    uint64_t              frameStartNs_ = 0;
+    int64_t               lastDisplayTime_ = 0;
+    uint64_t              missedTotal_ = 0;
+    FrameRecord           ring_[kCapacity];
+    // Per entry: 2 * frameIndex + 2 once written, odd while the render thread writes it
+    std::atomic<uint64_t> ringSeq_[kCapacity] = {};
+};
+
+extern FrameTimer g_frame_timer;
+
+// Times the enclosing scope into one phase of the current frame.
+class FramePhaseScope {
+public:
+    explicit FramePhaseScope(FramePhase phase) : phase_(phase), start_(g_frame_timer.Enabled() ? FrameTimer::Now() : 0) {}
+    ~FramePhaseScope() { if (start_) g_frame_timer.Add(phase_, FrameTimer::Now() - start_); }
+    FramePhaseScope(const FramePhaseScope&) = delete;
+    FramePhaseScope& operator=(const FramePhaseScope&) = delete;
+private:
+    FramePhase phase_;
+    uint64_t   start_;
+};
@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "high_res_timer.h"
+
+// Portable version; Windows uses high_res_timer_win32.cpp
+#ifndef _WIN32
+
+#include <chrono>
+
+HighResTimer::HighResTimer() : highRes_(true) {}
+HighResTimer::~HighResTimer() = default;
+
+bool HighResTimer::WaitUntil(uint64_t dueNs) {
+    const auto due = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(dueNs));
+    std::unique_lock<std::mutex> lk(mutex_);
+    const bool woken = cv_.wait_until(lk, due, [this] { return woken_; });
+    woken_ = false;
+    return woken;
+}
+
+void HighResTimer::Wait() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    cv_.wait(lk, [this] { return woken_; });
+    woken_ = false;
+}
+
+void HighResTimer::Wake() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        woken_ = true;
+    }
+    cv_.notify_one();
+}
+
+#endif // !_WIN32
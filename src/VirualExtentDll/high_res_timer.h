@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Puts one thread to sleep until a steady-clock deadline (FrameTimer::Now() ns) or until another
+// thread calls Wake(), whichever comes first.
+//
+// On Windows this is a high-resolution waitable timer (CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+// Windows 10 1803+) and an auto-reset event, so deadlines are met to well under a millisecond
+// without raising the system-wide timer resolution with timeBeginPeriod. Older systems fall back
+// to a plain waitable timer (system tick). Elsewhere it is a condition variable, which is what
+// the tests run on. A Wake() with nobody waiting is kept for the next wait.
+class HighResTimer {
+public:
+    HighResTimer();
+    ~HighResTimer();
+    HighResTimer(const HighResTimer&) = delete;
+    HighResTimer& operator=(const HighResTimer&) = delete;
+
+    // The sleeping thread. True if woken, false when the deadline passed.
+    bool WaitUntil(uint64_t dueNs);
+    // Until woken, however long that takes
+    void Wait();
+
+    // Any thread
+    void Wake();
+
+    // False if the OS only offered its regular tick
+    bool HighResolution() const { return highRes_; }
+
+private:
+    bool highRes_ = false;
+
+#ifdef _WIN32
+    void* timer_ = nullptr;   // HANDLE
+    void* event_ = nullptr;   // HANDLE
+#else
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    bool                    woken_ = false;
+#endif
+};
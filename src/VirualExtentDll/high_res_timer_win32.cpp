@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "high_res_timer.h"
+
+#ifdef _WIN32
+
+#include "frame_timing.h" // FrameTimer::Now
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+HighResTimer::HighResTimer() {
+    timer_ = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    highRes_ = timer_ != nullptr;
+    if (!timer_)
+        timer_ = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    event_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+}
+
+HighResTimer::~HighResTimer() {
+    if (timer_) CloseHandle(timer_);
+    if (event_) CloseHandle(event_);
+}
+
+bool HighResTimer::WaitUntil(uint64_t dueNs) {
+    const uint64_t now = FrameTimer::Now();
+    if (dueNs <= now)
+        return WaitForSingleObject(event_, 0) == WAIT_OBJECT_0;
+
+    // Relative due time, in 100 ns units (negative = relative)
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)((dueNs - now + 99) / 100);
+    if (!SetWaitableTimer(timer_, &due, 0, nullptr, nullptr, FALSE))
+        return WaitForSingleObject(event_, (DWORD)((dueNs - now + 999999) / 1000000)) == WAIT_OBJECT_0;
+
+    HANDLE handles[2] = { event_, timer_ };
+    const DWORD r = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+    if (r == WAIT_OBJECT_0) {
+        CancelWaitableTimer(timer_);
+        return true;
+    }
+    return false;
+}
+
+void HighResTimer::Wait() {
+    WaitForSingleObject(event_, INFINITE);
+}
+
+void HighResTimer::Wake() {
+    SetEvent(event_);
+}
+
+#endif // _WIN32
@@ -0,0 +1,11 @@
+#include "pch.h"
+#include "idle_waiter.h"
+#include "frame_timing.h"
+
+void IdleWaiter::Wait() {
+    const uint64_t start = FrameTimer::Now();
+    if (timer_.WaitUntil(start + kPollNs))
+        notified_.fetch_add(1, std::memory_order_relaxed);
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    idleNs_.fetch_add(FrameTimer::Now() - start, std::memory_order_relaxed);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "high_res_timer.h"
+
+// Blocks the main loop while there is no frame loop to run (session not running).
+//
+// OpenXR has no blocking event wait: the only way to see a session state change is to call
+// xrPollEvent. So the wait is a fixed kPollNs on a HighResTimer, short enough that the loop
+// resumes within about a millisecond of the runtime reporting VISIBLE. Wake sources we own
+// (shutdown, the session-state and input hooks) call Notify() and end the wait at once; a Notify
+// with nobody waiting makes the next Wait return immediately. While the session runs,
+// xrWaitFrame paces the loop instead, and the runtime throttles it when the session is not visible.
+class IdleWaiter {
+public:
+    static constexpr uint64_t kPollNs = 1000000;
+
+    // Main loop: sleeps until Notify() or kPollNs, whichever comes first
+    void Wait();
+
+    // Any thread
+    void Notify() { timer_.Wake(); }
+
+    uint64_t Wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+    uint64_t Notified() const { return notified_.load(std::memory_order_relaxed); }
+    uint64_t IdleNs() const { return idleNs_.load(std::memory_order_relaxed); }
+
+private:
+    HighResTimer            timer_;
+
+    std::atomic<uint64_t>   wakeups_ = 0;
+    std::atomic<uint64_t>   notified_ = 0;   // wakeups by Notify() rather than the poll interval
+    std::atomic<uint64_t>   idleNs_ = 0;
+};
@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "input_injection.h"
+
+// ---------- RecordingSink ----------
+
+void RecordingSink::Submit(const InjectedEvent* events, uint32_t count) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    batches_.emplace_back(events, events + count);
+}
+
+std::vector<std::vector<InjectedEvent>> RecordingSink::Batches() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return batches_;
+}
+
+void RecordingSink::Clear() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    batches_.clear();
+}
+
+// ---------- InputInjector ----------
+
+static std::atomic<uint64_t> s_totalEvents = 0;
+static std::atomic<uint64_t> s_totalBatches = 0;
+static std::atomic<uint32_t> s_totalLargest = 0;
+
+InputInjector::InputInjector(IInputSink* sink) : sink_(sink) {
+    queue_.reserve(kReserve);
+}
+
+void InputInjector::Queue(const InjectedEvent& e) {
+    queue_.push_back(e);
+}
+
+void InputInjector::MouseMoveTo(int32_t x, int32_t y) {
+    InjectedEvent e;
+    e.kind = InjectedEvent::MouseMove;
+    e.x = x;
+    e.y = y;
+    Queue(e);
+}
+
+void InputInjector::MouseButton(bool right, bool down) {
+    InjectedEvent e;
+    e.kind = InjectedEvent::MouseButton;
+    e.right = right;
+    e.down = down;
+    Queue(e);
+}
+
+void InputInjector::MouseWheel(int32_t delta) {
+    InjectedEvent e;
+    e.kind = InjectedEvent::MouseWheel;
+    e.wheel = delta;
+    Queue(e);
+}
+
+void InputInjector::Key(uint16_t scan, bool extended, bool down) {
+    InjectedEvent e;
+    e.kind = InjectedEvent::Key;
+    e.scan = scan;
+    e.extended = extended;
+    e.down = down;
+    Queue(e);
+}
+
+uint32_t InputInjector::Flush() {
+    const uint32_t count = (uint32_t)queue_.size();
+    if (count == 0)
+        return 0;
+
+    if (sink_)
+        sink_->Submit(queue_.data(), count);
+    queue_.clear();
+
+    events_.fetch_add(count, std::memory_order_relaxed);
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    if (count > largest_.load(std::memory_order_relaxed))
+        largest_.store(count, std::memory_order_relaxed);
+
+    s_totalEvents.fetch_add(count, std::memory_order_relaxed);
+    s_totalBatches.fetch_add(1, std::memory_order_relaxed);
+    uint32_t largest = s_totalLargest.load(std::memory_order_relaxed);
+    while (count > largest && !s_totalLargest.compare_exchange_weak(largest, count, std::memory_order_relaxed)) {}
+    return count;
+}
+
+InputInjector::Stats InputInjector::GetStats() const {
+    Stats s;
+    s.events = events_.load(std::memory_order_relaxed);
+    s.batches = batches_.load(std::memory_order_relaxed);
+    s.largest = largest_.load(std::memory_order_relaxed);
+    return s;
+}
+
+InputInjector::Stats InputInjector::TotalStats() {
+    Stats s;
+    s.events = s_totalEvents.load(std::memory_order_relaxed);
+    s.batches = s_totalBatches.load(std::memory_order_relaxed);
+    s.largest = s_totalLargest.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Synthetic mouse/keyboard input. Producers (the action evaluator, the key scheduler) queue the
+// events of one input tick on an InputInjector and Flush() it once at the end of the tick; the
+// sink then receives the whole tick as one ordered batch, which on Windows is one SendInput call
+// instead of one per event.
+//
+// The events and the injector are plain C++; only the SendInput sink and the virtual-key helpers
+// (input_injection_win32.cpp) touch Win32, so ordering and batching can be checked with
+// RecordingSink.
+
+struct InjectedEvent {
+    enum Kind : uint8_t {
+        MouseMove,     // absolute, x/y in virtual-desktop pixels
+        MouseButton,   // right, down
+        MouseWheel,    // wheel: +120 up, -120 down
+        Key,           // scan, extended, down
+    };
+
+    Kind     kind = MouseMove;
+    bool     down = false;
+    bool     right = false;
+    bool     extended = false;
+    uint16_t scan = 0;
+    int32_t  x = 0, y = 0;
+    int32_t  wheel = 0;
+};
+
+class IInputSink {
+public:
+    virtual ~IInputSink() = default;
+    // One batch, in the order the events were queued. May be called from several threads.
+    virtual void Submit(const InjectedEvent* events, uint32_t count) = 0;
+};
+
+// Keeps every batch, for checking order and batch sizes without injecting anything
+class RecordingSink : public IInputSink {
+public:
+    void Submit(const InjectedEvent* events, uint32_t count) override;
+
+    std::vector<std::vector<InjectedEvent>> Batches() const;
+    void Clear();
+
+private:
+    mutable std::mutex                      mutex_;
+    std::vector<std::vector<InjectedEvent>> batches_;
+};
+
+// Per-producer queue: not thread-safe, give each thread that injects its own (they can share a
+// sink). The queue starts with room for kReserve events and grows if a tick queues more, so a
+// tick is always one batch; after the first few ticks it no longer allocates.
+class InputInjector {
+public:
+    static constexpr uint32_t kReserve = 64;
+
+    explicit InputInjector(IInputSink* sink = nullptr);
+
+    void SetSink(IInputSink* sink) { sink_ = sink; }
+
+    void MouseMoveTo(int32_t x, int32_t y);
+    void MouseButton(bool right, bool down);
+    void MouseWheel(int32_t delta);
+    void Key(uint16_t scan, bool extended, bool down);
+    void Queue(const InjectedEvent& e);
+
+    uint32_t Pending() const { return (uint32_t)queue_.size(); }
+
+    // Submits the queued events as one batch; returns how many there were
+    uint32_t Flush();
+
+    struct Stats {
+        uint64_t events = 0;
+        uint64_t batches = 0;     // Submit calls
+        uint32_t largest = 0;     // events in the largest batch
+    };
+    // Safe to read from another thread while the owner injects
+    Stats GetStats() const;
+    // Summed over every injector in the process
+    static Stats TotalStats();
+
+private:
+    IInputSink*                sink_ = nullptr;
+    std::vector<InjectedEvent> queue_;
+
+    std::atomic<uint64_t>      events_ = 0;
+    std::atomic<uint64_t>      batches_ = 0;
+    std::atomic<uint32_t>      largest_ = 0;
+};
+
+// ---------- Windows (input_injection_win32.cpp) ----------
+
+// Converts each batch to an INPUT array and injects it with a single SendInput call, whatever
+// its size. Any thread.
+IInputSink& input_sendinput_sink();
+
+// A key event by virtual-key code, as a scan code for the current keyboard layout.
+// False if the key has no scan code there.
+bool input_key_event(uint16_t vk, bool down, InjectedEvent* out);
+// Same, queued on in
+bool input_key_vk(InputInjector& in, uint16_t vk, bool down);
+
+// The calling thread's injector on the SendInput sink, created on first use: the input thread's
+// polls, per-frame polls on the render thread (inputRateHz 0) and the helpers in controllers.cpp
+// each queue and flush their own, so no two threads ever share a queue. Flushed once per poll.
+extern thread_local InputInjector g_input;
@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "input_injection.h"
+
+#include <Windows.h>
+#include <vector>
+
+class SendInputSink : public IInputSink {
+public:
+    void Submit(const InjectedEvent* events, uint32_t count) override {
+        // Per calling thread, grown to the largest batch it has submitted
+        static thread_local std::vector<INPUT> in;
+        in.assign(count, INPUT{});
+
+        // Absolute moves are normalised to [0..65535] across the *virtual* desktop
+        const int vx = GetSystemMetrics(SM_XVIRTUALSCREEN);
+        const int vy = GetSystemMetrics(SM_YVIRTUALSCREEN);
+        const int vw = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+        const int vh = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+
+        for (uint32_t i = 0; i < count; i++) {
+            const InjectedEvent& e = events[i];
+            switch (e.kind) {
+            case InjectedEvent::MouseMove:
+                in[i].type = INPUT_MOUSE;
+                in[i].mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE | MOUSEEVENTF_VIRTUALDESK;
+                in[i].mi.dx = vw > 1 ? (LONG)(((double)(e.x - vx) * 65535.0) / (double)(vw - 1) + 0.5) : 0;
+                in[i].mi.dy = vh > 1 ? (LONG)(((double)(e.y - vy) * 65535.0) / (double)(vh - 1) + 0.5) : 0;
+                break;
+            case InjectedEvent::MouseButton:
+                in[i].type = INPUT_MOUSE;
+                in[i].mi.dwFlags = e.right ? (e.down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP)
+                                           : (e.down ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP);
+                break;
+            case InjectedEvent::MouseWheel:
+                in[i].type = INPUT_MOUSE;
+                in[i].mi.dwFlags = MOUSEEVENTF_WHEEL;
+                in[i].mi.mouseData = (DWORD)e.wheel; // +120 = scroll up, -120 = scroll down
+                break;
+            case InjectedEvent::Key:
+                in[i].type = INPUT_KEYBOARD;
+                in[i].ki.wScan = e.scan;
+                in[i].ki.dwFlags = KEYEVENTF_SCANCODE | (e.down ? 0 : KEYEVENTF_KEYUP) |
+                                   (e.extended ? KEYEVENTF_EXTENDEDKEY : 0);
+                break;
+            }
+        }
+        if (count > 0)
+            SendInput(count, in.data(), sizeof(INPUT));
+    }
+};
+
+IInputSink& input_sendinput_sink() {
+    static SendInputSink sink;
+    return sink;
+}
+
+thread_local InputInjector g_input(&input_sendinput_sink());
+
+static bool NeedsExtended(WORD vk) {
+    switch (vk) {
+    case VK_INSERT: case VK_DELETE: case VK_HOME: case VK_END:
+    case VK_PRIOR:  case VK_NEXT:   // PageUp/PageDown
+    case VK_RIGHT:  case VK_LEFT:   case VK_UP:   case VK_DOWN:
+    case VK_NUMLOCK: case VK_DIVIDE: case VK_RMENU: case VK_RCONTROL:
+        // NOTE: main Enter is not extended; numpad Enter would be, but shares VK_RETURN.
+        // If you specifically want numpad Enter-as-extended, set the flag yourself.
+        return true;
+    default: return false;
+    }
+}
+
+bool input_key_event(uint16_t vk, bool down, InjectedEvent* out) {
+    HKL kl = GetKeyboardLayout(0);
+    UINT sc = MapVirtualKeyEx(vk, MAPVK_VK_TO_VSC_EX, kl);
+    if (sc == 0) return false;
+    *out = {};
+    out->kind = InjectedEvent::Key;
+    out->scan = (uint16_t)sc;
+    out->extended = NeedsExtended(vk);
+    out->down = down;
+    return true;
+}
+
+bool input_key_vk(InputInjector& in, uint16_t vk, bool down) {
+    InjectedEvent e;
+    if (!input_key_event(vk, down, &e)) return false;
+    in.Queue(e);
+    return true;
+}
@@ -0,0 +1,110 @@
+#include "pch.h"
+#define WIN32_LEAN_AND_MEAN
+#include "input_thread.h"
+#include "openxr.h"       // poll_controller_profile, xr_session_state
+#include "frame_timing.h" // FrameTimer::Now
+#include "alloc_audit.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <Windows.h>
+
+// ---------- InputLatency ----------
+
+void InputLatency::Record(uint64_t ns) {
+    const uint64_t n = count_.load(std::memory_order_relaxed);
+    samples_[n % kCapacity] = (uint32_t)std::min<uint64_t>(ns, UINT32_MAX);
+    count_.store(n + 1, std::memory_order_release);
+}
+
+size_t InputLatency::Format(const char* label, char* buf, size_t size) const {
+    static uint32_t values[kCapacity];
+
+    const uint64_t total = Count();
+    const uint32_t n = (uint32_t)std::min<uint64_t>(total, kCapacity);
+    std::copy(samples_, samples_ + n, values);
+
+    auto pct = [&](uint32_t q) -> double {
+        if (n == 0) return 0.0;
+        uint32_t k = (uint32_t)(((uint64_t)(n - 1) * q) / 100);
+        std::nth_element(values, values + k, values + n);
+        return values[k] / 1e6;
+    };
+    const double p50 = pct(50), p95 = pct(95), p99 = pct(99), pmax = pct(100);
+
+    int w = snprintf(buf, size, "%s: %llu changes, p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms\n",
+        label, (unsigned long long)total, p50, p95, p99, pmax);
+    return w > 0 ? std::min((size_t)w, size ? size - 1 : 0) : 0;
+}
+
+// ---------- InputThread ----------
+
+bool InputThread::Start(CompiledProfile* profile, uint32_t rateHz) {
+    if (!profile || rateHz == 0 || Running()) return false;
+
+    profile_ = profile;
+    rateHz_ = rateHz;
+    for (int i = 0; i < 3; i++) snapshots_.Slot(i) = InputSnapshot{};
+    snapshots_.Reset();
+    polls_ = 0;
+    allocs_ = 0;
+
+    stop_ = false;
+    thread_ = std::thread(&InputThread::threadMain, this);
+    return true;
+}
+
+void InputThread::Stop() {
+    stop_ = true;
+    timer_.Wake();
+    if (thread_.joinable()) thread_.join();
+    profile_ = nullptr;
+}
+
+const InputSnapshot& InputThread::Latest(bool* fresh) {
+    const bool updated = snapshots_.Update();
+    if (fresh) *fresh = updated;
+    return snapshots_.ReadSlot();
+}
+
+void InputThread::threadMain() {
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+
+    const uint64_t period = 1000000000ull / rateHz_;
+    const uint32_t inputCount = (uint32_t)std::min<size_t>(profile_->inputs.size(), InputSnapshot::kMaxInputs);
+    uint64_t next = FrameTimer::Now();
+    uint64_t seq = 0;
+    bool     wasFocused = true;   // publish the unfocused state once before parking
+
+    while (!stop_.load(std::memory_order_acquire)) {
+        const bool focused = xr_session_state == XR_SESSION_STATE_FOCUSED;
+        if (!focused && !wasFocused) {
+            // Nothing to read until the state changes: park, then start a fresh cadence
+            timer_.Wait();
+            next = FrameTimer::Now();
+            wasFocused = true;   // look again (the wake may also have been Stop)
+            continue;
+        }
+        wasFocused = focused;
+
+        InputSnapshot& s = snapshots_.WriteSlot();
+        if (focused) {
+            const uint64_t allocsBefore = alloc_audit_thread_count();
+            poll_controller_profile(*profile_, s.inputs, inputCount);
+            if (polls_.fetch_add(1, std::memory_order_relaxed) >= kAllocWarmupPolls)
+                allocs_.fetch_add(alloc_audit_thread_count() - allocsBefore, std::memory_order_relaxed);
+        }
+        s.seq = ++seq;
+        s.sampledNs = FrameTimer::Now();
+        s.focused = focused;
+        s.inputCount = focused ? inputCount : 0;
+        snapshots_.Publish();
+        if (!focused) continue;
+
+        // Fixed cadence; after a stall start over from now instead of bursting to catch up
+        const uint64_t now = FrameTimer::Now();
+        next += period;
+        if (next < now) next = now;
+        timer_.WaitUntil(next);
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "controller_config.h"
+#include "high_res_timer.h"
+#include "triple_buffer.h"
+
+// What the input thread hands to the render thread after every poll: the input state it read,
+// so nothing outside the input thread reads the profile or the action state directly
+struct InputSnapshot {
+    static constexpr uint32_t kMaxInputs = 64;
+
+    uint64_t seq = 0;         // polls since Start()
+    uint64_t sampledNs = 0;   // FrameTimer::Now() when the poll finished
+    bool     focused = false; // session was focused, so actions were actually synced
+    uint32_t inputCount = 0;  // entries of inputs used: CompiledProfile::inputs, same order
+    CompiledInputState inputs[kMaxInputs];
+};
+
+// Delays (ns) from a state change reported by the runtime to the moment it was dispatched.
+// Fixed ring, single writer (whichever thread polls the profile); read it once polling has stopped.
+class InputLatency {
+public:
+    static constexpr uint32_t kCapacity = 1024;
+
+    void     Record(uint64_t ns);
+    uint64_t Count() const { return count_.load(std::memory_order_acquire); }
+
+    // "<label>: n changes, p50/p95/p99/max" line; returns the number of characters written.
+    size_t Format(const char* label, char* buf, size_t size) const;
+
+private:
+    std::atomic<uint64_t> count_ = 0;
+    uint32_t              samples_[kCapacity] = {};
+};
+
+// Syncs actions and evaluates a CompiledProfile on its own thread at a fixed rate, so
+// button-to-key latency no longer depends on the frame rate or on the render loop sleeping
+// while the session is not visible.
+//
+// The cadence comes from a HighResTimer, so the system timer resolution is left alone. While
+// the session is not focused the runtime delivers no input and the thread parks without a
+// timeout; whoever changes the session state calls SessionStateChanged() to let it look again.
+class InputThread {
+public:
+    // profile must stay alive (and untouched by other threads) until Stop()
+    bool Start(CompiledProfile* profile, uint32_t rateHz);
+    void Stop();
+    bool Running() const { return thread_.joinable(); }
+
+    // Any thread, after xr_session_state changed
+    void SessionStateChanged() { timer_.Wake(); }
+
+    // Render thread: newest snapshot, valid until the next call. fresh is set if it is newer
+    // than the one from the last call.
+    const InputSnapshot& Latest(bool* fresh = nullptr);
+
+    // Polls (not parked ones) since Start()
+    uint64_t Polls() const { return polls_.load(std::memory_order_relaxed); }
+
+    // Heap allocations made by polls after the first kAllocWarmupPolls (VE_ALLOC_AUDIT builds)
+    static constexpr uint64_t kAllocWarmupPolls = 120;
+    uint64_t SteadyAllocations() const { return allocs_.load(std::memory_order_relaxed); }
+
+private:
+    void threadMain();
+
+    CompiledProfile*   profile_ = nullptr;
+    uint32_t           rateHz_ = 0;
+
+    // Producer: input thread, consumer: render thread
+    TripleBuffer<InputSnapshot> snapshots_;
+
+    std::thread             thread_;
+    HighResTimer            timer_;
+    std::atomic<bool>       stop_ = false;
+    std::atomic<uint64_t>   polls_ = 0;
+    std::atomic<uint64_t>   allocs_ = 0;
+};
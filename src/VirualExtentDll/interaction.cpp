@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "interaction.h"
+
+#include <cmath>
+#include <cstdlib>
+
+InteractionFrame g_interaction;
+CursorWarpPolicy g_cursor_warp;
+
+static float Dot(const float a[3], const float b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void Cross(const float a[3], const float b[3], float out[3]) {
+    const float x = a[1] * b[2] - a[2] * b[1];
+    const float y = a[2] * b[0] - a[0] * b[2];
+    const float z = a[0] * b[1] - a[1] * b[0];
+    out[0] = x; out[1] = y; out[2] = z;
+}
+
+// v' = v + 2w (q x v) + 2 q x (q x v), q = (x, y, z, w) unit
+static void Rotate(const float q[4], const float v[3], float out[3]) {
+    float t[3], u[3];
+    Cross(q, v, t);
+    t[0] *= 2; t[1] *= 2; t[2] *= 2;
+    Cross(q, t, u);
+    for (int i = 0; i < 3; i++)
+        out[i] = v[i] + q[3] * t[i] + u[i];
+}
+
+static void Cast(const InteractionPlane& plane, const InteractionHand& hand, InteractionRay* ray) {
+    *ray = {};
+    if (!hand.valid)
+        return;
+    ray->active = true;
+
+    // The pointer leaves the grip along -Z, tilted about the grip's X axis
+    const float tilt = InteractionFrame::kRayTiltDeg * 3.14159265f / 180.0f;
+    const float local[3] = { 0.0f, sinf(tilt), -cosf(tilt) };
+    Rotate(hand.orientation, local, ray->direction);
+    for (int i = 0; i < 3; i++)
+        ray->origin[i] = hand.position[i];
+    ray->length = InteractionFrame::kRayDefaultLength;
+    if (!plane.placed)
+        return;
+
+    float normal[3];
+    Cross(plane.right, plane.up, normal);
+    const float denom = Dot(ray->direction, normal);
+    if (fabsf(denom) < 1e-9f)
+        return; // parallel to the plane
+
+    float toCenter[3];
+    for (int i = 0; i < 3; i++)
+        toCenter[i] = plane.center[i] - ray->origin[i];
+    const float t = Dot(toCenter, normal) / denom;
+    if (t < 0.0f)
+        return; // behind the hand
+
+    float hit[3], rel[3];
+    for (int i = 0; i < 3; i++) {
+        hit[i] = ray->origin[i] + ray->direction[i] * t;
+        rel[i] = hit[i] - plane.center[i];
+    }
+    // Quad-local coordinates in [-0.5, 0.5]
+    const float x = Dot(rel, plane.right) / Dot(plane.right, plane.right);
+    const float y = Dot(rel, plane.up) / Dot(plane.up, plane.up);
+    if (x < -0.5f || x > 0.5f || y < -0.5f || y > 0.5f)
+        return;
+
+    ray->hit = true;
+    ray->length = t;
+    for (int i = 0; i < 3; i++)
+        ray->hitPosition[i] = hit[i];
+
+    // Geometry maps u = x + 0.5, v = 0.5 - y; the shader mirrors U when sampling
+    const float u = x + 0.5f;
+    const float v = 0.5f - y;
+    ray->uv[0] = 1.0f - u;
+    ray->uv[1] = v;
+
+    if (plane.screenWidth > 0 && plane.screenHeight > 0) {
+        ray->onScreen = true;
+        ray->screenX = plane.screenLeft + (int32_t)(u * (float)plane.screenWidth + 0.5f);
+        ray->screenY = plane.screenTop + (int32_t)(v * (float)plane.screenHeight + 0.5f);
+    }
+}
+
+void interaction_update(const InteractionPlane& plane, const InteractionHand hands[2], InteractionFrame* out) {
+    out->plane = plane;
+    for (int h = 0; h < 2; h++)
+        Cast(plane, hands[h], &out->hands[h]);
+    out->cursorHand = out->hands[1].onScreen ? 1 : out->hands[0].onScreen ? 0 : -1;
+    out->frame++;
+}
+
+bool CursorWarpPolicy::Near(const Point& a, int32_t x, int32_t y) const {
+    return a.valid && std::abs(a.x - x) <= config_.thresholdPx && std::abs(a.y - y) <= config_.thresholdPx;
+}
+
+bool CursorWarpPolicy::Hover(bool onScreen, int32_t x, int32_t y, int32_t* outX, int32_t* outY) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!onScreen) {
+        hover_ = {};
+        stillFrames_ = 0;
+        return false;
+    }
+
+    stillFrames_ = Near(hover_, x, y) ? stillFrames_ + 1 : 0;
+    hover_ = { true, x, y };
+
+    const bool atWarp = warped_.valid && warped_.x == x && warped_.y == y;
+    const bool dragging = buttonsHeld_ > 0 && !atWarp;
+    const bool settled = stillFrames_ >= config_.settleFrames && !Near(warped_, x, y);
+    if (!dragging && !settled) {
+        suppressed_++;
+        return false;
+    }
+    warped_ = hover_;
+    warps_++;
+    *outX = x;
+    *outY = y;
+    return true;
+}
+
+bool CursorWarpPolicy::BeforeInjection(int32_t cursorX, int32_t cursorY, int32_t* outX, int32_t* outY) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!hover_.valid)
+        return false;
+    if (hover_.x == cursorX && hover_.y == cursorY) {
+        suppressed_++;
+        return false;
+    }
+    warped_ = hover_;
+    warps_++;
+    *outX = hover_.x;
+    *outY = hover_.y;
+    return true;
+}
+
+void CursorWarpPolicy::ButtonDown() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    buttonsHeld_++;
+}
+
+void CursorWarpPolicy::ButtonUp() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (buttonsHeld_ > 0) buttonsHeld_--;
+}
+
+uint64_t CursorWarpPolicy::Warps() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return warps_;
+}
+
+uint64_t CursorWarpPolicy::Suppressed() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return suppressed_;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+
+// Pointer interaction, computed once per frame after the hand poses are updated: each hand's
+// tilted pointer ray, where it hits the desktop plane, the UV there and the screen point under
+// it. Rendering (ray length, hit marker) and injection (cursor warp, clicks) only read the
+// result, so nothing is raycast per eye or per consumer.
+//
+// Plain C++ with its own minimal vector math (no DirectX/OpenXR types), so it can be driven
+// with scripted poses.
+
+// The desktop quad in app space and the part of the virtual desktop it shows
+struct InteractionPlane {
+    bool    placed = false;
+    float   center[3] = {};
+    float   right[3] = {};   // spans the full width: local +X scaled by the width
+    float   up[3] = {};      // spans the full height: local +Y scaled by the height
+    int32_t screenLeft = 0;  // virtual-desktop rect of the captured output
+    int32_t screenTop = 0;
+    int32_t screenWidth = 0; // 0 while there is no capture: hits have no screen point
+    int32_t screenHeight = 0;
+};
+
+struct InteractionHand {
+    bool  valid = false;
+    float position[3] = {};
+    float orientation[4] = { 0, 0, 0, 1 }; // x, y, z, w
+};
+
+struct InteractionRay {
+    bool    active = false;   // hand tracked; nothing else is meaningful otherwise
+    float   origin[3] = {};
+    float   direction[3] = {};
+    float   length = 0;       // to the hit, or kRayDefaultLength
+    bool    hit = false;
+    float   hitPosition[3] = {};
+    float   uv[2] = {};       // mirrored like the plane shader samples it
+    bool    onScreen = false;
+    int32_t screenX = 0;
+    int32_t screenY = 0;
+};
+
+struct InteractionFrame {
+    static constexpr float kRayTiltDeg = -35.0f;     // pointer tilt down from the grip's -Z
+    static constexpr float kRayDefaultLength = 3.0f; // when it hits nothing
+
+    uint64_t         frame = 0;        // updates so far
+    InteractionPlane plane;            // as it was for this frame's rays
+    InteractionRay   hands[2];
+    int              cursorHand = -1;  // hand that owns the cursor this frame (right preferred), -1 none
+};
+
+void interaction_update(const InteractionPlane& plane, const InteractionHand hands[2], InteractionFrame* out);
+
+// This frame's result, written by the render thread once per frame
+extern InteractionFrame g_interaction;
+
+// Decides when the OS cursor actually follows the pointer. Hovering is shown by the in-VR cursor
+// sprite; every SetCursorPos makes the desktop redraw hover state (and the capture produce a new
+// frame), so the real cursor only moves:
+//  - right before a click, scroll or drag is injected, if it is not already under the pointer,
+//  - while a button is held (dragging), whenever the pointer moves,
+//  - when the hover point has settled for settleFrames and is more than thresholdPx from the
+//    last warp, so hover effects and tooltips still appear.
+// Hover is called by the render thread, the injection side by the input thread.
+struct CursorWarpConfig {
+    int32_t  thresholdPx = 3;
+    uint32_t settleFrames = 8;
+};
+
+class CursorWarpPolicy {
+public:
+    explicit CursorWarpPolicy(const CursorWarpConfig& config = CursorWarpConfig()) : config_(config) {}
+
+    // Once per frame with the pointer's screen point, if any. True with *outX/*outY to warp to now.
+    bool Hover(bool onScreen, int32_t x, int32_t y, int32_t* outX, int32_t* outY);
+
+    // Before injecting a mouse button or wheel event, with the OS cursor's position. True with the
+    // point to warp to first; false to inject where the cursor is (already there, or no pointer).
+    bool BeforeInjection(int32_t cursorX, int32_t cursorY, int32_t* outX, int32_t* outY);
+    // Button state of the injected events, for dragging
+    void ButtonDown();
+    void ButtonUp();
+
+    uint64_t Warps() const;
+    uint64_t Suppressed() const;   // pointer frames and injections that did not need a warp
+
+private:
+    struct Point {
+        bool    valid = false;
+        int32_t x = 0, y = 0;
+    };
+    bool Near(const Point& a, int32_t x, int32_t y) const;
+
+    CursorWarpConfig   config_;
+    mutable std::mutex mutex_;
+    Point              hover_;        // this frame's pointer
+    Point              warped_;       // last point the cursor was warped to
+    uint32_t           stillFrames_ = 0;
+    uint32_t           buttonsHeld_ = 0;
+    uint64_t           warps_ = 0;
+    uint64_t           suppressed_ = 0;
+};
+
+extern CursorWarpPolicy g_cursor_warp;
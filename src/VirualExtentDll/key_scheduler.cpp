@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "key_scheduler.h"
+#include "frame_timing.h" // FrameTimer::Now
+
+#include <algorithm>
+
+KeyScheduler g_key_scheduler;
+
+bool KeyScheduler::Start(IInputSink* sink, const KeySchedulerConfig& config) {
+    std::lock_guard<std::mutex> life(lifecycle_);
+    if (!sink || config.capacity == 0 || thread_.joinable()) return false;
+
+    // The thread is not running: nothing else touches these
+    config_ = config;
+    injector_.SetSink(sink);
+    dueTimes_.reserve(config_.capacity);
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        heap_.clear();
+        heap_.reserve(config_.capacity);
+        stop_ = false;
+        running_ = true;
+    }
+    thread_ = std::thread(&KeyScheduler::threadMain, this);
+    return true;
+}
+
+void KeyScheduler::Stop() {
+    std::lock_guard<std::mutex> life(lifecycle_);
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+        running_ = false;   // Schedule() fails from here on; the thread sends what is pending
+    }
+    timer_.Wake();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool KeyScheduler::Running() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return running_;
+}
+
+bool KeyScheduler::Schedule(uint64_t dueNs, const InjectedEvent& e) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (!running_ || heap_.size() >= config_.capacity) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        heap_.push_back({ dueNs, seq_++, e });
+        std::push_heap(heap_.begin(), heap_.end(), Later);
+        earliest = heap_.front().seq == seq_ - 1;
+    }
+    // Only a new earliest deadline changes how long the thread should sleep
+    if (earliest) timer_.Wake();
+    return true;
+}
+
+bool KeyScheduler::ScheduleIn(uint64_t delayNs, const InjectedEvent& e) {
+    return Schedule(FrameTimer::Now() + delayNs, e);
+}
+
+uint32_t KeyScheduler::Pending() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return (uint32_t)heap_.size();
+}
+
+KeyScheduler::Stats KeyScheduler::GetStats() const {
+    Stats s;
+    s.fired = fired_.load(std::memory_order_relaxed);
+    s.batches = batches_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.lateSumNs = lateSumNs_.load(std::memory_order_relaxed);
+    s.lateMaxNs = lateMaxNs_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void KeyScheduler::threadMain() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (!stop_) {
+        if (heap_.empty()) {
+            lk.unlock();
+            timer_.Wait();
+            lk.lock();
+            continue;
+        }
+
+        const uint64_t due = heap_.front().dueNs;
+        uint64_t now = FrameTimer::Now();
+        if (due > now) {
+            // Woken early by an earlier deadline or Stop(); either way look again. Wakes are
+            // kept, so one that came in while this thread held the lock is not lost.
+            lk.unlock();
+            timer_.WaitUntil(due);
+            lk.lock();
+            continue;
+        }
+
+        // Everything due by now, in (due, seq) order, as one batch
+        dueTimes_.clear();
+        while (!heap_.empty() && heap_.front().dueNs <= now) {
+            std::pop_heap(heap_.begin(), heap_.end(), Later);
+            dueTimes_.push_back(heap_.back().dueNs);
+            injector_.Queue(heap_.back().event);
+            heap_.pop_back();
+        }
+        const uint32_t n = (uint32_t)dueTimes_.size();
+        lk.unlock();
+
+        now = FrameTimer::Now();
+        injector_.Flush();
+        uint64_t lateSum = 0, lateMax = lateMaxNs_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < n; i++) {
+            const uint64_t late = now > dueTimes_[i] ? now - dueTimes_[i] : 0;
+            lateSum += late;
+            lateMax = std::max(lateMax, late);
+        }
+        fired_.fetch_add(n, std::memory_order_relaxed);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        lateSumNs_.fetch_add(lateSum, std::memory_order_relaxed);
+        lateMaxNs_.store(lateMax, std::memory_order_relaxed);
+
+        lk.lock();
+    }
+
+    // Releases must not be lost: send what is left now, in order
+    while (!heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), Later);
+        injector_.Queue(heap_.back().event);
+        heap_.pop_back();
+    }
+    lk.unlock();
+    injector_.Flush();
+}
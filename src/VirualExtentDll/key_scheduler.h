@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "input_injection.h"
+#include "high_res_timer.h"
+
+// Injects events at a later time: the key-up of a tap, the releases of a held character.
+// Callers queue them and return at once, so nothing on the input or render path sleeps.
+//
+// The events sit in a min-heap ordered by due time (ties in the order they were scheduled) and a
+// thread of its own fires them on the steady clock (FrameTimer::Now). It sleeps on a HighResTimer
+// until the earliest deadline, so it fires well within a millisecond without spinning and without
+// raising the system timer resolution; everything due at once goes out as one batch. Plain C++:
+// the sink decides where the events go.
+struct KeySchedulerConfig {
+    uint32_t capacity = 256;        // pending events; Schedule() fails beyond that
+};
+
+class KeyScheduler {
+public:
+    // Stops and joins. Still Stop() before the dll unloads: a global one is destroyed under the
+    // loader lock, where joining a live thread would deadlock.
+    ~KeyScheduler() { Stop(); }
+
+    bool Start(IInputSink* sink, const KeySchedulerConfig& config = KeySchedulerConfig());
+    // Events still pending are injected right away (in order) so no key stays down
+    void Stop();
+    bool Running() const;
+
+    // Any thread. False if not running or full.
+    bool Schedule(uint64_t dueNs, const InjectedEvent& e);
+    bool ScheduleIn(uint64_t delayNs, const InjectedEvent& e);
+    uint32_t Pending() const;
+
+    struct Stats {
+        uint64_t fired = 0;
+        uint64_t batches = 0;
+        uint64_t dropped = 0;      // Schedule() calls that failed
+        uint64_t lateSumNs = 0;    // submit time - due time, summed over fired events
+        uint64_t lateMaxNs = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        uint64_t      dueNs;
+        uint64_t      seq;
+        InjectedEvent event;
+    };
+    // Min-heap on (dueNs, seq) for std::push_heap/pop_heap
+    static bool Later(const Entry& a, const Entry& b) {
+        return a.dueNs != b.dueNs ? a.dueNs > b.dueNs : a.seq > b.seq;
+    }
+    void threadMain();
+
+    KeySchedulerConfig      config_;
+    InputInjector           injector_;     // scheduler thread only
+    std::vector<uint64_t>   dueTimes_;     // of the batch being fired; scheduler thread only
+
+    std::mutex              lifecycle_;    // serialises Start/Stop
+    std::thread             thread_;       // under lifecycle_
+    HighResTimer            timer_;        // the thread sleeps on it; woken by Schedule and Stop
+
+    mutable std::mutex      mutex_;
+    std::vector<Entry>      heap_;         // reserved to capacity in Start(), like dueTimes_
+    uint64_t                seq_ = 0;
+    bool                    running_ = false;  // Start() to Stop(): Schedule() is accepted
+    bool                    stop_ = false;
+
+    std::atomic<uint64_t>   fired_ = 0;
+    std::atomic<uint64_t>   batches_ = 0;
+    std::atomic<uint64_t>   dropped_ = 0;
+    std::atomic<uint64_t>   lateSumNs_ = 0;
+    std::atomic<uint64_t>   lateMaxNs_ = 0;
+};
+
+// Key releases for the SendInput sink; started and stopped with the VR loop
+extern KeyScheduler g_key_scheduler;
@@ -0,0 +1,683 @@
+#include "pch.h"
+
+#ifdef VE_MOCK_OPENXR
+
+#include "mock_openxr.h"
+
+#ifdef _WIN32
+#include <dxgi.h>
+#endif
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ---------- Mock objects ----------
+// Handles are just pointers to these, so every entry point can trust what it is given
+// (OpenXR.cpp never hands us foreign handles).
+
+struct mock_action_t {
+	XrActionType        type;
+	std::vector<XrPath> subactions;
+	std::vector<XrPath> bindings;   // from xrSuggestInteractionProfileBindings
+
+	// Last value handed out per subaction path, to report when the scripted input changed
+	struct sample_t {
+		XrPath     subaction;
+		XrVector2f value;
+		int64_t    queried;
+		int64_t    changed;
+	};
+	std::vector<sample_t> samples;
+};
+
+struct mock_space_t {
+	bool    reference;      // reference space, else action space
+	XrPosef offset;
+	XrPath  subaction;
+	int     hand;           // action spaces: 0 left, 1 right
+};
+
+struct mock_swapchain_t {
+#ifdef _WIN32
+	std::vector<ID3D11Texture2D*>     images;   // D3D11 sessions
+#endif
+	std::vector<std::vector<uint8_t>> pixels;   // headless sessions
+	uint32_t row_pitch = 0, slice_pitch = 0;
+	uint32_t length = 0;
+	uint32_t next = 0;
+	bool     quad = false;  // referenced by a quad layer
+	bool     projection = false;
+	uint64_t released = 0;
+};
+
+struct mock_state_t {
+	std::mutex                 mutex;
+	mock_xr_config_t           config;
+	mock_xr_stats_t            stats = {};
+
+#ifdef _WIN32
+	ID3D11Device*              device = nullptr;
+#endif
+	bool                       session = false;
+	bool                       headless = false;   // created without a graphics binding
+	std::vector<std::string>   paths;        // XrPath = index + 1
+	struct event_t { XrSessionState state; int64_t time; };   // delivered once time has passed
+	std::deque<event_t>        events;
+	XrSessionState             state = XR_SESSION_STATE_UNKNOWN;
+	int64_t                    session_start = 0;
+	int64_t                    last_wake = 0;
+	int64_t                    last_display = 0;
+	bool                       exit_requested = false;
+
+	std::vector<std::unique_ptr<mock_action_t>>    actions;
+	std::vector<std::unique_ptr<mock_space_t>>     spaces;
+	std::vector<std::unique_ptr<mock_swapchain_t>> swapchains;
+};
+
+static mock_state_t mock;
+static int          mock_instance_tag, mock_session_tag, mock_action_set_tag, mock_messenger_tag;
+
+template <typename H, typename T> static H to_handle(T* p) { return (H)(uintptr_t)p; }
+template <typename T, typename H> static T* from_handle(H h) { return (T*)(uintptr_t)h; }
+
+static int64_t mock_now() {
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Standard OpenXR two-call idiom
+template <typename T>
+static XrResult mock_fill(uint32_t capacity, uint32_t* count, T* out, const T* src, uint32_t n) {
+	if (count) *count = n;
+	if (capacity == 0) return XR_SUCCESS;
+	if (capacity < n) return XR_ERROR_SIZE_INSUFFICIENT;
+	for (uint32_t i = 0; i < n; i++) out[i] = src[i];
+	return XR_SUCCESS;
+}
+
+static XrVector3f mock_rotate(const XrQuaternionf& q, const XrVector3f& v) {
+	// v' = v + 2w(q x v) + 2 q x (q x v)
+	XrVector3f t = { 2 * (q.y * v.z - q.z * v.y), 2 * (q.z * v.x - q.x * v.z), 2 * (q.x * v.y - q.y * v.x) };
+	return { v.x + q.w * t.x + (q.y * t.z - q.z * t.y),
+	         v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+	         v.z + q.w * t.z + (q.x * t.y - q.y * t.x) };
+}
+
+static const std::string& mock_path_str(XrPath path) {
+	static const std::string empty;
+	return (path == XR_NULL_PATH || path > mock.paths.size()) ? empty : mock.paths[(size_t)path - 1];
+}
+
+static void mock_push_state(XrSessionState state, int64_t delay_ns = 0) {
+	int64_t time = mock_now() + delay_ns;
+	if (!mock.events.empty() && mock.events.back().time > time) time = mock.events.back().time;
+	mock.events.push_back({ state, time });
+}
+
+// ---------- Configuration ----------
+
+void mock_xr_configure(const mock_xr_config_t& config) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.config = config;
+}
+
+mock_xr_stats_t mock_xr_stats() {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock_xr_stats_t stats = mock.stats;
+	stats.quad_images_released = 0;
+	for (auto& sc : mock.swapchains)
+		if (sc->quad && !sc->projection) stats.quad_images_released += sc->released;
+	return stats;
+}
+
+// ---------- Extension functions (handed out by xrGetInstanceProcAddr) ----------
+
+#ifdef _WIN32
+static XRAPI_ATTR XrResult XRAPI_CALL mock_xrGetD3D11GraphicsRequirementsKHR(XrInstance, XrSystemId, XrGraphicsRequirementsD3D11KHR* req) {
+	// Run on the first adapter; d3d_init looks it up again by LUID
+	IDXGIFactory1* factory = nullptr;
+	IDXGIAdapter1* adapter = nullptr;
+	if (FAILED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&factory)))
+		return XR_ERROR_RUNTIME_FAILURE;
+	XrResult result = XR_ERROR_RUNTIME_FAILURE;
+	if (factory->EnumAdapters1(0, &adapter) == S_OK) {
+		DXGI_ADAPTER_DESC1 desc;
+		adapter->GetDesc1(&desc);
+		req->adapterLuid = desc.AdapterLuid;
+		req->minFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+		adapter->Release();
+		result = XR_SUCCESS;
+	}
+	factory->Release();
+	return result;
+}
+#endif
+
+static XRAPI_ATTR XrResult XRAPI_CALL mock_xrCreateDebugUtilsMessengerEXT(XrInstance, const XrDebugUtilsMessengerCreateInfoEXT*, XrDebugUtilsMessengerEXT* messenger) {
+	*messenger = to_handle<XrDebugUtilsMessengerEXT>(&mock_messenger_tag);
+	return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL mock_xrDestroyDebugUtilsMessengerEXT(XrDebugUtilsMessengerEXT) {
+	return XR_SUCCESS;
+}
+
+// ---------- Instance / system ----------
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateInstanceExtensionProperties(const char*, uint32_t capacity, uint32_t* count, XrExtensionProperties* props) {
+	static const char* const names[] = {
+		XR_EXT_DEBUG_UTILS_EXTENSION_NAME, XR_MND_HEADLESS_EXTENSION_NAME,
+#ifdef _WIN32
+		XR_KHR_D3D11_ENABLE_EXTENSION_NAME,
+#endif
+	};
+	XrExtensionProperties exts[std::size(names)];
+	for (size_t i = 0; i < std::size(names); i++) {
+		exts[i] = { XR_TYPE_EXTENSION_PROPERTIES };
+		snprintf(exts[i].extensionName, sizeof(exts[i].extensionName), "%s", names[i]);
+		exts[i].extensionVersion = 1;
+	}
+	return mock_fill(capacity, count, props, exts, (uint32_t)std::size(exts));
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateInstance(const XrInstanceCreateInfo*, XrInstance* instance) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.stats = {};
+	*instance = to_handle<XrInstance>(&mock_instance_tag);
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroyInstance(XrInstance) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.paths.clear();
+	mock.events.clear();
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance, const char* name, PFN_xrVoidFunction* function) {
+#ifdef _WIN32
+	if (strcmp(name, "xrGetD3D11GraphicsRequirementsKHR") == 0)    *function = (PFN_xrVoidFunction)mock_xrGetD3D11GraphicsRequirementsKHR;
+	else
+#endif
+	if (strcmp(name, "xrCreateDebugUtilsMessengerEXT") == 0)  *function = (PFN_xrVoidFunction)mock_xrCreateDebugUtilsMessengerEXT;
+	else if (strcmp(name, "xrDestroyDebugUtilsMessengerEXT") == 0) *function = (PFN_xrVoidFunction)mock_xrDestroyDebugUtilsMessengerEXT;
+	else { *function = nullptr; return XR_ERROR_FUNCTION_UNSUPPORTED; }
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetSystem(XrInstance, const XrSystemGetInfo*, XrSystemId* system_id) {
+	*system_id = 1;
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateEnvironmentBlendModes(XrInstance, XrSystemId, XrViewConfigurationType, uint32_t capacity, uint32_t* count, XrEnvironmentBlendMode* modes) {
+	const XrEnvironmentBlendMode opaque = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+	return mock_fill(capacity, count, modes, &opaque, 1);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateViewConfigurationViews(XrInstance, XrSystemId, XrViewConfigurationType, uint32_t capacity, uint32_t* count, XrViewConfigurationView* views) {
+	XrViewConfigurationView v[2];
+	for (int i = 0; i < 2; i++) {
+		v[i] = { XR_TYPE_VIEW_CONFIGURATION_VIEW };
+		v[i].recommendedImageRectWidth = v[i].maxImageRectWidth = mock.config.width;
+		v[i].recommendedImageRectHeight = v[i].maxImageRectHeight = mock.config.height;
+		v[i].recommendedSwapchainSampleCount = v[i].maxSwapchainSampleCount = 1;
+	}
+	return mock_fill(capacity, count, views, v, 2);
+}
+
+// ---------- Paths ----------
+
+XRAPI_ATTR XrResult XRAPI_CALL xrStringToPath(XrInstance, const char* str, XrPath* path) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.stats.paths_converted++;
+	if (!str || str[0] != '/') return XR_ERROR_PATH_FORMAT_INVALID;
+	for (size_t i = 0; i < mock.paths.size(); i++) {
+		if (mock.paths[i] == str) { *path = (XrPath)(i + 1); return XR_SUCCESS; }
+	}
+	mock.paths.push_back(str);
+	*path = (XrPath)mock.paths.size();
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrPathToString(XrInstance, XrPath path, uint32_t capacity, uint32_t* count, char* buffer) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	if (path == XR_NULL_PATH || path > mock.paths.size()) return XR_ERROR_PATH_INVALID;
+	const std::string& s = mock.paths[(size_t)path - 1];
+	return mock_fill(capacity, count, buffer, s.c_str(), (uint32_t)s.size() + 1);
+}
+
+// ---------- Session ----------
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateSession(XrInstance, const XrSessionCreateInfo* info, XrSession* session) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	// No binding: a headless session with swapchain images in CPU memory
+	mock.headless = info->next == nullptr;
+	if (!mock.headless) {
+#ifdef _WIN32
+		const XrGraphicsBindingD3D11KHR* binding = (const XrGraphicsBindingD3D11KHR*)info->next;
+		if (binding->type != XR_TYPE_GRAPHICS_BINDING_D3D11_KHR || !binding->device)
+			return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+		mock.device = binding->device;
+#else
+		return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+#endif
+	}
+	mock.session = true;
+	mock.exit_requested = false;
+	mock.last_wake = mock.last_display = 0;
+	mock_push_state(XR_SESSION_STATE_IDLE);
+	mock_push_state(XR_SESSION_STATE_READY, (int64_t)mock.config.ready_delay_ms * 1000000);
+	*session = to_handle<XrSession>(&mock_session_tag);
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroySession(XrSession) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.actions.clear();
+	mock.spaces.clear();
+#ifdef _WIN32
+	mock.device = nullptr;
+#endif
+	mock.session = false;
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrBeginSession(XrSession, const XrSessionBeginInfo*) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.session_start = mock_now();
+	mock_push_state(XR_SESSION_STATE_SYNCHRONIZED);
+	mock_push_state(XR_SESSION_STATE_VISIBLE);
+	mock_push_state(XR_SESSION_STATE_FOCUSED);
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEndSession(XrSession) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock_push_state(XR_SESSION_STATE_IDLE);
+	mock_push_state(XR_SESSION_STATE_EXITING);
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrPollEvent(XrInstance, XrEventDataBuffer* event_data) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	if (mock.events.empty() || mock.events.front().time > mock_now())
+		return XR_EVENT_UNAVAILABLE;
+
+	XrEventDataSessionStateChanged* changed = (XrEventDataSessionStateChanged*)event_data;
+	*changed = { XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED };
+	changed->session = to_handle<XrSession>(&mock_session_tag);
+	changed->state = mock.events.front().state;
+	changed->time = mock.events.front().time;
+	mock.state = changed->state;
+	mock.events.pop_front();
+	return XR_SUCCESS;
+}
+
+// ---------- Spaces ----------
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateReferenceSpace(XrSession, const XrReferenceSpaceCreateInfo* info, XrSpace* space) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.spaces.push_back(std::make_unique<mock_space_t>(mock_space_t{ true, info->poseInReferenceSpace, XR_NULL_PATH, 0 }));
+	*space = to_handle<XrSpace>(mock.spaces.back().get());
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateActionSpace(XrSession, const XrActionSpaceCreateInfo* info, XrSpace* space) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	int hand = mock_path_str(info->subactionPath).starts_with("/user/hand/left") ? 0 : 1;
+	mock.spaces.push_back(std::make_unique<mock_space_t>(mock_space_t{ false, info->poseInActionSpace, info->subactionPath, hand }));
+	*space = to_handle<XrSpace>(mock.spaces.back().get());
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroySpace(XrSpace) {
+	// Spaces live until the session goes away
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrLocateSpace(XrSpace space, XrSpace, XrTime, XrSpaceLocation* location) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock_space_t* s = from_handle<mock_space_t>(space);
+	if (!s) return XR_ERROR_HANDLE_INVALID;
+	location->pose = s->reference ? s->offset : mock.config.hand_pose[s->hand];
+	location->locationFlags =
+		XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_VALID_BIT |
+		XR_SPACE_LOCATION_POSITION_TRACKED_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrLocateViews(XrSession, const XrViewLocateInfo*, XrViewState* view_state, uint32_t capacity, uint32_t* count, XrView* views) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	view_state->viewStateFlags =
+		XR_VIEW_STATE_POSITION_VALID_BIT | XR_VIEW_STATE_ORIENTATION_VALID_BIT |
+		XR_VIEW_STATE_POSITION_TRACKED_BIT | XR_VIEW_STATE_ORIENTATION_TRACKED_BIT;
+
+	XrView v[2];
+	const XrPosef& head = mock.config.head_pose;
+	for (int i = 0; i < 2; i++) {
+		XrVector3f eye = mock_rotate(head.orientation, { (i == 0 ? -0.5f : 0.5f) * mock.config.ipd, 0, 0 });
+		v[i] = { XR_TYPE_VIEW };
+		v[i].pose.orientation = head.orientation;
+		v[i].pose.position = { head.position.x + eye.x, head.position.y + eye.y, head.position.z + eye.z };
+		v[i].fov = mock.config.fov[i];
+	}
+	return mock_fill(capacity, count, views, v, 2);
+}
+
+// ---------- Actions ----------
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateActionSet(XrInstance, const XrActionSetCreateInfo*, XrActionSet* action_set) {
+	*action_set = to_handle<XrActionSet>(&mock_action_set_tag);
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroyActionSet(XrActionSet) {
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateAction(XrActionSet, const XrActionCreateInfo* info, XrAction* action) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	auto a = std::make_unique<mock_action_t>();
+	a->type = info->actionType;
+	a->subactions.assign(info->subactionPaths, info->subactionPaths + info->countSubactionPaths);
+	mock.actions.push_back(std::move(a));
+	mock.stats.actions_created++;
+	*action = to_handle<XrAction>(mock.actions.back().get());
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrSuggestInteractionProfileBindings(XrInstance, const XrInteractionProfileSuggestedBinding* suggested) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	for (uint32_t i = 0; i < suggested->countSuggestedBindings; i++) {
+		mock_action_t* a = from_handle<mock_action_t>(suggested->suggestedBindings[i].action);
+		if (a) a->bindings.push_back(suggested->suggestedBindings[i].binding);
+	}
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrAttachSessionActionSets(XrSession, const XrSessionActionSetsAttachInfo*) {
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrSyncActions(XrSession, const XrActionsSyncInfo*) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.stats.actions_synced++;
+	return mock.state == XR_SESSION_STATE_FOCUSED ? XR_SUCCESS : XR_SESSION_NOT_FOCUSED;
+}
+
+static XrVector2f mock_eval(const std::string& path, int64_t t) {
+	return mock.config.input ? mock.config.input(path, (double)(t - mock.session_start) * 1e-9) : XrVector2f{ 0, 0 };
+}
+
+// Scripted value of the first binding of `action` that matches the subaction path, and the time
+// it last changed. The script is a function of time, so the change is found by bisecting between
+// the previous query and now; that gives benchmarks a true input-to-dispatch latency.
+static bool mock_input(const XrActionStateGetInfo* info, XrVector2f& value, XrTime& changed) {
+	mock_action_t* a = from_handle<mock_action_t>(info->action);
+	if (!a) return false;
+	const std::string& sub = mock_path_str(info->subactionPath);
+	for (XrPath b : a->bindings) {
+		const std::string& path = mock_path_str(b);
+		if (!sub.empty() && !path.starts_with(sub)) continue;
+
+		const int64_t now = mock_now();
+		value = mock_eval(path, now);
+
+		mock_action_t::sample_t* prev = nullptr;
+		for (auto& smp : a->samples)
+			if (smp.subaction == info->subactionPath) prev = &smp;
+		if (!prev) {
+			a->samples.push_back({ info->subactionPath, value, now, now });
+			prev = &a->samples.back();
+		}
+		else if (value.x != prev->value.x || value.y != prev->value.y) {
+			int64_t lo = prev->queried, hi = now;
+			while (hi - lo > 1000) {   // 1 us
+				int64_t mid = lo + (hi - lo) / 2;
+				XrVector2f v = mock_eval(path, mid);
+				if (v.x == prev->value.x && v.y == prev->value.y) lo = mid; else hi = mid;
+			}
+			prev->changed = hi;
+		}
+		prev->value = value;
+		prev->queried = now;
+		changed = prev->changed;
+		return true;
+	}
+	return false;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetActionStateBoolean(XrSession, const XrActionStateGetInfo* info, XrActionStateBoolean* state) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.stats.action_state_queries++;
+	XrVector2f v = {};
+	XrTime     changed = 0;
+	state->isActive = mock_input(info, v, changed) ? XR_TRUE : XR_FALSE;
+	XrBool32 cur = v.x > 0.5f ? XR_TRUE : XR_FALSE;
+	state->changedSinceLastSync = cur != state->currentState;
+	state->currentState = cur;
+	state->lastChangeTime = changed;
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetActionStateFloat(XrSession, const XrActionStateGetInfo* info, XrActionStateFloat* state) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.stats.action_state_queries++;
+	XrVector2f v = {};
+	XrTime     changed = 0;
+	state->isActive = mock_input(info, v, changed) ? XR_TRUE : XR_FALSE;
+	state->changedSinceLastSync = v.x != state->currentState;
+	state->currentState = v.x;
+	state->lastChangeTime = changed;
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetActionStateVector2f(XrSession, const XrActionStateGetInfo* info, XrActionStateVector2f* state) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock.stats.action_state_queries++;
+	XrVector2f v = {};
+	XrTime     changed = 0;
+	state->isActive = mock_input(info, v, changed) ? XR_TRUE : XR_FALSE;
+	state->changedSinceLastSync = v.x != state->currentState.x || v.y != state->currentState.y;
+	state->currentState = v;
+	state->lastChangeTime = changed;
+	return XR_SUCCESS;
+}
+
+// ---------- Swapchains ----------
+
+// DXGI_FORMAT_R8G8B8A8_UNORM, _R8G8B8A8_UNORM_SRGB, _B8G8R8A8_UNORM and _B8G8R8A8_UNORM_SRGB,
+// by value so headless sessions need no DXGI header. All of them are 4 bytes per pixel.
+static const int64_t mock_formats[] = { 28, 29, 87, 91 };
+
+// Headless: each image is one block of arraySize slices
+static XrResult mock_create_cpu_images(const XrSwapchainCreateInfo* info, mock_swapchain_t& sc) {
+	bool known = false;
+	for (int64_t f : mock_formats) known |= f == info->format;
+	if (!known || info->sampleCount != 1 || info->mipCount != 1 || info->width == 0 || info->height == 0)
+		return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+	sc.row_pitch = info->width * 4;
+	sc.slice_pitch = sc.row_pitch * info->height;
+	sc.pixels.assign(mock.config.swapchain_length, std::vector<uint8_t>((size_t)sc.slice_pitch * info->arraySize));
+	return XR_SUCCESS;
+}
+
+#ifdef _WIN32
+static XrResult mock_create_d3d11_images(const XrSwapchainCreateInfo* info, mock_swapchain_t& sc) {
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = info->width;
+	desc.Height = info->height;
+	desc.MipLevels = info->mipCount;
+	desc.ArraySize = info->arraySize;
+	desc.Format = (DXGI_FORMAT)info->format;
+	desc.SampleDesc.Count = info->sampleCount;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	if (info->usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+	if (info->usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT)          desc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+
+	for (uint32_t i = 0; i < mock.config.swapchain_length; i++) {
+		ID3D11Texture2D* tex = nullptr;
+		if (FAILED(mock.device->CreateTexture2D(&desc, nullptr, &tex))) {
+			for (ID3D11Texture2D* t : sc.images) t->Release();
+			sc.images.clear();
+			return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+		}
+		sc.images.push_back(tex);
+	}
+	return XR_SUCCESS;
+}
+#endif
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateSwapchainFormats(XrSession, uint32_t capacity, uint32_t* count, int64_t* formats) {
+	return mock_fill(capacity, count, formats, mock_formats, (uint32_t)std::size(mock_formats));
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateSwapchain(XrSession, const XrSwapchainCreateInfo* info, XrSwapchain* swapchain) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	if (!mock.session) return XR_ERROR_SESSION_LOST;
+
+	auto sc = std::make_unique<mock_swapchain_t>();
+#ifdef _WIN32
+	XrResult result = mock.headless ? mock_create_cpu_images(info, *sc) : mock_create_d3d11_images(info, *sc);
+#else
+	XrResult result = mock_create_cpu_images(info, *sc);
+#endif
+	if (XR_FAILED(result)) return result;
+	sc->length = mock.config.swapchain_length;
+	mock.swapchains.push_back(std::move(sc));
+	*swapchain = to_handle<XrSwapchain>(mock.swapchains.back().get());
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroySwapchain(XrSwapchain swapchain) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock_swapchain_t* sc = from_handle<mock_swapchain_t>(swapchain);
+#ifdef _WIN32
+	for (ID3D11Texture2D* t : sc->images) t->Release();
+	sc->images.clear();
+#endif
+	sc->pixels.clear();
+	sc->length = 0;   // keep the record so stats survive shutdown
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateSwapchainImages(XrSwapchain swapchain, uint32_t capacity, uint32_t* count, XrSwapchainImageBaseHeader* images) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock_swapchain_t* sc = from_handle<mock_swapchain_t>(swapchain);
+	uint32_t n = sc->length;
+	if (count) *count = n;
+	if (capacity == 0) return XR_SUCCESS;
+	if (capacity < n) return XR_ERROR_SIZE_INSUFFICIENT;
+	if (!sc->pixels.empty()) {
+		mock_xr_image_cpu_t* out = (mock_xr_image_cpu_t*)images;
+		for (uint32_t i = 0; i < n; i++) {
+			out[i].pixels = sc->pixels[i].data();
+			out[i].row_pitch = sc->row_pitch;
+			out[i].slice_pitch = sc->slice_pitch;
+		}
+	}
+#ifdef _WIN32
+	else {
+		XrSwapchainImageD3D11KHR* out = (XrSwapchainImageD3D11KHR*)images;
+		for (uint32_t i = 0; i < n; i++) out[i].texture = sc->images[i];
+	}
+#endif
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrAcquireSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageAcquireInfo*, uint32_t* index) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	mock_swapchain_t* sc = from_handle<mock_swapchain_t>(swapchain);
+	if (sc->length == 0) return XR_ERROR_HANDLE_INVALID;
+	*index = sc->next;
+	sc->next = (sc->next + 1) % sc->length;
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrWaitSwapchainImage(XrSwapchain, const XrSwapchainImageWaitInfo*) {
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo*) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	from_handle<mock_swapchain_t>(swapchain)->released++;
+	mock.stats.images_released++;
+	return XR_SUCCESS;
+}
+
+// ---------- Frame loop ----------
+
+XRAPI_ATTR XrResult XRAPI_CALL xrWaitFrame(XrSession, const XrFrameWaitInfo*, XrFrameState* frame_state) {
+	int64_t period, wake;
+	bool    throttle;
+	{
+		std::lock_guard<std::mutex> lk(mock.mutex);
+		period = mock.config.display_period_ns;
+		throttle = mock.config.throttle;
+
+		// Release the app on the first vsync after now (one frame per period at most),
+		// and predict display one period after that
+		const int64_t now = mock_now();
+		wake = (now / period + 1) * period;
+		if (mock.last_wake && wake < mock.last_wake + period) wake = mock.last_wake + period;
+		if (!throttle) wake = now > mock.last_wake ? now : mock.last_wake + 1;
+		mock.last_wake = wake;
+		mock.last_display = throttle ? wake + period : mock.last_display + period;
+		mock.stats.frames_waited++;
+
+		frame_state->predictedDisplayTime = mock.last_display;
+		frame_state->predictedDisplayPeriod = period;
+		frame_state->shouldRender = mock.state == XR_SESSION_STATE_VISIBLE || mock.state == XR_SESSION_STATE_FOCUSED;
+	}
+
+	if (throttle) {
+		std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(wake)));
+	}
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrBeginFrame(XrSession, const XrFrameBeginInfo*) {
+	return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEndFrame(XrSession, const XrFrameEndInfo* info) {
+	std::lock_guard<std::mutex> lk(mock.mutex);
+	for (uint32_t i = 0; i < info->layerCount; i++) {
+		const XrCompositionLayerBaseHeader* layer = info->layers[i];
+		if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+			const XrCompositionLayerProjection* proj = (const XrCompositionLayerProjection*)layer;
+			for (uint32_t v = 0; v < proj->viewCount; v++)
+				from_handle<mock_swapchain_t>(proj->views[v].subImage.swapchain)->projection = true;
+			mock.stats.projection_layers++;
+		}
+		else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+			from_handle<mock_swapchain_t>(((const XrCompositionLayerQuad*)layer)->subImage.swapchain)->quad = true;
+			mock.stats.quad_layers++;
+		}
+	}
+	mock.stats.frames_ended++;
+
+	// Scripted headset removal: back to SYNCHRONIZED (not visible) for a while
+	if (mock.config.hide_at_frame && mock.stats.frames_ended == mock.config.hide_at_frame) {
+		mock_push_state(XR_SESSION_STATE_VISIBLE);
+		mock_push_state(XR_SESSION_STATE_SYNCHRONIZED);
+		mock_push_state(XR_SESSION_STATE_VISIBLE, (int64_t)mock.config.hide_ms * 1000000);
+		mock_push_state(XR_SESSION_STATE_FOCUSED);
+	}
+
+	// Scripted end of the benchmark: walk the session down like a runtime would
+	if (mock.config.exit_after_frames && !mock.exit_requested && mock.stats.frames_ended >= mock.config.exit_after_frames) {
+		mock.exit_requested = true;
+		mock_push_state(XR_SESSION_STATE_STOPPING);
+	}
+	return XR_SUCCESS;
+}
+
+#endif // VE_MOCK_OPENXR
@@ -0,0 +1,88 @@
+#pragma once
+
+// Headless stand-in for an OpenXR runtime, for measuring the frame loop without a headset.
+//
+// Build the dll with VE_MOCK_OPENXR defined: mock_openxr.cpp then provides the subset of xr*
+// entry points OpenXR.cpp uses, and they take precedence over the loader's import library.
+// Sessions created with a D3D11 binding get D3D11 textures on the session's device (Windows only;
+// that is what the dll's draw code targets). Sessions created without a graphics binding, as with
+// XR_MND_headless, get swapchain images in CPU memory, enumerated as mock_xr_image_cpu_t, so the
+// session, frame and swapchain loop also runs on Linux. tests/mock_openxr_test.cpp drives both.
+
+#ifdef _WIN32
+#ifndef XR_USE_PLATFORM_WIN32
+#define XR_USE_PLATFORM_WIN32
+#endif
+#ifndef XR_USE_GRAPHICS_API_D3D11
+#define XR_USE_GRAPHICS_API_D3D11
+#endif
+
+#include <d3d11.h>
+#include <openxr/openxr.h>
+#include <openxr/openxr_platform.h>
+#else
+#include <openxr/openxr.h>
+#endif
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+struct mock_xr_config_t {
+	int64_t  display_period_ns = 11111111;  // 90 Hz
+	bool     throttle = true;               // xrWaitFrame sleeps to the next display period
+	uint32_t exit_after_frames = 0;         // 0 = run until shutdown; otherwise request exit after N frames
+
+	// Session state script: READY arrives ready_delay_ms after session creation (the app idles
+	// until then); at frame hide_at_frame the session drops to SYNCHRONIZED for hide_ms.
+	uint32_t ready_delay_ms = 0;
+	uint32_t hide_at_frame = 0;
+	uint32_t hide_ms = 0;
+
+	// Views
+	uint32_t width = 1832, height = 1920;   // recommended image rect per eye
+	uint32_t swapchain_length = 3;
+	XrPosef  head_pose = { {0,0,0,1}, {0,1.6f,0} };
+	float    ipd = 0.064f;
+	XrFovf   fov[2] = {
+		{ -0.90f, 0.77f, 0.80f, -0.87f },
+		{ -0.77f, 0.90f, 0.80f, -0.87f },
+	};
+
+	// Hands (grip pose spaces), relative to the app space
+	XrPosef  hand_pose[2] = {
+		{ {0,0,0,1}, {-0.2f, 1.3f, -0.3f} },
+		{ {0,0,0,1}, { 0.2f, 1.3f, -0.3f} },
+	};
+
+	// Scripted input: value of a bound input path (e.g. "/user/hand/right/input/trigger/value")
+	// at `seconds` after the session started. Booleans use x > 0.5, floats use x, vector2 uses x/y.
+	std::function<XrVector2f(const std::string& path, double seconds)> input;
+};
+
+struct mock_xr_stats_t {
+	uint64_t frames_waited;
+	uint64_t frames_ended;
+	uint64_t projection_layers;
+	uint64_t quad_layers;
+	uint64_t images_released;        // all swapchains
+	uint64_t quad_images_released;   // swapchains only ever referenced by quad layers
+	uint64_t actions_synced;
+	uint64_t paths_converted;        // xrStringToPath calls
+	uint64_t actions_created;
+	uint64_t action_state_queries;   // xrGetActionState* calls
+};
+
+// Swapchain image of a headless session: arraySize slices of slice_pitch bytes, rows of
+// row_pitch bytes, 4 bytes per pixel (the mock only offers 8-bit RGBA/BGRA formats)
+static const XrStructureType XR_TYPE_SWAPCHAIN_IMAGE_MOCK_CPU = (XrStructureType)0x7e570001;
+struct mock_xr_image_cpu_t {
+	XrStructureType type;
+	void*           next;
+	uint8_t*        pixels;
+	uint32_t        row_pitch;
+	uint32_t        slice_pitch;
+};
+
+void            mock_xr_configure(const mock_xr_config_t& config);
+mock_xr_stats_t mock_xr_stats();
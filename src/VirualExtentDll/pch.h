@@ -8,6 +8,9 @@
 #define PCH_H
 
 // add headers that you want to pre-compile here
+// (the portable units also build on their own, without Windows, for tests/)
+#ifdef _WIN32
 #include "framework.h"
+#endif
 
 #endif //PCH_H
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "resolution_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+float ResolutionController::Update(uint64_t frameNs, uint64_t budgetNs) {
+    if (budgetNs == 0) return scale_;
+
+    estimateNs_ = estimateNs_ == 0 ? (double)frameNs
+        : estimateNs_ + config_.emaAlpha * ((double)frameNs - estimateNs_);
+
+    if (hold_ > 0) {
+        hold_--;
+        return scale_;
+    }
+
+    const double budget = (double)budgetNs;
+    if (estimateNs_ <= budget * config_.shrinkAbove && estimateNs_ >= budget * config_.growBelow)
+        return scale_;
+
+    // Cost ~ scale^2: the scale that would land on target, limited to one step
+    float want = scale_ * (float)std::sqrt(budget * config_.target / estimateNs_);
+    want = std::clamp(want, scale_ - config_.maxStep, scale_ + config_.maxStep);
+    want = std::clamp(want, config_.minScale, config_.maxScale);
+    if (want == scale_)
+        return scale_;
+
+    // The average still describes the old scale; rescale it rather than waiting for it to decay
+    estimateNs_ *= (double)(want * want) / (double)(scale_ * scale_);
+    scale_ = want;
+    hold_ = config_.holdFrames;
+    changes_++;
+    return scale_;
+}
+
+void ResolutionController::Reset() {
+    scale_ = config_.maxScale;
+    estimateNs_ = 0;
+    hold_ = 0;
+    changes_ = 0;
+}
+
+size_t resolution_replay(const ResolutionConfig& config, const float* fullResMs, size_t count,
+    float budgetMs, float* outScale) {
+    ResolutionController controller(config);
+    size_t over = 0;
+    for (size_t i = 0; i < count; i++) {
+        const float scale = controller.Scale();
+        const float ms = fullResMs[i] * scale * scale;
+        if (ms > budgetMs) over++;
+        if (outScale) outScale[i] = scale;
+        controller.Update((uint64_t)(ms * 1e6), (uint64_t)(budgetMs * 1e6));
+    }
+    return over;
+}
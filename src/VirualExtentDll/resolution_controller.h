@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Picks the fraction of the allocated swapchain to render into (per axis) from measured frame
+// times. Plain C++ with no platform or OpenXR dependencies, so it can be driven by recorded traces.
+//
+// Frame cost is taken to scale with pixel count (scale^2). The controller keeps an exponential
+// moving average of the frame time. It only acts when that leaves the band
+// [growBelow, shrinkAbove] x budget, and waits holdFrames after every change for the average to
+// settle. That band and the hold are the hysteresis that keeps it from oscillating.
+struct ResolutionConfig {
+    float    minScale = 0.5f;
+    float    maxScale = 1.0f;      // 1 = the recommended size the swapchain was allocated at
+    float    target = 0.85f;       // aim for this fraction of the frame budget
+    float    growBelow = 0.70f;    // grow when the average drops under this fraction of the budget
+    float    shrinkAbove = 0.95f;  // shrink when it rises over this one
+    float    maxStep = 0.10f;      // largest change of scale per adjustment
+    float    emaAlpha = 0.10f;
+    uint32_t holdFrames = 45;
+};
+
+class ResolutionController {
+public:
+    explicit ResolutionController(const ResolutionConfig& config = ResolutionConfig()) : config_(config), scale_(config.maxScale) {}
+
+    // One frame: its cost (the larger of CPU and GPU time) and budget (display period). Returns the scale to use next.
+    float Update(uint64_t frameNs, uint64_t budgetNs);
+    void  Reset();
+
+    float    Scale() const { return scale_; }
+    double   EstimateNs() const { return estimateNs_; }
+    uint64_t Changes() const { return changes_; }
+
+private:
+    ResolutionConfig config_;
+    float            scale_;
+    double           estimateNs_ = 0;
+    uint32_t         hold_ = 0;
+    uint64_t         changes_ = 0;
+};
+
+// Replays a trace of full-resolution frame costs (ms) through a controller, charging each frame
+// cost * scale^2 at the scale in effect for it. Fills outScale[i] (may be null); returns the number
+// of frames over budget.
+size_t resolution_replay(const ResolutionConfig& config, const float* fullResMs, size_t count,
+    float budgetMs, float* outScale);
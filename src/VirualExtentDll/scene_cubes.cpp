@@ -6,7 +6,7 @@
 #include <vector>
 
 #include "scene_cubes.h"
-#include "d3d.h"     // d3d_device, d3d_context, d3d_xr_projection, d3d_compile_shader
+#include "d3d.h"     // d3d_device, d3d_context, d3d_xr_projection, d3d_load_shader
 #include "openxr.h"  // xr_input, xr_pose_identity
 
 using namespace DirectX;
@@ -14,9 +14,10 @@ using std::vector;
 
 // ---------------- Module state ----------------
 
-struct TransformCB { XMFLOAT4X4 world; XMFLOAT4X4 viewproj; };
+struct TransformCB { XMFLOAT4X4 world; };
 
 static ID3D11VertexShader* s_vs = nullptr;
+static ID3D11VertexShader* s_vsStereo = nullptr; // single pass variant, when supported
 static ID3D11PixelShader* s_ps = nullptr;
 static ID3D11InputLayout* s_il = nullptr;
 static ID3D11Buffer* s_cb = nullptr;
@@ -25,34 +26,15 @@ static ID3D11Buffer* s_ib = nullptr;
 
 static vector<XrPosef>     s_cubes;
 
-// HLSL (same as your original app shader)
-static constexpr char kCubeShaderHLSL[] = R"_(
-cbuffer TransformBuffer : register(b0) {
-    float4x4 world;
-    float4x4 viewproj;
-};
-struct vsIn {
-    float4 pos  : SV_POSITION;
-    float3 norm : NORMAL;
-};
-struct psIn {
-    float4 pos   : SV_POSITION;
-    float3 color : COLOR0;
-};
-
-psIn vs(vsIn input) {
-    psIn output;
-    output.pos = mul(float4(input.pos.xyz, 1), world);
-    output.pos = mul(output.pos, viewproj);
-
-    float3 normal = normalize(mul(float4(input.norm, 0), world).xyz);
-
-    output.color = saturate(dot(normal, float3(0,1,0))).xxx;
-    return output;
-}
-float4 ps(psIn input) : SV_TARGET {
-    return float4(input.color, 1);
-})_";
+// shaders/scene_cubes.hlsl, precompiled by the vcxproj (d3d_load_shader falls back to compiling it)
+#ifdef VE_PRECOMPILED_SHADERS
+#include "shaders/scene_cubes_vs.h"
+#include "shaders/scene_cubes_vs_stereo.h"
+#include "shaders/scene_cubes_ps.h"
+#endif
+static const d3d_shader_t kVS = D3D_SHADER(scene_cubes, vs, "vs", "vs_5_0", false);
+static const d3d_shader_t kVSStereo = D3D_SHADER(scene_cubes, vs_stereo, "vs", "vs_5_0", true);
+static const d3d_shader_t kPS = D3D_SHADER(scene_cubes, ps, "ps", "ps_5_0", false);
 
 // Same cube geometry as before: [pos.xyz, norm.xyz] interleaved
 static float s_verts[] = {
@@ -74,12 +56,18 @@ static uint16_t s_inds[] = {
 
 bool Cubes_Init() {
 	// Shaders
-	ID3DBlob* vsb = d3d_compile_shader(kCubeShaderHLSL, "vs", "vs_5_0");
-	ID3DBlob* psb = d3d_compile_shader(kCubeShaderHLSL, "ps", "ps_5_0");
+	ID3DBlob* vsb = d3d_load_shader(kVS);
+	ID3DBlob* psb = d3d_load_shader(kPS);
 	if (!vsb || !psb) return false;
 
 	d3d_device->CreateVertexShader(vsb->GetBufferPointer(), vsb->GetBufferSize(), nullptr, &s_vs);
 	d3d_device->CreatePixelShader(psb->GetBufferPointer(), psb->GetBufferSize(), nullptr, &s_ps);
+	if (d3d_single_pass_supported) {
+		if (ID3DBlob* vss = d3d_load_shader(kVSStereo)) {
+			d3d_device->CreateVertexShader(vss->GetBufferPointer(), vss->GetBufferSize(), nullptr, &s_vsStereo);
+			vss->Release();
+		}
+	}
 
 	D3D11_INPUT_ELEMENT_DESC il[] = {
 		{"SV_POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
@@ -119,39 +107,39 @@ void Cubes_UpdatePredicted() {
 	}
 }
 
-void Cubes_Draw(const XrCompositionLayerProjectionView& view) {
-	// Build per-eye matrices
-	XMMATRIX proj = d3d_xr_projection(view.fov, 0.05f, 100.0f);
-	XMMATRIX viewM = XMMatrixInverse(nullptr, XMMatrixAffineTransformation(
-		DirectX::g_XMOne, DirectX::g_XMZero,
-		XMLoadFloat4((XMFLOAT4*)&view.pose.orientation),
-		XMLoadFloat3((XMFLOAT3*)&view.pose.position)));
+bool Cubes_NeedsDepth() {
+	return true;
+}
+
+void Cubes_Draw(const XrCompositionLayerProjectionView* views, uint32_t viewCount) {
+	(void)views; (void)viewCount; // view matrices are already bound at d3d_view_slot
 
 	// Pipeline
-	d3d_context->VSSetConstantBuffers(0, 1, &s_cb);
-	d3d_context->VSSetShader(s_vs, nullptr, 0);
-	d3d_context->PSSetShader(s_ps, nullptr, 0);
+	d3d_state.RSSetState((ID3D11RasterizerState*)nullptr);
+	d3d_state.VSSetShader(d3d_view_count > 1 ? s_vsStereo : s_vs);
+	d3d_state.PSSetShader(s_ps);
 
-	UINT stride = sizeof(float) * 6, offset = 0;
-	d3d_context->IASetVertexBuffers(0, 1, &s_vb, &stride, &offset);
-	d3d_context->IASetIndexBuffer(s_ib, DXGI_FORMAT_R16_UINT, 0);
-	d3d_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	d3d_context->IASetInputLayout(s_il);
+	d3d_state.IASetVertexBuffer(s_vb, sizeof(float) * 6, 0);
+	d3d_state.IASetIndexBuffer(s_ib, DXGI_FORMAT_R16_UINT, 0);
+	d3d_state.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	d3d_state.IASetInputLayout(s_il);
 
-	// viewproj once
 	TransformCB cb{};
-	XMStoreFloat4x4(&cb.viewproj, XMMatrixTranspose(viewM * proj));
 
 	// Draw all cubes
 	for (size_t i = 0; i < s_cubes.size(); i++) {
+		// 0.05 scale of a [-1,1] cube: bounding radius 0.05 * sqrt(3)
+		if (!d3d_sphere_visible(*(XMFLOAT3*)&s_cubes[i].position, 0.087f))
+			continue;
+
 		XMMATRIX model = XMMatrixAffineTransformation(
 			DirectX::g_XMOne * 0.05f, DirectX::g_XMZero,
 			XMLoadFloat4((XMFLOAT4*)&s_cubes[i].orientation),
 			XMLoadFloat3((XMFLOAT3*)&s_cubes[i].position));
 
 		XMStoreFloat4x4(&cb.world, XMMatrixTranspose(model));
-		d3d_context->UpdateSubresource(s_cb, 0, nullptr, &cb, 0, 0);
-		d3d_context->DrawIndexed((UINT)_countof(s_inds), 0, 0);
+		d3d_set_constants(s_cb, &cb, sizeof(cb), 0, d3d_stage_vs);
+		d3d_draw_indexed((UINT)_countof(s_inds));
 	}
 }
 
@@ -162,5 +150,6 @@ void Cubes_Shutdown() {
 	if (s_il) { s_il->Release(); s_il = nullptr; }
 	if (s_ps) { s_ps->Release(); s_ps = nullptr; }
 	if (s_vs) { s_vs->Release(); s_vs = nullptr; }
+	if (s_vsStereo) { s_vsStereo->Release(); s_vsStereo = nullptr; }
 	s_cubes.clear();
 }
@@ -4,5 +4,6 @@
 bool  Cubes_Init();
 void  Cubes_Update();                    // reacts to hand select
 void  Cubes_UpdatePredicted();           // keeps hand cubes at predicted pose
-void  Cubes_Draw(const XrCompositionLayerProjectionView& view);
+void  Cubes_Draw(const XrCompositionLayerProjectionView* views, uint32_t viewCount);
+bool  Cubes_NeedsDepth();                // cubes occlude each other
 void  Cubes_Shutdown();
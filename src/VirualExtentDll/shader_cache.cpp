@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "shader_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static const uint32_t kMagic = 0x43534556; // "VESC"
+static const uint32_t kVersion = 1;
+
+struct ShaderCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+// FNV-1a, 64 bit
+static uint64_t Fnv1a(const void* data, size_t bytes, uint64_t hash = 0xcbf29ce484222325ull) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Hashes a string including its terminator, so "ab"+"c" and "a"+"bc" differ
+static uint64_t HashString(const char* s, uint64_t hash) {
+    return s ? Fnv1a(s, strlen(s) + 1, hash) : Fnv1a("", 1, hash);
+}
+
+uint64_t ShaderCache::Key(const Request& request) const {
+    uint64_t hash = HashString(compilerId_.c_str(), 0xcbf29ce484222325ull);
+    hash = HashString(request.source, hash);
+    hash = HashString(request.entry, hash);
+    hash = HashString(request.target, hash);
+    hash = HashString(request.defines.c_str(), hash);
+    return Fnv1a(&request.flags, sizeof(request.flags), hash);
+}
+
+std::string ShaderCache::PathFor(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)key);
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+bool ShaderCache::Get(const Request& request, const CompileFn& compile, std::vector<uint8_t>* bytecode) {
+    const uint64_t key = Key(request);
+    if (!directory_.empty() && Load(key, bytecode)) {
+        stats_.hits++;
+        return true;
+    }
+
+    stats_.misses++;
+    bytecode->clear();
+    if (!compile(request, bytecode) || bytecode->empty())
+        return false;
+    if (!directory_.empty() && Store(key, *bytecode))
+        stats_.stores++;
+    return true;
+}
+
+bool ShaderCache::Load(uint64_t key, std::vector<uint8_t>* bytecode) {
+    std::ifstream file(PathFor(key), std::ios::binary);
+    if (!file)
+        return false;
+
+    ShaderCacheHeader header = {};
+    std::vector<uint8_t> data;
+    bool valid = file.read((char*)&header, sizeof(header)) &&
+        header.magic == kMagic && header.version == kVersion && header.key == key &&
+        header.size > 0 && header.size < (64ull << 20);
+    if (valid) {
+        data.resize((size_t)header.size);
+        valid = file.read((char*)data.data(), (std::streamsize)data.size()) &&
+            Fnv1a(data.data(), data.size()) == header.checksum;
+    }
+    if (!valid) {
+        stats_.invalid++;
+        return false;
+    }
+    *bytecode = std::move(data);
+    return true;
+}
+
+bool ShaderCache::Store(uint64_t key, const std::vector<uint8_t>& bytecode) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+
+    // Written next to the final name and renamed, so a reader never sees half a file
+    const std::string path = PathFor(key);
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        ShaderCacheHeader header = { kMagic, kVersion, key, bytecode.size(), Fnv1a(bytecode.data(), bytecode.size()) };
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)bytecode.data(), (std::streamsize)bytecode.size());
+        if (!file)
+            return false;
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
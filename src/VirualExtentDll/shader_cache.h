@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// On-disk cache of compiled shader bytecode for the runtime fallback of d3d_load_shader (builds
+// without the precompiled shader headers, or VE_SHADER_DIR), so shader compilation (tens of ms
+// with full optimisation) happens once per machine instead of at every injection.
+//
+// Entries are keyed by a hash of everything that affects the output: source, entry point, target,
+// defines, compile flags and the compiler's identity. Changing any of them simply produces a new
+// key; stale files are never read again. A file whose header or checksum does not match is
+// treated as a miss and overwritten. Plain C++ with no D3D dependency: the compiler is a callback,
+// so the lookup and invalidation logic can be driven with a stub.
+class ShaderCache {
+public:
+    struct Request {
+        const char* source;
+        const char* entry;
+        const char* target;
+        std::string defines;   // flattened "NAME=VALUE;..." in declaration order
+        uint32_t    flags;
+    };
+    using CompileFn = std::function<bool(const Request&, std::vector<uint8_t>* bytecode)>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t invalid = 0;   // files that existed but failed validation
+        uint64_t stores = 0;
+    };
+
+    // Empty directory: no caching, every Get compiles
+    void SetDirectory(const std::string& directory) { directory_ = directory; }
+    // Salt for the key, e.g. compiler DLL and version: a new compiler invalidates everything
+    void SetCompilerId(const std::string& compilerId) { compilerId_ = compilerId; }
+
+    // Cached bytecode for the request, or compiles it with `compile` and stores the result
+    bool Get(const Request& request, const CompileFn& compile, std::vector<uint8_t>* bytecode);
+
+    uint64_t     Key(const Request& request) const;
+    std::string  PathFor(uint64_t key) const;
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    bool Load(uint64_t key, std::vector<uint8_t>* bytecode);
+    bool Store(uint64_t key, const std::vector<uint8_t>& bytecode);
+
+    std::string directory_;
+    std::string compilerId_;
+    Stats       stats_;
+};
@@ -0,0 +1,64 @@
+// Controller parts: instanced unit cubes, lit, flat or drawn as the cursor disc
+#include "view_cb.hlsli"
+
+struct Instance {
+    float4x4 world;
+    float4   color;
+    int      hand;
+    uint     shading;
+    uint2    pad;
+};
+StructuredBuffer<Instance> instances : register(t0);
+cbuffer LatchCB : register(b2) {
+    float4x4 handWorld[2];
+    float4   handValid;
+};
+struct vsIn {
+    float3 pos  : POSITION;
+    float3 norm : NORMAL;
+};
+struct psIn {
+    float4 pos   : SV_POSITION;
+    float3 normW : NORMAL0;
+    float2 local : TEXCOORD0;
+    nointerpolation float4 color   : COLOR0;
+    nointerpolation uint   shading : SHADING0;
+#ifdef VE_STEREO
+    uint rtIndex : SV_RenderTargetArrayIndex;
+#endif
+};
+psIn vs(vsIn i, uint inst : SV_InstanceID) {
+    uint eye = inst % viewCount;
+    Instance it = instances[inst / viewCount];
+    psIn o;
+    float4 wp = mul(float4(i.pos,1), it.world);
+    float3 n  = mul(float4(i.norm,0), it.world).xyz;
+    // hand-relative parts follow the pose latched right before this eye
+    if (it.hand >= 0) {
+        wp = mul(wp, handWorld[it.hand]);
+        n  = mul(float4(n,0), handWorld[it.hand]).xyz;
+    }
+    o.pos   = mul(wp, views[eye].viewproj);
+    // transform normal
+    o.normW = normalize(n);
+    o.local = i.pos.xy;
+    o.color = it.color;
+    o.shading = it.shading;
+#ifdef VE_STEREO
+    o.rtIndex = eye;
+#endif
+    return o;
+}
+float4 ps(psIn i) : SV_TARGET {
+    if (i.shading == 1) return i.color;
+    if (i.shading == 2) {
+        float r = length(i.local);
+        if (r > 0.5) discard;
+        return r > 0.38 ? float4(0, 0, 0, 1) : i.color;
+    }
+    // simple lambert with head-light-ish up
+    float3 L = normalize(float3(0.3,0.9,0.2));
+    float NdotL = saturate(dot(i.normW, L));
+    float3 c = i.color.rgb * (0.25 + 0.75*NdotL);
+    return float4(c, i.color.a);
+}
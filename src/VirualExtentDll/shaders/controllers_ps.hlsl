@@ -0,0 +1,2 @@
+// FxCompile item: controllers.hlsl ps
+#include "controllers.hlsl"
@@ -0,0 +1,2 @@
+// FxCompile item: controllers.hlsl vs
+#include "controllers.hlsl"
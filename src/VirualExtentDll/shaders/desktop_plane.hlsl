@@ -0,0 +1,28 @@
+// The textured desktop plane (mirror U to fix left-right inversion)
+#include "view_cb.hlsli"
+
+cbuffer TransformBuffer : register(b0) {
+    float4x4 world;
+};
+struct vsIn { float3 pos:POSITION; float2 uv:TEXCOORD0; };
+struct psIn {
+    float4 pos:SV_POSITION; float2 uv:TEXCOORD0;
+#ifdef VE_STEREO
+    uint rtIndex:SV_RenderTargetArrayIndex;
+#endif
+};
+psIn vs(vsIn i, uint inst : SV_InstanceID) {
+    uint eye = inst % viewCount;
+    psIn o;
+    o.pos = mul(float4(i.pos,1), world);
+    o.pos = mul(o.pos, views[eye].viewproj);
+    o.uv  = i.uv;
+#ifdef VE_STEREO
+    o.rtIndex = eye;
+#endif
+    return o;
+}
+Texture2D tex0 : register(t0);
+SamplerState s0 : register(s0);
+// The duplicated desktop's alpha channel is undefined: always write an opaque pixel
+float4 ps(psIn i) : SV_TARGET { return float4(tex0.Sample(s0, i.uv).rgb, 1); }
@@ -0,0 +1,2 @@
+// FxCompile item: desktop_plane.hlsl ps
+#include "desktop_plane.hlsl"
@@ -0,0 +1,2 @@
+// FxCompile item: desktop_plane.hlsl vs
+#include "desktop_plane.hlsl"
@@ -0,0 +1,2 @@
+// FxCompile item: desktop_plane.hlsl vs, built with VE_STEREO=1 (set on this item in the vcxproj)
+#include "desktop_plane.hlsl"
@@ -0,0 +1,35 @@
+// The demo cubes (same as your original app shader)
+#include "view_cb.hlsli"
+
+cbuffer TransformBuffer : register(b0) {
+    float4x4 world;
+};
+struct vsIn {
+    float4 pos  : SV_POSITION;
+    float3 norm : NORMAL;
+};
+struct psIn {
+    float4 pos   : SV_POSITION;
+    float3 color : COLOR0;
+#ifdef VE_STEREO
+    uint rtIndex : SV_RenderTargetArrayIndex;
+#endif
+};
+
+psIn vs(vsIn input, uint inst : SV_InstanceID) {
+    uint eye = inst % viewCount;
+    psIn output;
+    output.pos = mul(float4(input.pos.xyz, 1), world);
+    output.pos = mul(output.pos, views[eye].viewproj);
+#ifdef VE_STEREO
+    output.rtIndex = eye;
+#endif
+
+    float3 normal = normalize(mul(float4(input.norm, 0), world).xyz);
+
+    output.color = saturate(dot(normal, float3(0,1,0))).xxx;
+    return output;
+}
+float4 ps(psIn input) : SV_TARGET {
+    return float4(input.color, 1);
+}
@@ -0,0 +1,2 @@
+// FxCompile item: scene_cubes.hlsl ps
+#include "scene_cubes.hlsl"
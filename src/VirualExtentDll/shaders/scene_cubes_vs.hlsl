@@ -0,0 +1,2 @@
+// FxCompile item: scene_cubes.hlsl vs
+#include "scene_cubes.hlsl"
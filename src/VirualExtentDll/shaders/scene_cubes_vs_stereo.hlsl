@@ -0,0 +1,2 @@
+// FxCompile item: scene_cubes.hlsl vs, built with VE_STEREO=1 (set on this item in the vcxproj)
+#include "scene_cubes.hlsl"
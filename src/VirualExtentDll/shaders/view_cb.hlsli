@@ -0,0 +1,7 @@
+// Per-view constants (b1), filled by d3d_set_views; layout of d3d_view_cb_t in D3D.cpp.
+// Vertex shaders pick their view with eye = SV_InstanceID % viewCount.
+#ifndef VIEW_CB_HLSLI
+#define VIEW_CB_HLSLI
+struct ViewBlock { float4x4 view; float4x4 proj; float4x4 viewproj; float4 camPos; float4 frustum[6]; };
+cbuffer ViewCB : register(b1) { ViewBlock views[2]; uint viewCount; };
+#endif
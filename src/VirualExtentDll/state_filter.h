@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+
+// Sits between the draw code and an immediate context and drops binds that would not change
+// anything: the same shader, buffer, layout or state object as already bound at that slot.
+//
+// Templated on the context so it has no D3D dependency of its own. StateFilter<ID3D11DeviceContext>
+// is the real one; a mock with the same method names records what actually reaches the context.
+// Only what goes through the filter is tracked, so Invalidate() whenever someone else may have
+// touched the context; D3D.cpp does so at the start of every pass, since the runtime may use it
+// in the swapchain calls and xrEndFrame.
+template <typename Context>
+class StateFilter {
+public:
+    static constexpr uint32_t kConstantSlots = 4;
+
+    void SetContext(Context* context) { context_ = context; Invalidate(); }
+
+    // Forget what is bound; the next bind of every slot goes through
+    void Invalidate() {
+        for (Binding& b : bound_) b.valid = false;
+    }
+
+    // Counters since the last EndFrame, and the totals of all finished frames
+    struct Stats {
+        uint64_t issued = 0;
+        uint64_t dropped = 0;
+    };
+    Stats EndFrame() {
+        Stats frame = frame_;
+        total_.issued += frame.issued;
+        total_.dropped += frame.dropped;
+        frame_ = {};
+        return frame;
+    }
+    const Stats& Frame() const { return frame_; }
+    const Stats& Total() const { return total_; }
+
+    template <typename Shader> void VSSetShader(Shader* shader) {
+        if (Changed(kVS, shader)) context_->VSSetShader(shader, nullptr, 0);
+    }
+    template <typename Shader> void PSSetShader(Shader* shader) {
+        if (Changed(kPS, shader)) context_->PSSetShader(shader, nullptr, 0);
+    }
+    template <typename Layout> void IASetInputLayout(Layout* layout) {
+        if (Changed(kInputLayout, layout)) context_->IASetInputLayout(layout);
+    }
+    template <typename Topology> void IASetPrimitiveTopology(Topology topology) {
+        if (Changed(kTopology, nullptr, (uint64_t)topology)) context_->IASetPrimitiveTopology(topology);
+    }
+    template <typename Buffer> void IASetVertexBuffer(Buffer* buffer, uint32_t stride, uint32_t offset) {
+        if (Changed(kVertexBuffer, buffer, stride, offset)) {
+            unsigned int strides[1] = { stride }, offsets[1] = { offset };
+            context_->IASetVertexBuffers(0, 1, &buffer, strides, offsets);
+        }
+    }
+    template <typename Buffer, typename Format> void IASetIndexBuffer(Buffer* buffer, Format format, uint32_t offset) {
+        if (Changed(kIndexBuffer, buffer, (uint64_t)format, offset)) context_->IASetIndexBuffer(buffer, format, offset);
+    }
+    template <typename State> void RSSetState(State* state) {
+        if (Changed(kRasterizer, state)) context_->RSSetState(state);
+    }
+    template <typename Sampler> void PSSetSampler(Sampler* sampler) {
+        if (Changed(kPSSampler, sampler)) context_->PSSetSamplers(0, 1, &sampler);
+    }
+    template <typename View> void PSSetShaderResource(View* view) {
+        if (Changed(kPSResource, view)) context_->PSSetShaderResources(0, 1, &view);
+    }
+    template <typename View> void VSSetShaderResource(View* view) {
+        if (Changed(kVSResource, view)) context_->VSSetShaderResources(0, 1, &view);
+    }
+
+    // Constant buffers: the bind itself is left to the caller (whole buffer or a range of one),
+    // the filter only says whether it is needed. `first` is the range start, 0 for whole buffers.
+    bool VSConstantsChanged(uint32_t slot, const void* buffer, uint32_t first) {
+        return slot < kConstantSlots ? Changed(kVSConstants + slot, buffer, first) : Issue();
+    }
+    bool PSConstantsChanged(uint32_t slot, const void* buffer, uint32_t first) {
+        return slot < kConstantSlots ? Changed(kPSConstants + slot, buffer, first) : Issue();
+    }
+
+private:
+    enum : uint32_t {
+        kVS, kPS, kInputLayout, kTopology, kVertexBuffer, kIndexBuffer, kRasterizer, kPSSampler, kPSResource, kVSResource,
+        kVSConstants,
+        kPSConstants = kVSConstants + kConstantSlots,
+        kSlotCount = kPSConstants + kConstantSlots,
+    };
+
+    struct Binding {
+        const void* object;
+        uint64_t    a;
+        uint64_t    b;
+        bool        valid;
+    };
+
+    bool Changed(uint32_t slot, const void* object, uint64_t a = 0, uint64_t b = 0) {
+        Binding& bound = bound_[slot];
+        if (bound.valid && bound.object == object && bound.a == a && bound.b == b) {
+            frame_.dropped++;
+            return false;
+        }
+        bound = { object, a, b, true };
+        return Issue();
+    }
+    bool Issue() { frame_.issued++; return true; }
+
+    Context* context_ = nullptr;
+    Binding  bound_[kSlotCount] = {};
+    Stats    frame_;
+    Stats    total_;
+};
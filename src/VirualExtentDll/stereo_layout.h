@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+
+// How a frame's views map onto swapchains, passes and instanced draws, with and without
+// single-pass stereo.
+//
+// Plain C++ so the bookkeeping can be checked without a GPU: OpenXR.cpp creates the swapchains
+// and D3D.cpp sizes its draws from it, and the vertex shaders undo StereoDrawInstances with the
+// same arithmetic as StereoSplitInstance (eye = SV_InstanceID % viewCount).
+struct StereoLayout {
+    bool     singlePass = false;
+    uint32_t viewCount = 0;
+    uint32_t swapchainCount = 0;   // one per view, or one array swapchain for all of them
+    uint32_t arraySize = 1;        // slices per swapchain image
+
+    // Passes run per frame; pass p draws views [PassFirstView(p), + PassViewCount())
+    uint32_t PassCount() const { return singlePass ? 1 : viewCount; }
+    uint32_t PassFirstView(uint32_t pass) const { return singlePass ? 0 : pass; }
+    uint32_t PassViewCount() const { return singlePass ? viewCount : 1; }
+
+    // Where view v is rendered
+    uint32_t ViewSwapchain(uint32_t view) const { return singlePass ? 0 : view; }
+    uint32_t ViewArrayIndex(uint32_t view) const { return singlePass ? view : 0; }
+};
+
+// Single pass needs the GPU feature and exactly two views of one size (they share one image rect).
+// widths/heights are the recommended image rects of the views.
+inline StereoLayout StereoPlan(bool wanted, bool supported, uint32_t viewCount, const uint32_t* widths, const uint32_t* heights) {
+    StereoLayout l;
+    l.viewCount = viewCount;
+    l.singlePass = wanted && supported && viewCount == 2 && widths[0] == widths[1] && heights[0] == heights[1];
+    l.swapchainCount = l.singlePass ? 1 : viewCount;
+    l.arraySize = l.singlePass ? viewCount : 1;
+    return l;
+}
+
+// A draw of `instances` instances in a pass of `passViews` views: every instance once per view
+inline uint32_t StereoDrawInstances(uint32_t instances, uint32_t passViews) {
+    return instances * passViews;
+}
+
+// What the vertex shader makes of SV_InstanceID
+struct StereoInstance {
+    uint32_t eye;        // view within the pass
+    uint32_t instance;   // instance of the geometry
+};
+inline StereoInstance StereoSplitInstance(uint32_t svInstance, uint32_t passViews) {
+    return { svInstance % passViews, svInstance / passViews };
+}
@@ -0,0 +1,147 @@
+#include "alloc_audit.h"
+#include "frame_arena.h"
+#include "frame_timing.h"
+#include "input_injection.h"
+#include "triple_buffer.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// The allocation audit on Linux: a stand-in runtime drives the frame loop's portable half (frame
+// arena, phase timing and its report, snapshot hand-over, batched injection) on a render and an
+// input thread, each counting its own allocations after warm-up the way ve_run and InputThread
+// do. Built with VE_ALLOC_AUDIT; any steady-state allocation fails the test.
+
+static const uint32_t kWarmup = 120, kFrames = 2000;
+
+// What xrWaitFrame and xrLocateViews would hand back
+struct StandInRuntime {
+    int64_t period = 11111111;
+    int64_t time = 0;
+    struct View { float pose[7]; float fov[4]; uint32_t rect[4]; uint32_t arrayIndex; };
+    uint32_t viewCount = 2;
+
+    int64_t WaitFrame() { return time += period; }
+    void LocateViews(View* views, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            std::memset(&views[i], 0, sizeof(View));
+            views[i].pose[3] = 1.0f;
+            views[i].arrayIndex = i;
+        }
+    }
+};
+
+struct Snapshot {
+    uint64_t seq = 0;
+    float    values[64] = {};
+};
+
+// Counts events instead of keeping them, like SendInput
+class CountingSink : public IInputSink {
+public:
+    void Submit(const InjectedEvent*, uint32_t count) override { events += count; }
+    std::atomic<uint64_t> events = 0;
+};
+
+struct Audit {
+    uint64_t render = 0;
+    uint64_t input = 0;
+    size_t   arenaHighWater = 0;
+};
+
+static Audit RunLoop(bool leakOnRender, bool leakOnInput) {
+    StandInRuntime runtime;
+    FrameArena arena;
+    arena.Init(runtime.viewCount * sizeof(StandInRuntime::View) + alignof(std::max_align_t));
+    static FrameTimer timer;
+    static FrameTimer::Scratch scratch;
+    timer.SetEnabled(true);
+    TripleBuffer<Snapshot> snapshots;
+    CountingSink sink;
+
+    Audit audit;
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> inputAllocs = 0, inputPolls = 0;
+    std::vector<int*> leaks;   // render thread only
+    leaks.reserve(2 * kFrames);
+
+    std::thread input([&] {
+        InputInjector injector(&sink);
+        std::vector<int*> inputLeaks;
+        inputLeaks.reserve(100000);
+        uint64_t polls = 0;
+        while (!stop.load(std::memory_order_acquire)) {
+            const uint64_t before = alloc_audit_thread_count();
+            Snapshot& s = snapshots.WriteSlot();
+            s.seq = ++polls;
+            for (uint32_t i = 0; i < 64; i++) s.values[i] = (float)((polls + i) % 7);
+            injector.MouseMoveTo((int32_t)polls % 1920, 540);
+            injector.MouseButton(false, polls % 2 == 0);
+            injector.Flush();
+            if (leakOnInput && inputLeaks.size() < inputLeaks.capacity()) inputLeaks.push_back(new int(1));
+            snapshots.Publish();
+            inputPolls.store(polls, std::memory_order_relaxed);
+            if (polls > kWarmup)
+                inputAllocs.fetch_add(alloc_audit_thread_count() - before, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        for (int* p : inputLeaks) delete p;
+    });
+
+    char report[2048];
+    for (uint32_t f = 0; f < kFrames; f++) {
+        const uint64_t before = alloc_audit_thread_count();
+
+        arena.Reset();
+        const int64_t displayTime = runtime.WaitFrame();
+        timer.Add(FP_WaitFrame, 1000);
+        snapshots.Update();
+        const Snapshot& in = snapshots.ReadSlot();
+        auto* views = arena.AllocArray<StandInRuntime::View>(runtime.viewCount);
+        CHECK(views != nullptr);
+        if (views) runtime.LocateViews(views, runtime.viewCount);
+        timer.Add(FP_RenderEye0, 2000 + (uint64_t)in.values[0]);
+        timer.Commit(displayTime, runtime.period);
+        if (timer.FrameCount() % FrameTimer::kCapacity == 0)
+            timer.Format(report, sizeof(report), scratch);
+        if (leakOnRender) leaks.push_back(new int(2));
+
+        if (f >= kWarmup)
+            audit.render += alloc_audit_thread_count() - before;
+    }
+    // The input thread runs at its own rate: give it a steady state of its own too
+    while (inputPolls.load(std::memory_order_relaxed) < 2 * kWarmup)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    stop = true;
+    input.join();
+    for (int* p : leaks) delete p;
+
+    audit.input = inputAllocs.load();
+    audit.arenaHighWater = arena.HighWater();
+    CHECK_EQ(arena.Failures(), 0);
+    CHECK(sink.events.load() > 0);
+    arena.Shutdown();
+    return audit;
+}
+
+int main() {
+    CHECK(alloc_audit_enabled());
+
+    // The counters see what the threads allocate...
+    const Audit leaky = RunLoop(true, true);
+    CHECK(leaky.render >= kFrames - kWarmup);
+    CHECK(leaky.input > 0);
+
+    // ...and the steady-state loop allocates nothing on either thread
+    const Audit clean = RunLoop(false, false);
+    CHECK_EQ(clean.render, 0);
+    CHECK_EQ(clean.input, 0);
+    CHECK(clean.arenaHighWater <= 2 * sizeof(StandInRuntime::View) + alignof(std::max_align_t));
+    std::printf("render %llu, input %llu steady-state allocations; arena high water %zu bytes\n",
+        (unsigned long long)clean.render, (unsigned long long)clean.input, clean.arenaHighWater);
+    return ve_test_result("alloc_audit_test");
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdio>
+
+// Minimal assertions for the standalone tests: a failed CHECK prints where and carries on,
+// main() returns ve_test_result() so ctest sees the failure.
+inline int& ve_test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ve_test_failures()++;                                                   \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                              \
+    do {                                                                            \
+        const auto va_ = (a);                                                       \
+        const auto vb_ = (b);                                                       \
+        if (!(va_ == vb_)) {                                                        \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",   \
+                __FILE__, __LINE__, #a, #b, (long long)va_, (long long)vb_);       \
+            ve_test_failures()++;                                                   \
+        }                                                                           \
+    } while (0)
+
+inline int ve_test_result(const char* name) {
+    if (ve_test_failures())
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, ve_test_failures());
+    else
+        std::printf("%s: ok\n", name);
+    return ve_test_failures() ? 1 : 0;
+}
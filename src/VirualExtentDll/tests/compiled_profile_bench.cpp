@@ -0,0 +1,114 @@
+#include "controller_config.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// compile_controller_profile on a profile far larger than any real one, to keep the grouping
+// linear in the number of mappings. Handles and paths are made up: nothing here calls OpenXR.
+
+// Link seam: the evaluator's commands, recorded instead of injected
+static std::vector<InputCommand> g_ran;
+void run_input_command(const InputCommand& cmd) { g_ran.push_back(cmd); }
+void flush_input_commands() {}
+
+static XrAction FakeAction(uint32_t i) { return (XrAction)(uintptr_t)(0x1000 + i); }
+
+// paths * perPath mappings, each path's mappings spread across the whole map
+static ControllerProfile MakeProfile(uint32_t paths, uint32_t perPath) {
+    ControllerProfile p;
+    p.name = "/interaction_profiles/test/bench";
+    for (uint32_t k = 0; k < perPath; k++) {
+        for (uint32_t i = 0; i < paths; i++) {
+            MappingAction m;
+            m.name = (i & 1) ? "/user/hand/left/input/x" : "/user/hand/right/input/x";
+            m.xr_path = 100 + i;
+            m.xr_action = FakeAction(i);
+            m.xr_actionType = XR_ACTION_TYPE_BOOLEAN_INPUT;
+            m.if_down_action = "left_mouse_down";
+            p.map.push_back(m);
+        }
+    }
+    return p;
+}
+
+static void Grouping() {
+    const uint32_t paths = 2000, perPath = 4;
+    ControllerProfile profile = MakeProfile(paths, perPath);
+    // A mapping with no action is never polled (the last one of path 5, so input order stays)
+    profile.map[paths * (perPath - 1) + 5].xr_action = XR_NULL_HANDLE;
+    const XrPath hands[2] = { 1, 2 };
+
+    CompiledProfile out;
+    compile_controller_profile(profile, hands, out);
+
+    CHECK_EQ(out.map.size(), paths * perPath);
+    CHECK_EQ(out.inputs.size(), paths);
+    CHECK_EQ(out.fanout.size(), paths * perPath - 1);
+    bool ok = true;
+    for (uint32_t k = 0; k < paths; k++) {
+        const CompiledInput& in = out.inputs[k];
+        ok &= in.action == FakeAction(k);
+        ok &= in.subaction == hands[(k & 1) ? 0 : 1];
+        ok &= in.count == (k == 5 ? perPath - 1 : perPath);
+        for (uint32_t j = 0; j < in.count; j++) {
+            const uint32_t mi = out.fanout[in.first + j];
+            ok &= out.map[mi].path == 100 + k;
+            if (j > 0) ok &= mi > out.fanout[in.first + j - 1];   // map order within the group
+        }
+    }
+    CHECK(ok);
+}
+
+static void Timing() {
+    const uint32_t sizes[] = { 250, 1000, 4000, 16000 };
+    const XrPath hands[2] = { 1, 2 };
+    double perMapping[4] = {};
+    for (int s = 0; s < 4; s++) {
+        ControllerProfile profile = MakeProfile(sizes[s], 4);
+        CompiledProfile out;
+        const int reps = 5;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++)
+            compile_controller_profile(profile, hands, out);
+        auto t1 = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / reps;
+        perMapping[s] = ns / profile.map.size();
+        std::printf("%6u inputs, %6zu mappings: %8.3f ms, %6.1f ns/mapping\n",
+            sizes[s], profile.map.size(), ns / 1e6, perMapping[s]);
+    }
+    // 64x the inputs: a quadratic grouping costs ~64x per mapping, a hashed one about the same.
+    // The bound is loose so a busy machine does not fail it.
+    CHECK(perMapping[3] < perMapping[0] * 8);
+}
+
+static void Evaluate() {
+    ControllerProfile profile = MakeProfile(2, 1);
+    profile.map[0].if_up_action = "key_up";
+    profile.map[0].key_up = 0x41;
+    profile.map[1].xr_actionType = XR_ACTION_TYPE_FLOAT_INPUT;
+    profile.map[1].if_passed_over = MappingAction::ThresholdAction{ 0.5f, "right_mouse_down", {}, {} };
+    const XrPath hands[2] = { 1, 2 };
+    CompiledProfile out;
+    compile_controller_profile(profile, hands, out);
+
+    g_ran.clear();
+    deal_with_bool_action(out.map[0], true);
+    deal_with_bool_action(out.map[0], false);
+    deal_with_float_action(out.map[1], 0.7f, 0.2f);
+    deal_with_float_action(out.map[1], 0.9f, 0.7f);   // already over: no edge
+    CHECK_EQ(g_ran.size(), 3);
+    if (g_ran.size() == 3) {
+        CHECK(g_ran[0].op == InputOp::MouseDown && g_ran[0].arg == 0);
+        CHECK(g_ran[1].op == InputOp::KeyUp && g_ran[1].arg == 0x41);
+        CHECK(g_ran[2].op == InputOp::MouseDown && g_ran[2].arg == 1);
+    }
+}
+
+int main() {
+    Grouping();
+    Evaluate();
+    Timing();
+    return ve_test_result("compiled_profile_bench");
+}
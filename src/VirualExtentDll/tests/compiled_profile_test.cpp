@@ -0,0 +1,147 @@
+#include "controller_config.h"
+#include "check.h"
+
+#include <vector>
+
+// fan_out_input on a touch-controller-like profile whose thumbstick is shared by four mappings:
+// one input state reaches every mapping bound to it, each mapping keeps its own edge state, and
+// the commands of a poll come out grouped by input (in order of first use), in map order within
+// an input. Handles and paths are made up, as openxr_generate_actions would hand them out.
+
+// Link seam: the evaluator's commands, recorded instead of injected
+static std::vector<InputCommand> g_ran;
+void run_input_command(const InputCommand& cmd) { g_ran.push_back(cmd); }
+void flush_input_commands() {}
+
+static const XrAction kStick = (XrAction)(uintptr_t)0x1001;
+static const XrAction kClick = (XrAction)(uintptr_t)0x1002;
+static const XrAction kTrigger = (XrAction)(uintptr_t)0x1003;
+
+static MappingAction Mapping(const char* name, XrAction action, XrPath path, XrActionType type) {
+    MappingAction m;
+    m.name = name;
+    m.xr_action = action;
+    m.xr_path = path;
+    m.xr_actionType = type;
+    return m;
+}
+
+static MappingAction Stick(bool x, bool over, int key) {
+    MappingAction m = Mapping("/user/hand/right/input/thumbstick", kStick, 10, XR_ACTION_TYPE_VECTOR2F_INPUT);
+    m.is_x = x;
+    m.key_down = key;
+    MappingAction::ThresholdAction t{ over ? 0.5f : -0.5f, "key_down", key, {} };
+    if (over) m.if_passed_over = t;
+    else      m.if_passed_under = t;
+    return m;
+}
+
+static ControllerProfile MakeProfile() {
+    ControllerProfile p;
+    p.name = "/interaction_profiles/oculus/touch_controller";
+    p.map.push_back(Stick(true, true, 0x20));                 // 0: right, D
+    MappingAction click = Mapping("/user/hand/right/input/a/click", kClick, 11, XR_ACTION_TYPE_BOOLEAN_INPUT);
+    click.if_down_action = "left_mouse_down";
+    click.if_up_action = "left_mouse_up";
+    p.map.push_back(click);                                   // 1
+    p.map.push_back(Stick(false, true, 0x11));                // 2: up, W
+    p.map.push_back(Stick(true, false, 0x1e));                // 3: left, A
+    MappingAction trigger = Mapping("/user/hand/left/input/trigger/value", kTrigger, 12, XR_ACTION_TYPE_FLOAT_INPUT);
+    trigger.if_passed_over = MappingAction::ThresholdAction{ 0.8f, "right_mouse_down", {}, {} };
+    p.map.push_back(trigger);                                 // 4
+    MappingAction shift = Mapping("/user/hand/right/input/a/click", kClick, 11, XR_ACTION_TYPE_BOOLEAN_INPUT);
+    shift.key_down = 0x2a;
+    shift.if_down_action = "key_down";
+    p.map.push_back(shift);                                   // 5: same input as 1
+    p.map.push_back(Stick(false, false, 0x1f));               // 6: down, S
+    MappingAction noAxis = Mapping("/user/hand/right/input/thumbstick", kStick, 10, XR_ACTION_TYPE_VECTOR2F_INPUT);
+    noAxis.if_down_action = "left_mouse_down";
+    p.map.push_back(noAxis);                                  // 7: vector2 without is_x: never evaluated
+    return p;
+}
+
+static bool Is(const InputCommand& c, InputOp op, int32_t arg) { return c.op == op && c.arg == arg; }
+
+static void Grouping() {
+    const XrPath hands[2] = { 1, 2 };
+    CompiledProfile out;
+    compile_controller_profile(MakeProfile(), hands, out);
+
+    CHECK_EQ(out.inputs.size(), 3);
+    CHECK_EQ(out.fanout.size(), 7);
+    if (out.inputs.size() != 3 || out.fanout.size() != 7)
+        return;
+    const uint32_t expected[7] = { 0, 2, 3, 6, 1, 5, 4 };
+    for (uint32_t i = 0; i < 7; i++)
+        CHECK_EQ(out.fanout[i], expected[i]);
+    CHECK(out.inputs[0].action == kStick && out.inputs[0].first == 0 && out.inputs[0].count == 4);
+    CHECK(out.inputs[1].action == kClick && out.inputs[1].first == 4 && out.inputs[1].count == 2);
+    CHECK(out.inputs[2].action == kTrigger && out.inputs[2].first == 6 && out.inputs[2].count == 1);
+    CHECK(out.inputs[2].subaction == hands[0]);
+    CHECK(out.inputs[0].type == XR_ACTION_TYPE_VECTOR2F_INPUT);
+}
+
+// What poll_controller_profile does with the states it reads: each input once, in input order
+static bool Poll(CompiledProfile& p, XrVector2f stick, bool click, float trigger, bool changed[3]) {
+    const XrVector2f values[3] = { stick, { click ? 1.0f : 0.0f, 0.0f }, { trigger, 0.0f } };
+    bool any = false;
+    for (uint32_t n = 0; n < 3; n++)
+        any |= changed[n] = fan_out_input(p, n, values[n]);
+    return any;
+}
+
+static void FanOut() {
+    const XrPath hands[2] = { 1, 2 };
+    CompiledProfile p;
+    compile_controller_profile(MakeProfile(), hands, p);
+    if (p.inputs.size() != 3)
+        return;
+    bool changed[3];
+
+    // Stick up-right, A pressed, trigger pulled: grouped by input, not in map order (D, click, W...)
+    g_ran.clear();
+    CHECK(Poll(p, { 0.9f, 0.9f }, true, 0.9f, changed));
+    CHECK(changed[0] && changed[1] && changed[2]);
+    CHECK_EQ(g_ran.size(), 5);
+    if (g_ran.size() == 5) {
+        CHECK(Is(g_ran[0], InputOp::KeyDown, 0x20));     // map 0, stick x
+        CHECK(Is(g_ran[1], InputOp::KeyDown, 0x11));     // map 2, stick y
+        CHECK(Is(g_ran[2], InputOp::MouseDown, 0));      // map 1, click
+        CHECK(Is(g_ran[3], InputOp::KeyDown, 0x2a));     // map 5, click
+        CHECK(Is(g_ran[4], InputOp::MouseDown, 1));      // map 4, trigger
+    }
+    // Every mapping of the stick took the state, evaluated or not
+    CHECK(p.map[0].last_float == 0.9f && p.map[3].last_float == 0.9f);
+    CHECK(p.map[2].last_float == 0.9f && p.map[6].last_float == 0.9f);
+    CHECK(p.map[7].last_float == 0.0f);
+
+    // The same states again: no mapping sees a change
+    g_ran.clear();
+    CHECK(!Poll(p, { 0.9f, 0.9f }, true, 0.9f, changed));
+    CHECK(g_ran.empty());
+
+    // Only x moves, to the far left: the x mappings see it, the y mappings do not
+    g_ran.clear();
+    CHECK(Poll(p, { -0.9f, 0.9f }, true, 0.9f, changed));
+    CHECK(changed[0] && !changed[1] && !changed[2]);
+    CHECK_EQ(g_ran.size(), 1);
+    if (g_ran.size() == 1)
+        CHECK(Is(g_ran[0], InputOp::KeyDown, 0x1e));    // map 3 passed under; map 0 only changed
+    CHECK(p.map[0].last_float == -0.9f && p.map[2].last_float == 0.9f);
+
+    // Release A: both of its mappings, in map order (map 5 has no up action)
+    g_ran.clear();
+    CHECK(Poll(p, { -0.9f, 0.9f }, false, 0.9f, changed));
+    CHECK(!changed[0] && changed[1] && !changed[2]);
+    CHECK_EQ(g_ran.size(), 2);
+    if (g_ran.size() == 2) {
+        CHECK(Is(g_ran[0], InputOp::MouseUp, 0));
+        CHECK(g_ran[1].op == InputOp::None);
+    }
+}
+
+int main() {
+    Grouping();
+    FanOut();
+    return ve_test_result("compiled_profile_test");
+}
@@ -0,0 +1,76 @@
+#include "constant_ring.h"
+#include "check.h"
+
+#include <vector>
+
+// The constant ring as D3D.cpp drives it: every pass uploads its view block and then the
+// constants of each draw, all suballocated from one buffer.
+
+struct Range { uint32_t offset, size; };
+
+static bool Overlap(const Range& a, const Range& b) {
+    return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+static void Alignment() {
+    ConstantRing ring;
+    ring.Init(4096);
+    uint32_t offset, size;
+    bool discard;
+
+    // The first allocation discards: the buffer's old contents may still be in flight
+    CHECK(ring.Alloc(16, &offset, &size, &discard));
+    CHECK(discard);
+    CHECK_EQ(offset, 0);
+    CHECK_EQ(size, ConstantRing::kAlignment);
+
+    CHECK(ring.Alloc(300, &offset, &size, &discard));
+    CHECK(!discard);
+    CHECK_EQ(offset, 256);
+    CHECK_EQ(size, 512);
+
+    // Never fits
+    CHECK(!ring.Alloc(8192, &offset, &size, &discard));
+    CHECK(!ring.Alloc(0, &offset, &size, &discard));
+}
+
+// A frame: per pass one view block (d3d_set_views) and the module draws
+static void Frames() {
+    const uint32_t kViewBlock = 624;    // d3d_view_cb_t: two view blocks and the count
+    const uint32_t kDraw = 80;          // a module's per-draw constants
+    const uint32_t kDrawsPerPass = 12;
+
+    ConstantRing ring;
+    ring.Init(64 * 1024);
+    uint64_t discards = 0;
+    for (uint32_t frame = 0; frame < 200; frame++) {
+        std::vector<Range> live;   // everything this frame's draws still read
+        bool ok = true;
+        for (uint32_t pass = 0; pass < 2; pass++) {
+            for (uint32_t d = 0; d <= kDrawsPerPass; d++) {
+                uint32_t offset, size;
+                bool discard;
+                ok &= ring.Alloc(d == 0 ? kViewBlock : kDraw, &offset, &size, &discard);
+                if (discard) {
+                    discards++;
+                    live.clear();   // a discard hands the driver a fresh buffer
+                }
+                const Range r = { offset, size };
+                for (const Range& l : live) ok &= !Overlap(l, r);
+                ok &= offset % ConstantRing::kAlignment == 0 && offset + size <= ring.Capacity();
+                live.push_back(r);
+            }
+        }
+        CHECK(ok);
+    }
+    // 26 allocations per frame, 200 frames: one discard per wrap, not per upload
+    CHECK_EQ(ring.Allocs(), 200 * 2 * (kDrawsPerPass + 1));
+    CHECK_EQ(discards, ring.Wraps());
+    CHECK(discards < 200);
+}
+
+int main() {
+    Alignment();
+    Frames();
+    return ve_test_result("constant_ring_test");
+}
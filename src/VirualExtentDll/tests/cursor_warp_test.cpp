@@ -0,0 +1,81 @@
+#include "interaction.h"
+#include "check.h"
+
+// CursorWarpPolicy with scripted pointer sequences: the in-VR cursor shows hover, and the OS
+// cursor is only warped when it settles, before an injection that needs it there, or while
+// dragging.
+
+static int32_t g_x, g_y;
+
+static bool Hover(CursorWarpPolicy& p, int32_t x, int32_t y) { return p.Hover(true, x, y, &g_x, &g_y); }
+
+static void MovingAndSettling() {
+    CursorWarpPolicy p;   // 3 px, 8 frames
+    // Sweeping across the desktop: never warps
+    for (int i = 0; i < 20; i++)
+        CHECK(!Hover(p, 100 + 10 * i, 300));
+    CHECK_EQ(p.Warps(), 0);
+    CHECK_EQ(p.Suppressed(), 20);
+
+    // Held still: warps once, on the frame it has been still for settleFrames
+    for (int i = 0; i < 8; i++)
+        CHECK(!Hover(p, 500, 500));
+    CHECK(Hover(p, 500, 500));
+    CHECK(g_x == 500 && g_y == 500);
+    CHECK_EQ(p.Warps(), 1);
+    CHECK(!Hover(p, 500, 500));
+
+    // Hand jitter within the threshold of the warp: no more warps, however long it lasts
+    for (int i = 0; i < 30; i++)
+        CHECK(!Hover(p, 500 + (i & 1), 500 + (i % 3)));
+    CHECK_EQ(p.Warps(), 1);
+
+    // Off the desktop: nothing to warp to, not counted
+    const uint64_t suppressed = p.Suppressed();
+    CHECK(!p.Hover(false, 0, 0, &g_x, &g_y));
+    CHECK_EQ(p.Suppressed(), suppressed);
+}
+
+static void Injection() {
+    CursorWarpPolicy p;
+    // No pointer on the desktop: inject where the cursor is
+    CHECK(!p.BeforeInjection(10, 10, &g_x, &g_y));
+
+    // A click while moving: the cursor is elsewhere, so warp first
+    CHECK(!Hover(p, 800, 400));
+    CHECK(p.BeforeInjection(10, 10, &g_x, &g_y));
+    CHECK(g_x == 800 && g_y == 400);
+    CHECK_EQ(p.Warps(), 1);
+
+    // A second click on the same spot: already there
+    CHECK(!p.BeforeInjection(800, 400, &g_x, &g_y));
+    CHECK_EQ(p.Warps(), 1);
+}
+
+static void Drag() {
+    CursorWarpPolicy p;
+    CHECK(!Hover(p, 200, 200));
+    CHECK(p.BeforeInjection(0, 0, &g_x, &g_y));
+    p.ButtonDown();
+
+    // Held: every move is followed at once, staying put is not
+    CHECK(Hover(p, 240, 200));
+    CHECK(g_x == 240 && g_y == 200);
+    CHECK(!Hover(p, 240, 200));
+    CHECK(Hover(p, 241, 200));   // even within the hover threshold
+    CHECK_EQ(p.Warps(), 3);
+
+    // Released: back to hover rules
+    p.ButtonUp();
+    CHECK(!Hover(p, 300, 200));
+    CHECK_EQ(p.Warps(), 3);
+    p.ButtonUp();                // unbalanced releases are ignored
+    CHECK(!Hover(p, 320, 200));
+}
+
+int main() {
+    MovingAndSettling();
+    Injection();
+    Drag();
+    return ve_test_result("cursor_warp_test");
+}
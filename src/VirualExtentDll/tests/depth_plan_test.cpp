@@ -0,0 +1,47 @@
+#include "depth_plan.h"
+#include "check.h"
+
+// Depth buffers are shared per swapchain, and only allocated when something drawn depth tests
+
+static void Required() {
+    // ve_run's table: desktop plane (no depth of its own), controllers, cubes (not drawn)
+    const DepthUser projection[] = { { true, false }, { true, true }, { false, true } };
+    CHECK(DepthRequired(projection, 3));
+
+    // Only the plane drawn, or a depth-testing module that isn't drawn: no depth at all
+    const DepthUser planeOnly[] = { { true, false }, { false, true } };
+    CHECK(!DepthRequired(planeOnly, 2));
+    CHECK(!DepthRequired(nullptr, 0));
+}
+
+static void Plan() {
+    // Per eye: 3 images of 1832x1920 share one buffer
+    const uint64_t one = 1832ull * 1920 * 4;
+    DepthPlan p = PlanDepth(1832, 1920, 1, 3, true);
+    CHECK_EQ(p.textures, 1);
+    CHECK_EQ(p.bytes, one);
+    CHECK_EQ(p.savedBytes, 2 * one);
+
+    // Single pass: one buffer covers both slices
+    p = PlanDepth(1832, 1920, 2, 3, true);
+    CHECK_EQ(p.textures, 1);
+    CHECK_EQ(p.bytes, 2 * one);
+    CHECK_EQ(p.savedBytes, 4 * one);
+
+    // Not required: nothing allocated, everything saved
+    p = PlanDepth(1832, 1920, 1, 3, false);
+    CHECK_EQ(p.textures, 0);
+    CHECK_EQ(p.bytes, 0);
+    CHECK_EQ(p.savedBytes, 3 * one);
+
+    // No images, nothing to share
+    p = PlanDepth(1832, 1920, 1, 0, true);
+    CHECK_EQ(p.textures, 0);
+    CHECK_EQ(p.bytes, 0);
+}
+
+int main() {
+    Required();
+    Plan();
+    return ve_test_result("depth_plan_test");
+}
@@ -0,0 +1,184 @@
+#include "dirty_rects.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Replays rect streams through the same steps DesktopCapture::captureOne takes: merge the frame's
+// rects, push them into the history, and patch the ring slot being written with what changed
+// since that slot was last written (or copy the whole frame). Reports the bytes copied per frame
+// against a full CopyResource of every frame.
+//
+// Without arguments it replays recorded-style streams of typical desktop activity on a 2560x1440
+// output. Pass files recorded with VE_DIRTY_RECT_LOG=<file> to replay real captures instead.
+
+static const uint32_t kW = 2560, kH = 1440;
+static const int      kSlots = 3;     // DesktopCapture's TripleBuffer
+static const int      kFrames = 600;
+
+struct Replay {
+    double   frames = 0;
+    double   fullBytes = 0;
+    double   copiedBytes = 0;
+    uint32_t fullCopies = 0;
+    double   mergeNs = 0;
+};
+
+static Replay Run(const std::vector<RecordedFrame>& stream) {
+    Replay r;
+    DirtyRectHistory history;
+    uint64_t slotFrame[kSlots] = {};
+    uint32_t slotW[kSlots] = {}, slotH[kSlots] = {};
+    uint32_t histW = 0, histH = 0;
+    uint64_t frame = 0;
+    std::vector<DirtyRect> rects, patch;
+    rects.reserve(256);
+    patch.reserve(256);
+
+    for (const RecordedFrame& f : stream) {
+        if (f.w != histW || f.h != histH) {
+            history.Reset(f.w, f.h);
+            histW = f.w; histH = f.h;
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        if (f.full) {
+            rects.assign(1, DirtyRect{ 0, 0, (int32_t)f.w, (int32_t)f.h });
+        }
+        else {
+            rects.assign(f.rects.begin(), f.rects.end());
+            MergeDirtyRects(rects, f.w, f.h);
+        }
+        history.Push(++frame, rects);
+        const int slot = (int)(frame % kSlots);
+        const bool recreated = slotW[slot] != f.w || slotH[slot] != f.h;
+        const bool partial = !recreated && history.CollectSince(slotFrame[slot], patch);
+        r.mergeNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+        const double full = (double)f.w * f.h * 4;
+        r.fullBytes += full;
+        r.copiedBytes += partial ? (double)DirtyRectsArea(patch) * 4 : full;
+        r.fullCopies += partial ? 0 : 1;
+        r.frames++;
+        slotFrame[slot] = frame;
+        slotW[slot] = f.w;
+        slotH[slot] = f.h;
+    }
+    return r;
+}
+
+static void Print(const char* name, const Replay& r) {
+    if (r.frames == 0) return;
+    std::printf("%-18s %5.0f frames: %7.3f of %7.3f MB per frame copied (%5.1f%% saved), %3u full copies, %6.2f us merging per frame\n",
+        name, r.frames, r.copiedBytes / r.frames / 1e6, r.fullBytes / r.frames / 1e6,
+        100.0 * (1.0 - r.copiedBytes / r.fullBytes), r.fullCopies, r.mergeNs / r.frames / 1e3);
+}
+
+// ---------- Recorded-style streams ----------
+
+static RecordedFrame Frame(std::vector<DirtyRect> rects) {
+    RecordedFrame f;
+    f.w = kW; f.h = kH;
+    f.rects = std::move(rects);
+    return f;
+}
+
+// A clock ticking in the taskbar and a blinking caret
+static std::vector<RecordedFrame> Clock() {
+    std::vector<RecordedFrame> s;
+    for (int i = 0; i < kFrames; i++) {
+        std::vector<DirtyRect> r = { { 2470, 1408, 2540, 1432 } };
+        if (i & 1) r.push_back({ 612, 388, 614, 408 });
+        s.push_back(Frame(r));
+    }
+    return s;
+}
+
+// Typing in an editor: the caret, the line being edited and the line-number gutter
+static std::vector<RecordedFrame> Typing() {
+    std::vector<RecordedFrame> s;
+    for (int i = 0; i < kFrames; i++) {
+        const int32_t line = 200 + (i / 80) * 22, col = 260 + (i % 80) * 9;
+        s.push_back(Frame({ { 260, line, col + 9, line + 22 }, { col + 9, line, col + 11, line + 22 }, { 200, line, 250, line + 22 } }));
+    }
+    return s;
+}
+
+// Scrolling a 1200x1000 window by 40 px per frame: the content moves (a move rect, reported at
+// its destination), a strip is newly drawn and the scroll bar changes
+static std::vector<RecordedFrame> Scrolling() {
+    std::vector<RecordedFrame> s;
+    for (int i = 0; i < kFrames; i++)
+        s.push_back(Frame({ { 400, 200, 1580, 1160 }, { 400, 1160, 1580, 1200 }, { 1580, 200, 1600, 1200 } }));
+    return s;
+}
+
+// A 1280x720 video with its progress bar
+static std::vector<RecordedFrame> Video() {
+    std::vector<RecordedFrame> s;
+    for (int i = 0; i < kFrames; i++)
+        s.push_back(Frame({ { 640, 360, 1920, 1080 }, { 640, 1090, 1920, 1096 } }));
+    return s;
+}
+
+// Dragging an 800x600 window 12 px to the right per frame: it moves, and what it uncovers is redrawn
+static std::vector<RecordedFrame> Dragging() {
+    std::vector<RecordedFrame> s;
+    for (int i = 0; i < kFrames; i++) {
+        const int32_t x = 100 + (i * 12) % 1600;
+        s.push_back(Frame({ { x + 12, 300, x + 812, 900 }, { x, 300, x + 12, 900 } }));
+    }
+    return s;
+}
+
+// Busy desktop: many small scattered updates, and every 50th frame without usable metadata
+static std::vector<RecordedFrame> Busy() {
+    std::vector<RecordedFrame> s;
+    uint32_t seed = 1;
+    for (int i = 0; i < kFrames; i++) {
+        RecordedFrame f = Frame({});
+        f.full = i % 50 == 49;
+        const int n = 4 + (int)(seed % 24);
+        for (int k = 0; k < n && !f.full; k++) {
+            seed = seed * 1664525u + 1013904223u;
+            const int32_t x = (int32_t)(seed % (kW - 64)), y = (int32_t)((seed >> 12) % (kH - 32));
+            f.rects.push_back({ x, y, x + 16 + (int32_t)(seed % 48), y + 8 + (int32_t)((seed >> 8) % 24) });
+        }
+        s.push_back(f);
+    }
+    return s;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            std::FILE* f = std::fopen(argv[i], "r");
+            std::vector<RecordedFrame> stream;
+            const bool read = f && ReadRecordedFrames(f, stream);
+            if (f) std::fclose(f);
+            CHECK(read);
+            if (read) Print(argv[i], Run(stream));
+        }
+        return ve_test_result("dirty_rects_bench");
+    }
+
+    const Replay clock = Run(Clock()), typing = Run(Typing()), scrolling = Run(Scrolling());
+    const Replay video = Run(Video()), dragging = Run(Dragging()), busy = Run(Busy());
+    Print("clock and caret", clock);
+    Print("typing", typing);
+    Print("scrolling", scrolling);
+    Print("video", video);
+    Print("window drag", dragging);
+    Print("busy", busy);
+
+    // Small updates copy next to nothing; the first kSlots frames of every stream are full copies
+    CHECK(clock.copiedBytes < clock.fullBytes * 0.01);
+    CHECK(typing.copiedBytes < typing.fullBytes * 0.02);
+    CHECK_EQ(clock.fullCopies, kSlots);
+    // A quarter-screen video: each slot catches up on kSlots frames of the same region
+    CHECK(video.copiedBytes < video.fullBytes * 0.3);
+    // Large or scattered changes: never more than copying everything
+    for (const Replay* r : { &scrolling, &dragging, &busy })
+        CHECK(r->copiedBytes <= r->fullBytes);
+    return ve_test_result("dirty_rects_bench");
+}
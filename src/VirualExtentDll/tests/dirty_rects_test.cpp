@@ -0,0 +1,206 @@
+#include "dirty_rects.h"
+#include "check.h"
+
+#include <cstdio>
+#include <vector>
+
+// MergeDirtyRects and DirtyRectHistory on a 1920x1080 output: clipping, merging of overlapping,
+// touching and nearly touching rects, the fall back to one full-frame copy, and which frames a
+// ring slot can still be patched from.
+
+static const uint32_t kW = 1920, kH = 1080;
+
+static bool Same(const DirtyRect& r, int32_t l, int32_t t, int32_t rt, int32_t b) {
+    return r.left == l && r.top == t && r.right == rt && r.bottom == b;
+}
+
+static bool IsFull(const std::vector<DirtyRect>& rects) {
+    return rects.size() == 1 && Same(rects[0], 0, 0, (int32_t)kW, (int32_t)kH);
+}
+
+static void Clipping() {
+    std::vector<DirtyRect> rects = {
+        { -10, -10, 20, 20 },          // sticks out top left
+        { 1900, 1070, 2000, 1200 },    // sticks out bottom right
+        { 2000, 0, 2100, 10 },         // entirely outside
+        { 5, 5, 5, 10 },               // empty
+        { 30, 30, 20, 40 },            // inverted
+    };
+    MergeDirtyRects(rects, kW, kH, 0);
+    CHECK_EQ(rects.size(), 2);
+    if (rects.size() == 2) {
+        CHECK(Same(rects[0], 0, 0, 20, 20));
+        CHECK(Same(rects[1], 1900, 1070, 1920, 1080));
+    }
+    CHECK_EQ(DirtyRectsArea(rects), 20 * 20 + 20 * 10);
+
+    // Nothing left at all
+    rects = { { -50, -50, 0, 0 }, { 0, 1080, 10, 1100 } };
+    MergeDirtyRects(rects, kW, kH);
+    CHECK(rects.empty());
+}
+
+static void Merging() {
+    // Overlapping: always merged, so no pixel is copied twice
+    std::vector<DirtyRect> rects = { { 0, 0, 100, 100 }, { 50, 50, 150, 150 } };
+    MergeDirtyRects(rects, kW, kH, 0);
+    CHECK(rects.size() == 1 && Same(rects[0], 0, 0, 150, 150));
+
+    // Touching edges: the bounding box wastes nothing
+    rects = { { 0, 0, 100, 100 }, { 100, 0, 200, 100 } };
+    MergeDirtyRects(rects, kW, kH, 0);
+    CHECK(rects.size() == 1 && Same(rects[0], 0, 0, 200, 100));
+
+    // A 10 px gap wastes 100 px: merged with 100 px of slack, not with 99
+    rects = { { 0, 0, 10, 10 }, { 20, 0, 30, 10 } };
+    MergeDirtyRects(rects, kW, kH, 99);
+    CHECK_EQ(rects.size(), 2);
+    rects = { { 0, 0, 10, 10 }, { 20, 0, 30, 10 } };
+    MergeDirtyRects(rects, kW, kH, 100);
+    CHECK(rects.size() == 1 && Same(rects[0], 0, 0, 30, 10));
+
+    // Merges cascade: the box of the first two overlaps the third
+    rects = { { 0, 0, 10, 10 }, { 5, 5, 20, 20 }, { 15, 0, 40, 5 }, { 1000, 1000, 1010, 1010 } };
+    MergeDirtyRects(rects, kW, kH, 0);
+    CHECK_EQ(rects.size(), 2);
+    if (rects.size() == 2)
+        CHECK(Same(rects[0], 0, 0, 40, 20) && Same(rects[1], 1000, 1000, 1010, 1010));
+
+    // Far apart: left alone
+    rects = { { 0, 0, 10, 10 }, { 500, 500, 510, 510 } };
+    MergeDirtyRects(rects, kW, kH);
+    CHECK_EQ(rects.size(), 2);
+}
+
+static std::vector<DirtyRect> Scattered(int n) {
+    // 8x8 rects 100 px apart: they only merge with slack
+    std::vector<DirtyRect> rects;
+    for (int i = 0; i < n; i++) {
+        const int32_t x = (i % 16) * 100, y = (i / 16) * 100;
+        rects.push_back({ x, y, x + 8, y + 8 });
+    }
+    return rects;
+}
+
+static void FullFrame() {
+    // More rects than maxRects after merging: one full copy
+    std::vector<DirtyRect> rects = Scattered(5);
+    MergeDirtyRects(rects, kW, kH, 0, 5);
+    CHECK_EQ(rects.size(), 5);
+    rects = Scattered(6);
+    MergeDirtyRects(rects, kW, kH, 0, 5);
+    CHECK(IsFull(rects));
+
+    // Far more than maxRects to begin with: not even merged
+    rects = Scattered(2 * 8 + 1);
+    MergeDirtyRects(rects, kW, kH, 0, 2);
+    CHECK(IsFull(rects));
+
+    // Covering more than fullFrameRatio: one full copy. 70% of the frame, then 50%
+    rects = { { 0, 0, 1344, 1080 } };
+    MergeDirtyRects(rects, kW, kH);
+    CHECK(IsFull(rects));
+    rects = { { 0, 0, 960, 1080 } };
+    MergeDirtyRects(rects, kW, kH);
+    CHECK(rects.size() == 1 && Same(rects[0], 0, 0, 960, 1080));
+    MergeDirtyRects(rects, kW, kH, 4096, 32, 0.4f);
+    CHECK(IsFull(rects));
+}
+
+// Frame f changes an 8x8 block of its own, too far from the others to merge with them
+static std::vector<DirtyRect> FrameRects(uint64_t f) {
+    const int32_t x = (int32_t)(f % 16) * 100, y = (int32_t)(f % 10) * 100;
+    return { { x, y, x + 8, y + 8 } };
+}
+
+static void History() {
+    DirtyRectHistory h;
+    h.Reset(kW, kH);
+    std::vector<DirtyRect> out;
+    CHECK(!h.CollectSince(0, out));
+    CHECK(!h.CollectSince(1, out));   // nothing pushed yet
+
+    for (uint64_t f = 1; f <= 20; f++)
+        h.Push(f, FrameRects(f));
+    CHECK_EQ(h.Latest(), 20);
+
+    // Up to date: nothing to copy
+    CHECK(h.CollectSince(20, out));
+    CHECK(out.empty());
+    // One frame behind: the latest frame's rect
+    CHECK(h.CollectSince(19, out));
+    CHECK(out.size() == 1 && Same(out[0], 400, 0, 408, 8));
+    // As far back as the history reaches: the union of kDepth - 1 frames
+    CHECK(h.CollectSince(20 - (DirtyRectHistory::kDepth - 1), out));
+    CHECK_EQ(out.size(), DirtyRectHistory::kDepth - 1);
+    CHECK_EQ(DirtyRectsArea(out), 64 * (DirtyRectHistory::kDepth - 1));
+    // One further: no longer known, the caller copies the whole frame
+    CHECK(!h.CollectSince(20 - DirtyRectHistory::kDepth, out));
+    CHECK(out.empty());
+    CHECK(!h.CollectSince(3, out));
+    // Never seen (0 = slot never written) and from the future
+    CHECK(!h.CollectSince(0, out));
+    CHECK(!h.CollectSince(21, out));
+
+    // The same region changing in several frames is copied once
+    h.Push(21, { { 0, 0, 100, 100 } });
+    h.Push(22, { { 50, 50, 150, 150 } });
+    CHECK(h.CollectSince(20, out));
+    CHECK(out.size() == 1 && Same(out[0], 0, 0, 150, 150));
+
+    // The output changed size: nothing from before the reset can be patched
+    h.Reset(kW, kH);
+    CHECK_EQ(h.Latest(), 0);
+    CHECK(!h.CollectSince(22, out));
+    // Frame ids carry on after a reset; only frames pushed since are known
+    h.Push(23, FrameRects(23));
+    CHECK(h.CollectSince(22, out));
+    CHECK_EQ(out.size(), 1);
+    CHECK(!h.CollectSince(21, out));
+}
+
+static void Streams() {
+    std::FILE* f = std::tmpfile();
+    CHECK(f != nullptr);
+    if (!f) return;
+    RecordedFrame a;
+    a.w = kW; a.h = kH;
+    a.rects = { { 1, 2, 3, 4 }, { -5, 6, 2000, 1100 } };
+    RecordedFrame b;
+    b.w = 2560; b.h = 1440; b.full = true;
+    RecordedFrame c;
+    c.w = kW; c.h = kH;   // metadata, but nothing changed
+    WriteRecordedFrame(f, a);
+    WriteRecordedFrame(f, b);
+    WriteRecordedFrame(f, c);
+    std::rewind(f);
+
+    std::vector<RecordedFrame> read;
+    CHECK(ReadRecordedFrames(f, read));
+    CHECK_EQ(read.size(), 3);
+    if (read.size() == 3) {
+        CHECK(read[0].w == kW && read[0].h == kH && !read[0].full && read[0].rects.size() == 2);
+        if (read[0].rects.size() == 2)
+            CHECK(Same(read[0].rects[1], -5, 6, 2000, 1100));
+        CHECK(read[1].w == 2560 && read[1].full && read[1].rects.empty());
+        CHECK(!read[2].full && read[2].rects.empty());
+    }
+    std::fclose(f);
+
+    // A truncated line is an error
+    f = std::tmpfile();
+    if (!f) return;
+    std::fputs("1920 1080 2 0 0 10 10 5 5\n", f);
+    std::rewind(f);
+    CHECK(!ReadRecordedFrames(f, read));
+    std::fclose(f);
+}
+
+int main() {
+    Clipping();
+    Merging();
+    FullFrame();
+    History();
+    Streams();
+    return ve_test_result("dirty_rects_test");
+}
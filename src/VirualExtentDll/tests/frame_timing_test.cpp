@@ -0,0 +1,98 @@
+#include "frame_timing.h"
+#include "check.h"
+
+#include <atomic>
+#include <thread>
+
+static FrameTimer::Scratch scratch;
+
+// Every phase of frame f gets a value derived from f, so a record mixing two frames is detectable
+static uint32_t PhaseValue(uint64_t frame, int phase) {
+    return (uint32_t)(frame * 16 + phase + 1);
+}
+
+static void CommitFrame(FrameTimer& t, uint64_t frame, int64_t period) {
+    for (int p = 0; p < FP_Count; p++)
+        t.Add((FramePhase)p, PhaseValue(frame, p));
+    t.Commit((int64_t)(frame + 1) * period, period);
+}
+
+static void Percentiles() {
+    static FrameTimer t;
+    t.SetEnabled(true);
+
+    // 100 frames whose xrWaitFrame took 1..100 us, then one display period skipped
+    for (uint32_t i = 1; i <= 100; i++) {
+        t.Add(FP_WaitFrame, i * 1000);
+        t.Commit((int64_t)i * 1000000, 1000000);
+    }
+    t.Add(FP_WaitFrame, 1000);
+    t.Commit(102 * 1000000, 1000000);
+
+    FramePhaseSummary s[FrameTimer::kSummaryCount];
+    uint64_t missed = 0;
+    CHECK_EQ(t.Summarize(s, &missed, scratch), 101);
+    CHECK_EQ(missed, 1);
+    CHECK_EQ(s[FP_WaitFrame].p50, 50000);
+    CHECK_EQ(s[FP_WaitFrame].p99, 99000);
+    CHECK_EQ(s[FP_EndFrame].p99, 0);
+
+    char buf[2048];
+    CHECK(t.Format(buf, sizeof(buf), scratch) > 0);
+}
+
+static void Wraps() {
+    static FrameTimer t;
+    t.SetEnabled(true);
+    for (uint64_t f = 0; f < FrameTimer::kCapacity * 3 + 5; f++)
+        CommitFrame(t, f, 1000);
+
+    static FrameRecord out[FrameTimer::kCapacity];
+    const uint32_t n = t.Snapshot(out, FrameTimer::kCapacity);
+    CHECK_EQ(n, FrameTimer::kCapacity);        // nothing is being written: the whole ring
+    CHECK_EQ(out[n - 1].frameIndex, FrameTimer::kCapacity * 3 + 4);
+    CHECK_EQ(out[0].frameIndex, FrameTimer::kCapacity * 2 + 5);
+    CHECK_EQ(t.Snapshot(out, 10), 10);
+    CHECK_EQ(out[9].frameIndex, FrameTimer::kCapacity * 3 + 4);
+}
+
+// The render thread commits as fast as it can while another thread snapshots: no record may be
+// torn, and what comes back is in frame order.
+static void ConcurrentSnapshot() {
+    static FrameTimer t;
+    t.SetEnabled(true);
+    std::atomic<bool> done = false;
+    const uint64_t kFrames = 100000;
+
+    std::thread writer([&] {
+        for (uint64_t f = 0; f < kFrames; f++)
+            CommitFrame(t, f, 1000);
+        done = true;
+    });
+
+    static FrameRecord out[FrameTimer::kCapacity];
+    uint64_t snapshots = 0, records = 0, torn = 0, unordered = 0;
+    while (!done) {
+        const uint32_t n = t.Snapshot(out, FrameTimer::kCapacity);
+        for (uint32_t i = 0; i < n; i++) {
+            for (int p = 0; p < FP_Count; p++)
+                if (out[i].phaseNs[p] != PhaseValue(out[i].frameIndex, p)) { torn++; break; }
+            if (i > 0 && out[i].frameIndex <= out[i - 1].frameIndex) unordered++;
+        }
+        records += n;
+        snapshots++;
+    }
+    writer.join();
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(unordered, 0);
+    CHECK_EQ(t.FrameCount(), kFrames);
+    std::printf("concurrent: %llu snapshots, %llu records\n", (unsigned long long)snapshots, (unsigned long long)records);
+}
+
+int main() {
+    Percentiles();
+    Wraps();
+    ConcurrentSnapshot();
+    return ve_test_result("frame_timing_test");
+}
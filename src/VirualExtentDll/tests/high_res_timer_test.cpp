@@ -0,0 +1,43 @@
+#include "high_res_timer.h"
+#include "frame_timing.h"   // FrameTimer::Now
+#include "check.h"
+
+#include <thread>
+
+static void Deadline() {
+    HighResTimer t;
+    const uint64_t start = FrameTimer::Now();
+    CHECK(!t.WaitUntil(start + 2000000));
+    const uint64_t slept = FrameTimer::Now() - start;
+    CHECK(slept >= 2000000);
+    CHECK(slept < 50000000);   // generous: shared CI machines
+    CHECK(!t.WaitUntil(start)); // already due: returns at once
+}
+
+static void WakeIsSticky() {
+    HighResTimer t;
+    t.Wake();                   // nobody waiting yet
+    const uint64_t start = FrameTimer::Now();
+    CHECK(t.WaitUntil(start + 1000000000));
+    CHECK(FrameTimer::Now() - start < 500000000);
+    CHECK(!t.WaitUntil(FrameTimer::Now() + 1000000));   // consumed by the first wait
+}
+
+static void WakeFromOtherThread() {
+    HighResTimer t;
+    std::thread waker([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        t.Wake();
+    });
+    const uint64_t start = FrameTimer::Now();
+    t.Wait();
+    CHECK(FrameTimer::Now() - start >= 4000000);
+    waker.join();
+}
+
+int main() {
+    Deadline();
+    WakeIsSticky();
+    WakeFromOtherThread();
+    return ve_test_result("high_res_timer_test");
+}
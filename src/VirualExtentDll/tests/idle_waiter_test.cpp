@@ -0,0 +1,100 @@
+#include "idle_waiter.h"
+#include "frame_timing.h"
+#include "check.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// The idle main loop against a stand-in event source: a thread that changes the session state at
+// times of its own, seen only by polling (as with xrPollEvent). Measures how long a change waits
+// before the loop sees it, and how often the loop wakes while nothing happens.
+
+struct StandInEvents {
+    std::atomic<uint64_t> changedNs = 0;   // FrameTimer::Now() of the last state change
+    std::atomic<uint32_t> changes = 0;
+
+    // xrPollEvent: the change time if there is a new event
+    bool Poll(uint32_t* seen, uint64_t* whenNs) {
+        const uint32_t n = changes.load(std::memory_order_acquire);
+        if (n == *seen) return false;
+        *seen = n;
+        *whenNs = changedNs.load(std::memory_order_relaxed);
+        return true;
+    }
+};
+
+static void StateChangeLatency() {
+    static IdleWaiter waiter;
+    StandInEvents events;
+    const uint32_t kChanges = 40;
+
+    std::thread source([&] {
+        for (uint32_t i = 0; i < kChanges; i++) {
+            // Off the poll grid, so latencies spread over the whole interval
+            std::this_thread::sleep_for(std::chrono::microseconds(5000 + 731 * (i % 7)));
+            events.changedNs.store(FrameTimer::Now(), std::memory_order_relaxed);
+            events.changes.fetch_add(1, std::memory_order_release);
+        }
+    });
+
+    std::vector<uint64_t> latencies;
+    uint32_t seen = 0;
+    const uint64_t start = FrameTimer::Now();
+    while (latencies.size() < kChanges) {
+        uint64_t when;
+        if (events.Poll(&seen, &when))
+            latencies.push_back(FrameTimer::Now() - when);
+        else
+            waiter.Wait();
+    }
+    const uint64_t elapsed = FrameTimer::Now() - start;
+    source.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    const uint64_t p50 = latencies[latencies.size() / 2], pmax = latencies.back();
+    const double   wakeupsPerSec = waiter.Wakeups() / (elapsed * 1e-9);
+    std::printf("state change latency p50 %.3f ms, max %.3f ms; %.0f wakeups/s while idle\n",
+        p50 * 1e-6, pmax * 1e-6, wakeupsPerSec);
+
+    // About one poll interval at most; the bound leaves room for a loaded machine
+    CHECK(p50 <= 2 * IdleWaiter::kPollNs);
+    CHECK(pmax <= 20 * IdleWaiter::kPollNs);
+    // One wakeup per interval, not a spin
+    CHECK(waiter.Wakeups() <= elapsed / IdleWaiter::kPollNs + 2);
+    CHECK_EQ(waiter.Notified(), 0);
+}
+
+static void NotifyEndsTheWait() {
+    static IdleWaiter waiter;
+
+    // Before the wait: the next one returns at once
+    waiter.Notify();
+    uint64_t t0 = FrameTimer::Now();
+    waiter.Wait();
+    CHECK(FrameTimer::Now() - t0 < IdleWaiter::kPollNs);
+    CHECK_EQ(waiter.Notified(), 1);
+
+    // During it, from another thread (shutdown)
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> notifiedAt = 0;
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        notifiedAt = FrameTimer::Now();
+        stop = true;
+        waiter.Notify();
+    });
+    while (!stop.load())
+        waiter.Wait();
+    const uint64_t seenAt = FrameTimer::Now();
+    stopper.join();
+    CHECK(seenAt - notifiedAt.load() <= 20 * IdleWaiter::kPollNs);
+}
+
+int main() {
+    StateChangeLatency();
+    NotifyEndsTheWait();
+    return ve_test_result("idle_waiter_test");
+}
@@ -0,0 +1,101 @@
+#include "input_injection.h"
+#include "check.h"
+
+#include <thread>
+
+// InputInjector against RecordingSink: a tick's events reach the sink as one batch in queue
+// order however many there are, and threads with injectors of their own can share a sink.
+
+static void Ordering() {
+    RecordingSink sink;
+    InputInjector in(&sink);
+    CHECK_EQ(in.Flush(), 0);   // nothing queued: no batch
+    CHECK(sink.Batches().empty());
+
+    in.MouseMoveTo(100, 200);
+    in.MouseButton(false, true);
+    in.Key(0x1e, false, true);
+    in.MouseWheel(-120);
+    in.Key(0x48, true, false);
+    in.MouseButton(true, false);
+    CHECK_EQ(in.Pending(), 6);
+    CHECK_EQ(in.Flush(), 6);
+    CHECK_EQ(in.Pending(), 0);
+
+    const auto batches = sink.Batches();
+    CHECK_EQ(batches.size(), 1);
+    if (batches.size() == 1 && batches[0].size() == 6) {
+        const auto& b = batches[0];
+        CHECK(b[0].kind == InjectedEvent::MouseMove && b[0].x == 100 && b[0].y == 200);
+        CHECK(b[1].kind == InjectedEvent::MouseButton && !b[1].right && b[1].down);
+        CHECK(b[2].kind == InjectedEvent::Key && b[2].scan == 0x1e && !b[2].extended && b[2].down);
+        CHECK(b[3].kind == InjectedEvent::MouseWheel && b[3].wheel == -120);
+        CHECK(b[4].kind == InjectedEvent::Key && b[4].scan == 0x48 && b[4].extended && !b[4].down);
+        CHECK(b[5].kind == InjectedEvent::MouseButton && b[5].right && !b[5].down);
+    }
+}
+
+// More than kReserve events in one tick: still a single batch, in order
+static void LargeTick() {
+    RecordingSink sink;
+    InputInjector in(&sink);
+    const uint32_t count = InputInjector::kReserve * 2 + 22;
+    for (uint32_t i = 0; i < count; i++)
+        in.MouseMoveTo((int32_t)i, 0);
+    CHECK_EQ(in.Flush(), count);
+
+    const auto batches = sink.Batches();
+    CHECK_EQ(batches.size(), 1);
+    bool ordered = batches.size() == 1 && batches[0].size() == count;
+    for (uint32_t i = 0; ordered && i < count; i++)
+        ordered = batches[0][i].x == (int32_t)i;
+    CHECK(ordered);
+
+    const InputInjector::Stats s = in.GetStats();
+    CHECK_EQ(s.events, count);
+    CHECK_EQ(s.batches, 1);
+    CHECK_EQ(s.largest, count);
+}
+
+// The input thread and the render thread, each with its own injector on one sink
+static void Threads() {
+    RecordingSink sink;
+    const InputInjector::Stats before = InputInjector::TotalStats();
+    const uint32_t ticks = 2000;
+    auto producer = [&sink](int32_t id) {
+        InputInjector in(&sink);
+        for (uint32_t t = 0; t < ticks; t++) {
+            in.MouseMoveTo(id, (int32_t)t);
+            in.MouseButton(false, true);
+            in.MouseButton(false, false);
+            in.Flush();
+        }
+    };
+    std::thread a(producer, 1), b(producer, 2);
+    a.join();
+    b.join();
+
+    const auto batches = sink.Batches();
+    CHECK_EQ(batches.size(), 2 * ticks);
+    // Every batch is one whole tick of one thread, and each thread's ticks arrive in order
+    int32_t next[3] = { 0, 0, 0 };
+    bool intact = true;
+    for (const auto& batch : batches) {
+        intact &= batch.size() == 3 && batch[0].kind == InjectedEvent::MouseMove &&
+            (batch[0].x == 1 || batch[0].x == 2) && batch[1].down && !batch[2].down;
+        if (!intact) break;
+        intact &= batch[0].y == next[batch[0].x]++;
+    }
+    CHECK(intact);
+
+    const InputInjector::Stats after = InputInjector::TotalStats();
+    CHECK_EQ(after.events - before.events, 2 * ticks * 3);
+    CHECK_EQ(after.batches - before.batches, 2 * ticks);
+}
+
+int main() {
+    Ordering();
+    LargeTick();
+    Threads();
+    return ve_test_result("input_injection_test");
+}
@@ -0,0 +1,112 @@
+#include "interaction.h"
+#include "check.h"
+
+#include <cmath>
+
+// interaction_update with scripted poses against a 2 m x 1.125 m plane 2 m ahead showing a
+// 1920x1080 output: one update per frame yields the rays, hits and screen points that drawing
+// and injection both read.
+
+static bool Near(float a, float b) { return std::fabs(a - b) < 1e-4f; }
+
+static InteractionPlane Plane() {
+    InteractionPlane p;
+    p.placed = true;
+    p.center[2] = -2.0f;
+    p.right[0] = 2.0f;
+    p.up[1] = 1.125f;
+    p.screenWidth = 1920;
+    p.screenHeight = 1080;
+    return p;
+}
+
+// A hand at (x, y, z) tilted up by the ray tilt, so its pointer runs straight down -Z
+static InteractionHand Hand(float x, float y, float z) {
+    InteractionHand h;
+    h.valid = true;
+    h.position[0] = x; h.position[1] = y; h.position[2] = z;
+    const float half = -InteractionFrame::kRayTiltDeg * 3.14159265f / 180.0f / 2;
+    h.orientation[0] = std::sin(half);
+    h.orientation[3] = std::cos(half);
+    return h;
+}
+
+static void Hits() {
+    InteractionFrame f;
+    InteractionHand hands[2] = { InteractionHand(), Hand(0, 0, 0) };
+    interaction_update(Plane(), hands, &f);
+    CHECK_EQ(f.frame, 1);
+    CHECK(!f.hands[0].active);
+    const InteractionRay& r = f.hands[1];
+    CHECK(r.active && r.hit && r.onScreen);
+    CHECK(Near(r.direction[2], -1.0f));
+    CHECK(Near(r.length, 2.0f));
+    CHECK(Near(r.hitPosition[2], -2.0f));
+    CHECK(Near(r.uv[0], 0.5f) && Near(r.uv[1], 0.5f));
+    CHECK_EQ(r.screenX, 960);
+    CHECK_EQ(r.screenY, 540);
+    CHECK_EQ(f.cursorHand, 1);
+
+    // Half a metre right and 0.28 m up: a quarter of the width, a quarter of the height;
+    // U is mirrored like the shader samples it
+    hands[1] = Hand(0.5f, 0.28125f, 0);
+    interaction_update(Plane(), hands, &f);
+    CHECK_EQ(f.frame, 2);
+    CHECK(f.hands[1].hit);
+    CHECK(Near(f.hands[1].uv[0], 0.25f) && Near(f.hands[1].uv[1], 0.25f));
+    CHECK_EQ(f.hands[1].screenX, 1440);
+    CHECK_EQ(f.hands[1].screenY, 270);
+
+    // The output's virtual-desktop offset carries through
+    InteractionPlane offset = Plane();
+    offset.screenLeft = -1920;
+    offset.screenTop = 100;
+    interaction_update(offset, hands, &f);
+    CHECK_EQ(f.hands[1].screenX, -480);
+    CHECK_EQ(f.hands[1].screenY, 370);
+}
+
+static void Misses() {
+    InteractionFrame f;
+    InteractionHand hands[2] = { Hand(0, -1, 0), Hand(0, 0, -3) };
+    interaction_update(Plane(), hands, &f);
+    // Below the plane, and behind it pointing away: tracked rays of the default length
+    for (int h = 0; h < 2; h++) {
+        CHECK(f.hands[h].active);
+        CHECK(!f.hands[h].hit && !f.hands[h].onScreen);
+        CHECK(Near(f.hands[h].length, InteractionFrame::kRayDefaultLength));
+    }
+    CHECK_EQ(f.cursorHand, -1);
+
+    // Not placed yet
+    hands[1] = Hand(0, 0, 0);
+    InteractionPlane unplaced = Plane();
+    unplaced.placed = false;
+    interaction_update(unplaced, hands, &f);
+    CHECK(f.hands[1].active && !f.hands[1].hit);
+
+    // No capture yet: the plane is hit but there is no screen point
+    InteractionPlane noCapture = Plane();
+    noCapture.screenWidth = noCapture.screenHeight = 0;
+    interaction_update(noCapture, hands, &f);
+    CHECK(f.hands[1].hit && !f.hands[1].onScreen);
+    CHECK_EQ(f.cursorHand, -1);
+}
+
+static void CursorHand() {
+    InteractionFrame f;
+    InteractionHand hands[2] = { Hand(-0.5f, 0, 0), Hand(0.5f, 0, 0) };
+    interaction_update(Plane(), hands, &f);
+    CHECK_EQ(f.cursorHand, 1);   // right preferred
+    hands[1].valid = false;
+    interaction_update(Plane(), hands, &f);
+    CHECK_EQ(f.cursorHand, 0);
+    CHECK_EQ(f.hands[0].screenX, 480);
+}
+
+int main() {
+    Hits();
+    Misses();
+    CursorHand();
+    return ve_test_result("interaction_test");
+}
@@ -0,0 +1,273 @@
+// Drives the headless runtime (mock_openxr.cpp, built with VE_MOCK_OPENXR) through a whole
+// session the way OpenXR.cpp does: state changes, frames, swapchains, scripted input and a
+// scripted exit. Runs a session without a graphics binding, whose swapchain images are CPU
+// memory, on every platform, then times an unthrottled one. On Windows the same script also
+// runs with a D3D11 binding on a WARP device.
+#include "mock_openxr.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "dxgi.lib")
+#endif
+
+static const uint32_t kSize = 64;
+
+static XrSessionState PollState(XrInstance instance, std::vector<XrSessionState>& seen) {
+    XrEventDataBuffer event = { XR_TYPE_EVENT_DATA_BUFFER };
+    while (xrPollEvent(instance, &event) == XR_SUCCESS) {
+        if (event.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED)
+            seen.push_back(((XrEventDataSessionStateChanged*)&event)->state);
+        event = { XR_TYPE_EVENT_DATA_BUFFER };
+    }
+    return seen.empty() ? XR_SESSION_STATE_UNKNOWN : seen.back();
+}
+
+struct SessionRun {
+    std::vector<XrSessionState> states;
+    uint32_t rendered = 0, hidden = 0;
+    bool     exiting = false;
+    bool     pixels_kept = true;   // headless: every image still held what was written into it
+    float    right_trigger = 0;
+    XrTime   trigger_changed = 0;
+    mock_xr_stats_t stats = {};
+};
+
+// The scripted session from creation to EXITING. binding is the graphics binding chained to the
+// session create info, nullptr for a headless session; those write the frame number into every
+// pixel of the image they acquire, after checking it still holds the number written into it
+// swapchain_length frames ago.
+static SessionRun RunSession(const void* binding) {
+    SessionRun run;
+    XrInstanceCreateInfo instance_info = { XR_TYPE_INSTANCE_CREATE_INFO };
+    XrInstance instance = XR_NULL_HANDLE;
+    CHECK(xrCreateInstance(&instance_info, &instance) == XR_SUCCESS);
+
+    XrSessionCreateInfo session_info = { XR_TYPE_SESSION_CREATE_INFO };
+    session_info.next = binding;
+    session_info.systemId = 1;
+    XrSession session = XR_NULL_HANDLE;
+    CHECK(xrCreateSession(instance, &session_info, &session) == XR_SUCCESS);
+
+    // One float action on both hands, bound to the triggers
+    XrPath hands[2], triggers[2];
+    xrStringToPath(instance, "/user/hand/left", &hands[0]);
+    xrStringToPath(instance, "/user/hand/right", &hands[1]);
+    xrStringToPath(instance, "/user/hand/left/input/trigger/value", &triggers[0]);
+    xrStringToPath(instance, "/user/hand/right/input/trigger/value", &triggers[1]);
+    XrActionSetCreateInfo set_info = { XR_TYPE_ACTION_SET_CREATE_INFO };
+    XrActionSet action_set = XR_NULL_HANDLE;
+    xrCreateActionSet(instance, &set_info, &action_set);
+    XrActionCreateInfo action_info = { XR_TYPE_ACTION_CREATE_INFO };
+    action_info.actionType = XR_ACTION_TYPE_FLOAT_INPUT;
+    action_info.countSubactionPaths = 2;
+    action_info.subactionPaths = hands;
+    XrAction trigger = XR_NULL_HANDLE;
+    xrCreateAction(action_set, &action_info, &trigger);
+    XrActionSuggestedBinding bindings[2] = { { trigger, triggers[0] }, { trigger, triggers[1] } };
+    XrInteractionProfileSuggestedBinding suggested = { XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING };
+    suggested.countSuggestedBindings = 2;
+    suggested.suggestedBindings = bindings;
+    xrSuggestInteractionProfileBindings(instance, &suggested);
+
+    XrSwapchainCreateInfo sc_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
+    sc_info.format = 29;   // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+    sc_info.width = sc_info.height = kSize;
+    sc_info.arraySize = sc_info.mipCount = sc_info.faceCount = sc_info.sampleCount = 1;
+    sc_info.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+    XrSwapchain swapchain = XR_NULL_HANDLE;
+    CHECK(xrCreateSwapchain(session, &sc_info, &swapchain) == XR_SUCCESS);
+
+    uint32_t image_count = 0;
+    CHECK(xrEnumerateSwapchainImages(swapchain, 0, &image_count, nullptr) == XR_SUCCESS);
+    std::vector<mock_xr_image_cpu_t> images(image_count, { XR_TYPE_SWAPCHAIN_IMAGE_MOCK_CPU });
+    std::vector<uint8_t> written(image_count, 0);
+    if (!binding) {
+        CHECK(xrEnumerateSwapchainImages(swapchain, image_count, &image_count, (XrSwapchainImageBaseHeader*)images.data()) == XR_SUCCESS);
+        for (const mock_xr_image_cpu_t& image : images)
+            CHECK(image.pixels && image.row_pitch == kSize * 4 && image.slice_pitch == kSize * kSize * 4);
+    }
+
+    bool running = false;
+    uint32_t loops = 0;
+    XrTime last_display = 0;
+    while (!run.exiting && loops++ < 100000) {
+        const size_t before = run.states.size();
+        PollState(instance, run.states);
+        for (size_t i = before; i < run.states.size(); i++) {
+            if (run.states[i] == XR_SESSION_STATE_READY) {
+                XrSessionBeginInfo begin = { XR_TYPE_SESSION_BEGIN_INFO };
+                CHECK(xrBeginSession(session, &begin) == XR_SUCCESS);
+                running = true;
+            }
+            if (run.states[i] == XR_SESSION_STATE_STOPPING) {
+                CHECK(xrEndSession(session) == XR_SUCCESS);
+                running = false;
+            }
+            if (run.states[i] == XR_SESSION_STATE_EXITING) run.exiting = true;
+        }
+        if (!running) continue;
+
+        XrFrameState frame = { XR_TYPE_FRAME_STATE };
+        CHECK(xrWaitFrame(session, nullptr, &frame) == XR_SUCCESS);
+        CHECK(frame.predictedDisplayTime > last_display);
+        last_display = frame.predictedDisplayTime;
+        xrBeginFrame(session, nullptr);
+
+        XrActionsSyncInfo sync = { XR_TYPE_ACTIONS_SYNC_INFO };
+        if (xrSyncActions(session, &sync) == XR_SUCCESS) {
+            XrActionStateGetInfo get = { XR_TYPE_ACTION_STATE_GET_INFO };
+            get.action = trigger;
+            get.subactionPath = hands[1];
+            XrActionStateFloat state = { XR_TYPE_ACTION_STATE_FLOAT };
+            xrGetActionStateFloat(session, &get, &state);
+            CHECK(state.isActive);
+            if (state.currentState != run.right_trigger) run.trigger_changed = state.lastChangeTime;
+            run.right_trigger = state.currentState;
+        }
+
+        XrCompositionLayerProjectionView views[2] = { { XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW }, { XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW } };
+        XrCompositionLayerProjection layer = { XR_TYPE_COMPOSITION_LAYER_PROJECTION };
+        const XrCompositionLayerBaseHeader* layers[1] = { (XrCompositionLayerBaseHeader*)&layer };
+        XrFrameEndInfo end = { XR_TYPE_FRAME_END_INFO };
+        end.displayTime = frame.predictedDisplayTime;
+        if (frame.shouldRender) {
+            uint32_t index = 0;
+            XrSwapchainImageWaitInfo wait = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+            CHECK(xrAcquireSwapchainImage(swapchain, nullptr, &index) == XR_SUCCESS);
+            xrWaitSwapchainImage(swapchain, &wait);
+            if (!binding && index < image_count) {
+                uint8_t* pixels = images[index].pixels;
+                run.pixels_kept &= pixels[0] == written[index] && pixels[images[index].slice_pitch - 1] == written[index];
+                written[index] = (uint8_t)(run.rendered + 1);
+                std::memset(pixels, written[index], images[index].slice_pitch);
+            }
+            xrReleaseSwapchainImage(swapchain, nullptr);
+            for (auto& v : views) v.subImage.swapchain = swapchain;
+            layer.viewCount = 2;
+            layer.views = views;
+            end.layerCount = 1;
+            end.layers = layers;
+            run.rendered++;
+        }
+        else {
+            run.hidden++;
+        }
+        CHECK(xrEndFrame(session, &end) == XR_SUCCESS);
+    }
+
+    run.stats = mock_xr_stats();
+    xrDestroySwapchain(swapchain);
+    xrDestroySession(session);
+    xrDestroyInstance(instance);
+    return run;
+}
+
+static mock_xr_config_t ScriptedConfig() {
+    // 2 ms frames; the headset comes off at frame 10 for 20 ms, the session ends after 60 frames.
+    // The right trigger is pulled 50 ms in.
+    mock_xr_config_t config;
+    config.display_period_ns = 2000000;
+    config.exit_after_frames = 60;
+    config.hide_at_frame = 10;
+    config.hide_ms = 20;
+    config.width = config.height = kSize;
+    config.input = [](const std::string& path, double seconds) {
+        const bool pulled = path == "/user/hand/right/input/trigger/value" && seconds >= 0.05;
+        return XrVector2f{ pulled ? 1.0f : 0.0f, 0.0f };
+    };
+    return config;
+}
+
+static void CheckScripted(const SessionRun& run, const mock_xr_config_t& config) {
+    // The scripted lifecycle, in order
+    const XrSessionState expected[] = {
+        XR_SESSION_STATE_IDLE, XR_SESSION_STATE_READY, XR_SESSION_STATE_SYNCHRONIZED, XR_SESSION_STATE_VISIBLE,
+        XR_SESSION_STATE_FOCUSED,
+    };
+    CHECK(run.states.size() >= 5);
+    for (size_t i = 0; i < 5 && i < run.states.size(); i++)
+        CHECK(run.states[i] == expected[i]);
+    CHECK(run.exiting);
+    CHECK(run.states.size() >= 2 && run.states[run.states.size() - 2] == XR_SESSION_STATE_IDLE);
+
+    CHECK_EQ(run.stats.frames_ended, run.rendered + run.hidden);
+    CHECK(run.stats.frames_ended >= config.exit_after_frames);
+    CHECK_EQ(run.stats.projection_layers, run.rendered);
+    CHECK_EQ(run.stats.images_released, run.rendered);
+    CHECK_EQ(run.stats.quad_layers, 0);
+    CHECK(run.hidden > 0);                         // the headset-off stretch submitted no layers
+    CHECK_EQ(run.right_trigger, 1.0f);
+    CHECK(run.trigger_changed > 0);
+}
+
+static void Headless() {
+    const mock_xr_config_t config = ScriptedConfig();
+    mock_xr_configure(config);
+    const SessionRun run = RunSession(nullptr);
+    CheckScripted(run, config);
+    CHECK(run.pixels_kept);
+
+    // Formats the mock cannot back with 4-byte pixels are refused
+    XrInstanceCreateInfo instance_info = { XR_TYPE_INSTANCE_CREATE_INFO };
+    XrInstance instance = XR_NULL_HANDLE;
+    xrCreateInstance(&instance_info, &instance);
+    XrSessionCreateInfo session_info = { XR_TYPE_SESSION_CREATE_INFO };
+    XrSession session = XR_NULL_HANDLE;
+    CHECK(xrCreateSession(instance, &session_info, &session) == XR_SUCCESS);
+    XrSwapchainCreateInfo sc_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
+    sc_info.format = 40;   // DXGI_FORMAT_D32_FLOAT
+    sc_info.width = sc_info.height = kSize;
+    sc_info.arraySize = sc_info.mipCount = sc_info.faceCount = sc_info.sampleCount = 1;
+    XrSwapchain swapchain = XR_NULL_HANDLE;
+    CHECK(xrCreateSwapchain(session, &sc_info, &swapchain) == XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED);
+    xrDestroySession(session);
+    xrDestroyInstance(instance);
+}
+
+// The loop's own cost per frame: no display period to wait for, one image written per frame
+static void Unthrottled() {
+    mock_xr_config_t config;
+    config.throttle = false;
+    config.exit_after_frames = 5000;
+    config.width = config.height = kSize;
+    mock_xr_configure(config);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const SessionRun run = RunSession(nullptr);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    CHECK(run.exiting);
+    CHECK(run.pixels_kept);
+    CHECK(run.stats.frames_ended >= config.exit_after_frames);
+    CHECK_EQ(run.stats.images_released, run.rendered);
+    std::printf("unthrottled headless: %u frames, %.2f us per frame\n", run.rendered, seconds * 1e6 / (run.rendered ? run.rendered : 1));
+}
+
+#ifdef _WIN32
+static void D3D11() {
+    ID3D11Device* device = nullptr;
+    CHECK(SUCCEEDED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, &device, nullptr, nullptr)));
+    if (!device) return;
+
+    const mock_xr_config_t config = ScriptedConfig();
+    mock_xr_configure(config);
+    XrGraphicsBindingD3D11KHR binding = { XR_TYPE_GRAPHICS_BINDING_D3D11_KHR };
+    binding.device = device;
+    CheckScripted(RunSession(&binding), config);
+    device->Release();
+}
+#endif
+
+int main() {
+    Headless();
+    Unthrottled();
+#ifdef _WIN32
+    D3D11();
+#endif
+    return ve_test_result("mock_openxr_test");
+}
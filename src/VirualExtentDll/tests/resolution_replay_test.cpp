@@ -0,0 +1,67 @@
+#include "resolution_controller.h"
+#include "check.h"
+
+#include <cmath>
+#include <vector>
+
+// Recorded-style traces of full-resolution frame cost (ms) replayed through the controller at a
+// 90 Hz budget: it has to get a heavy scene back under budget, give resolution back when the
+// scene gets light again, and not flap on noise inside its band.
+
+static const float kBudgetMs = 11.1f;
+
+// Deterministic jitter of +-amp
+static float Jitter(size_t i, float amp) {
+    return amp * (float)std::sin((double)i * 12.9898);
+}
+
+static uint32_t ScaleChanges(const std::vector<float>& scale) {
+    uint32_t n = 0;
+    for (size_t i = 1; i < scale.size(); i++)
+        if (scale[i] != scale[i - 1]) n++;
+    return n;
+}
+
+static void LightSceneStaysFull() {
+    std::vector<float> trace(2000), scale(trace.size());
+    for (size_t i = 0; i < trace.size(); i++)
+        trace[i] = 6.0f + Jitter(i, 0.5f);
+    const size_t over = resolution_replay(ResolutionConfig(), trace.data(), trace.size(), kBudgetMs, scale.data());
+    CHECK_EQ(over, 0);
+    CHECK_EQ(ScaleChanges(scale), 0);
+    CHECK(scale.back() == 1.0f);
+}
+
+static void HeavySceneShrinksThenRecovers() {
+    // 500 light frames, 1500 at 1.6x the budget, 1000 light again
+    std::vector<float> trace(3000), scale(trace.size());
+    for (size_t i = 0; i < trace.size(); i++)
+        trace[i] = (i >= 500 && i < 2000 ? 17.8f : 6.0f) + Jitter(i, 0.6f);
+    const size_t over = resolution_replay(ResolutionConfig(), trace.data(), trace.size(), kBudgetMs, scale.data());
+
+    // Over budget only while it reacts: a few holds' worth, not the whole heavy stretch
+    CHECK(over < 300);
+    // Settled inside the band during the heavy stretch
+    const float settled = scale[1999];
+    CHECK(settled < 0.85f && settled >= ResolutionConfig().minScale);
+    CHECK(trace[1999] * settled * settled <= kBudgetMs * ResolutionConfig().shrinkAbove + 1.0f);
+    // And back at full resolution once the scene is light again
+    CHECK(scale.back() == 1.0f);
+    CHECK(ScaleChanges(scale) < 20);
+}
+
+static void NoiseInsideTheBandIsIgnored() {
+    // Hovers around the target with +-10% noise: the band and hold keep it from reacting
+    std::vector<float> trace(3000), scale(trace.size());
+    for (size_t i = 0; i < trace.size(); i++)
+        trace[i] = kBudgetMs * 0.85f * (1.0f + Jitter(i, 0.10f));
+    resolution_replay(ResolutionConfig(), trace.data(), trace.size(), kBudgetMs, scale.data());
+    CHECK_EQ(ScaleChanges(scale), 0);
+}
+
+int main() {
+    LightSceneStaysFull();
+    HeavySceneShrinksThenRecovers();
+    NoiseInsideTheBandIsIgnored();
+    return ve_test_result("resolution_replay_test");
+}
@@ -0,0 +1,149 @@
+#include "shader_cache.h"
+#include "check.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// The runtime fallback's cache: a hit skips the compiler, anything that changes the output
+// changes the key, and a damaged file is recompiled and rewritten. The compiler is a stub that
+// counts its calls and "compiles" to the request's text.
+
+static int g_compiles = 0;
+
+static bool StubCompile(const ShaderCache::Request& r, std::vector<uint8_t>* out) {
+    g_compiles++;
+    const std::string text = std::string(r.source) + "|" + r.entry + "|" + r.target + "|" + r.defines;
+    out->assign(text.begin(), text.end());
+    return true;
+}
+
+static std::filesystem::path TempDir() {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "ve_shader_cache_test";
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+static void HitAndMiss() {
+    const std::filesystem::path dir = TempDir();
+    ShaderCache cache;
+    cache.SetDirectory(dir.string());
+    cache.SetCompilerId("d3dcompiler_47");
+
+    ShaderCache::Request r = { "float4 vs() : SV_POSITION { return 0; }", "vs", "vs_5_0", "", 0x800 };
+    std::vector<uint8_t> first, second;
+    g_compiles = 0;
+    CHECK(cache.Get(r, StubCompile, &first));
+    CHECK(cache.Get(r, StubCompile, &second));
+    CHECK_EQ(g_compiles, 1);
+    CHECK(first == second);
+    CHECK_EQ(cache.GetStats().hits, 1);
+    CHECK_EQ(cache.GetStats().misses, 1);
+    CHECK_EQ(cache.GetStats().stores, 1);
+    CHECK(std::filesystem::exists(cache.PathFor(cache.Key(r))));
+
+    // A second instance (the next injection) reads what the first stored
+    ShaderCache next;
+    next.SetDirectory(dir.string());
+    next.SetCompilerId("d3dcompiler_47");
+    CHECK(next.Get(r, StubCompile, &second));
+    CHECK_EQ(g_compiles, 1);
+    CHECK(first == second);
+
+    // No directory: no caching
+    ShaderCache none;
+    CHECK(none.Get(r, StubCompile, &second));
+    CHECK(none.Get(r, StubCompile, &second));
+    CHECK_EQ(g_compiles, 3);
+    std::filesystem::remove_all(dir);
+}
+
+static void KeyInvalidation() {
+    ShaderCache cache;
+    cache.SetCompilerId("d3dcompiler_47");
+    const ShaderCache::Request base = { "float4 vs() : SV_POSITION { return 0; }", "vs", "vs_5_0", "", 0x800 };
+    const uint64_t key = cache.Key(base);
+    CHECK_EQ(cache.Key(base), key);
+
+    ShaderCache::Request r = base;
+    r.source = "float4 vs() : SV_POSITION { return 1; }";
+    CHECK(cache.Key(r) != key);
+    r = base;
+    r.entry = "ps";
+    CHECK(cache.Key(r) != key);
+    r = base;
+    r.target = "vs_4_0";
+    CHECK(cache.Key(r) != key);
+    r = base;
+    r.defines = "VE_STEREO=1;";   // the stereo variant
+    CHECK(cache.Key(r) != key);
+    r = base;
+    r.flags = 0x800 | 0x4;        // a debug build's flags
+    CHECK(cache.Key(r) != key);
+
+    // A new compiler invalidates every entry
+    ShaderCache newer;
+    newer.SetCompilerId("d3dcompiler_48");
+    CHECK(newer.Key(base) != key);
+
+    // Fields are hashed with their terminators: moving text between them changes the key
+    ShaderCache::Request a = base, b = base;
+    a.entry = "vs";  a.target = "_5_0";
+    b.entry = "vs_"; b.target = "5_0";
+    CHECK(cache.Key(a) != cache.Key(b));
+}
+
+static void Corrupted() {
+    const std::filesystem::path dir = TempDir();
+    ShaderCache cache;
+    cache.SetDirectory(dir.string());
+    const ShaderCache::Request r = { "float4 ps() : SV_TARGET { return 1; }", "ps", "ps_5_0", "", 0 };
+    std::vector<uint8_t> good, out;
+    g_compiles = 0;
+    CHECK(cache.Get(r, StubCompile, &good));
+
+    // Flip a byte of the bytecode: the checksum no longer matches
+    const std::string path = cache.PathFor(cache.Key(r));
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('#');
+    }
+    CHECK(cache.Get(r, StubCompile, &out));
+    CHECK_EQ(g_compiles, 2);
+    CHECK_EQ(cache.GetStats().invalid, 1);
+    CHECK_EQ(cache.GetStats().stores, 2);
+    CHECK(out == good);
+
+    // Rewritten: the next lookup hits
+    CHECK(cache.Get(r, StubCompile, &out));
+    CHECK_EQ(g_compiles, 2);
+    CHECK(out == good);
+
+    // Truncated to half a header
+    std::filesystem::resize_file(path, 8);
+    CHECK(cache.Get(r, StubCompile, &out));
+    CHECK_EQ(g_compiles, 3);
+    CHECK_EQ(cache.GetStats().invalid, 2);
+    CHECK(out == good);
+    std::filesystem::remove_all(dir);
+}
+
+static void CompileFailure() {
+    ShaderCache cache;
+    cache.SetDirectory(TempDir().string());
+    const ShaderCache::Request r = { "syntax error", "vs", "vs_5_0", "", 0 };
+    std::vector<uint8_t> out;
+    CHECK(!cache.Get(r, [](const ShaderCache::Request&, std::vector<uint8_t>*) { return false; }, &out));
+    CHECK_EQ(cache.GetStats().stores, 0);
+    CHECK(!std::filesystem::exists(cache.PathFor(cache.Key(r))));
+    std::filesystem::remove_all(TempDir());
+}
+
+int main() {
+    HitAndMiss();
+    KeyInvalidation();
+    Corrupted();
+    CompileFailure();
+    return ve_test_result("shader_cache_test");
+}
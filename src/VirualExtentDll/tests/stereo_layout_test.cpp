@@ -0,0 +1,115 @@
+#include "stereo_layout.h"
+#include "check.h"
+
+#include <vector>
+
+// Renders a frame of the DLL's draw list (desktop plane, cubes, instanced controller parts)
+// against a recording backend, per eye and in single pass, and checks that every instance of
+// every object reaches every view exactly once.
+
+struct Draw {
+    uint32_t object;
+    uint32_t instances;   // as submitted, after StereoDrawInstances
+    uint32_t passFirstView;
+    uint32_t passViews;
+};
+
+// Stands in for the context: only records what would be submitted
+struct RecordingBackend {
+    std::vector<Draw> draws;
+    uint32_t passes = 0;
+    uint32_t firstView = 0, views = 1;
+
+    void BeginPass(uint32_t first, uint32_t count) { passes++; firstView = first; views = count; }
+    // d3d_draw_indexed / d3d_draw_indexed_instanced
+    void DrawInstanced(uint32_t object, uint32_t instances) {
+        draws.push_back({ object, StereoDrawInstances(instances, views), firstView, views });
+    }
+};
+
+// What app_draw issues per pass: object id and instances of the geometry
+struct SceneObject { uint32_t id, instances; };
+static const SceneObject kScene[] = {
+    { 0, 1 },                                                   // desktop plane
+    { 1, 1 }, { 2, 1 }, { 3, 1 }, { 4, 1 },                     // cubes
+    { 5, 6 },                                                   // controller parts, one instanced draw
+};
+static const uint32_t kObjects = 6, kMaxInstances = 6;
+
+static RecordingBackend RenderFrame(const StereoLayout& layout) {
+    RecordingBackend b;
+    for (uint32_t p = 0; p < layout.PassCount(); p++) {
+        b.BeginPass(layout.PassFirstView(p), layout.PassViewCount());
+        for (const SceneObject& o : kScene)
+            b.DrawInstanced(o.id, o.instances);
+    }
+    return b;
+}
+
+// Runs the vertex shader's instance split over every recorded draw
+static bool EveryInstanceOncePerView(const RecordingBackend& b, uint32_t viewCount) {
+    std::vector<uint32_t> seen(kObjects * kMaxInstances * viewCount, 0);
+    for (const Draw& d : b.draws) {
+        for (uint32_t sv = 0; sv < d.instances; sv++) {
+            const StereoInstance si = StereoSplitInstance(sv, d.passViews);
+            const uint32_t view = d.passFirstView + si.eye;
+            if (view >= viewCount || si.instance >= kMaxInstances) return false;
+            seen[(d.object * kMaxInstances + si.instance) * viewCount + view]++;
+        }
+    }
+    for (const SceneObject& o : kScene)
+        for (uint32_t i = 0; i < kMaxInstances; i++)
+            for (uint32_t v = 0; v < viewCount; v++)
+                if (seen[(o.id * kMaxInstances + i) * viewCount + v] != (i < o.instances ? 1u : 0u))
+                    return false;
+    return true;
+}
+
+static void Plan() {
+    const uint32_t same[2] = { 1832, 1832 }, h[2] = { 1920, 1920 }, other[2] = { 1832, 1840 };
+
+    StereoLayout l = StereoPlan(true, true, 2, same, h);
+    CHECK(l.singlePass);
+    CHECK_EQ(l.swapchainCount, 1);
+    CHECK_EQ(l.arraySize, 2);
+    CHECK_EQ(l.PassCount(), 1);
+    CHECK_EQ(l.ViewSwapchain(1), 0);
+    CHECK_EQ(l.ViewArrayIndex(1), 1);
+
+    // Falls back to a pass per eye without the feature, with different sizes or when not wanted
+    CHECK(!StereoPlan(true, false, 2, same, h).singlePass);
+    CHECK(!StereoPlan(true, true, 2, other, h).singlePass);
+    CHECK(!StereoPlan(false, true, 2, same, h).singlePass);
+    l = StereoPlan(true, false, 2, same, h);
+    CHECK_EQ(l.swapchainCount, 2);
+    CHECK_EQ(l.arraySize, 1);
+    CHECK_EQ(l.PassCount(), 2);
+    CHECK_EQ(l.ViewSwapchain(1), 1);
+    CHECK_EQ(l.ViewArrayIndex(1), 0);
+
+    // A mono view configuration never goes single pass
+    CHECK(!StereoPlan(true, true, 1, same, h).singlePass);
+}
+
+static void DrawList() {
+    const uint32_t w[2] = { 1832, 1832 }, h[2] = { 1920, 1920 };
+    const uint32_t perPass = sizeof(kScene) / sizeof(kScene[0]);
+
+    const RecordingBackend multi = RenderFrame(StereoPlan(false, true, 2, w, h));
+    CHECK_EQ(multi.passes, 2);
+    CHECK_EQ(multi.draws.size(), 2 * perPass);
+    CHECK(EveryInstanceOncePerView(multi, 2));
+
+    // Half the submissions for the same coverage
+    const RecordingBackend single = RenderFrame(StereoPlan(true, true, 2, w, h));
+    CHECK_EQ(single.passes, 1);
+    CHECK_EQ(single.draws.size(), perPass);
+    CHECK(EveryInstanceOncePerView(single, 2));
+    CHECK_EQ(single.draws.back().instances, 12);   // 6 controller parts x 2 views
+}
+
+int main() {
+    Plan();
+    DrawList();
+    return ve_test_result("stereo_layout_test");
+}
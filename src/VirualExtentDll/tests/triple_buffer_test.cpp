@@ -0,0 +1,84 @@
+#include "triple_buffer.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// A slot is only consistent if every word carries the same sequence number: a torn read
+// (the producer writing the slot the consumer holds) shows up as a mismatch.
+struct Frame {
+    uint64_t seq;
+    uint64_t words[15];
+};
+
+static void HandOver() {
+    TripleBuffer<int> tb;
+    tb.Reset();
+
+    CHECK(!tb.Update());                 // nothing published yet
+
+    tb.WriteSlot() = 1;
+    tb.Publish();
+    CHECK(tb.Update());
+    CHECK_EQ(tb.ReadSlot(), 1);
+    CHECK(!tb.Update());                 // same slot, not fresh again
+    CHECK_EQ(tb.ReadSlot(), 1);
+
+    // Unread publishes are replaced: only the newest one is seen
+    tb.WriteSlot() = 2;
+    tb.Publish();
+    tb.WriteSlot() = 3;
+    tb.Publish();
+    CHECK(tb.Update());
+    CHECK_EQ(tb.ReadSlot(), 3);
+
+    // The three sides always own three different slots
+    CHECK(tb.WriteIndex() != tb.ReadIndex());
+}
+
+static void Stress() {
+    static TripleBuffer<Frame> tb;
+    tb.Reset();
+    const uint64_t kFrames = 200000;
+    std::atomic<bool> done = false;
+
+    std::thread producer([&] {
+        for (uint64_t seq = 1; seq <= kFrames; seq++) {
+            Frame& f = tb.WriteSlot();
+            f.seq = seq;
+            for (uint64_t& w : f.words) w = seq;
+            tb.Publish();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint64_t last = 0, seen = 0, torn = 0, backwards = 0;
+    for (;;) {
+        const bool finished = done.load(std::memory_order_acquire);
+        if (tb.Update()) {
+            const Frame& f = tb.ReadSlot();
+            for (uint64_t w : f.words)
+                if (w != f.seq) { torn++; break; }
+            if (f.seq <= last) backwards++;
+            last = f.seq;
+            seen++;
+        }
+        else if (finished) {
+            break;                       // the last publish happened before done was set
+        }
+    }
+    producer.join();
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(backwards, 0);
+    CHECK_EQ(last, kFrames);             // the final publish is always picked up
+    CHECK(seen > 0);
+    std::printf("stress: %llu of %llu frames seen\n", (unsigned long long)seen, (unsigned long long)kFrames);
+}
+
+int main() {
+    HandOver();
+    Stress();
+    return ve_test_result("triple_buffer_test");
+}
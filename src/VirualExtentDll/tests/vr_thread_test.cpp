@@ -0,0 +1,112 @@
+#include "vr_thread.h"
+#include "check.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// VrThread with stub bodies in place of ve_run: one body at a time whether started async
+// (VE_StartAsync) or run on the caller (VE_Start), Stop() ends either, restarts work.
+
+// A body that idles until stopped, like ve_run without a session: the wake callback stands in
+// for IdleWaiter::Notify
+struct IdleBody {
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    started = false;
+    int                     runs = 0;
+    int                     wakes = 0;
+
+    VrThread::Body Body(int exitCode) {
+        return [this, exitCode](const std::atomic<bool>& stop) {
+            std::unique_lock<std::mutex> lk(mutex);
+            started = true;
+            runs++;
+            cv.notify_all();
+            while (!stop.load(std::memory_order_acquire))
+                cv.wait(lk);
+            return exitCode;
+        };
+    }
+    VrThread::Wake Wake() {
+        return [this] {
+            std::lock_guard<std::mutex> lk(mutex);
+            wakes++;
+            cv.notify_all();
+        };
+    }
+    void WaitStarted() {
+        std::unique_lock<std::mutex> lk(mutex);
+        cv.wait(lk, [this] { return started; });
+        started = false;
+    }
+};
+
+static void StartStop() {
+    VrThread t;
+    CHECK_EQ(t.Stop(), -1);   // nothing started
+
+    IdleBody idle;
+    CHECK(t.Start(idle.Body(7), idle.Wake()));
+    idle.WaitStarted();
+    CHECK(t.Running());
+    CHECK(!t.Start(idle.Body(8), idle.Wake()));   // VE_StartAsync twice
+    CHECK_EQ(t.Stop(), 7);
+    CHECK(!t.Running());
+    CHECK_EQ(idle.wakes, 1);
+    CHECK_EQ(t.Stop(), -1);   // already stopped
+
+    // Restart after a stop
+    CHECK(t.Start(idle.Body(9), idle.Wake()));
+    idle.WaitStarted();
+    CHECK_EQ(t.Stop(), 9);
+    CHECK_EQ(idle.runs, 2);
+}
+
+static void ReturnsOnItsOwn() {
+    VrThread t;
+    CHECK(t.Start([](const std::atomic<bool>&) { return 3; }, nullptr));
+    while (t.Running())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(!t.StopRequested());
+    // The finished thread is joined by the next Start
+    CHECK(t.Start([](const std::atomic<bool>&) { return 4; }, nullptr));
+    CHECK_EQ(t.Stop(), 4);
+}
+
+static void RunOnCaller() {
+    VrThread t;
+    int code = 0;
+    CHECK(t.Run([](const std::atomic<bool>&) { return 5; }, nullptr, &code));
+    CHECK_EQ(code, 5);
+    CHECK(!t.Running());
+    CHECK_EQ(t.Stop(), -1);
+
+    // VE_Start while VE_StartAsync's loop runs: rejected, body not run
+    IdleBody idle;
+    CHECK(t.Start(idle.Body(1), idle.Wake()));
+    idle.WaitStarted();
+    bool ran = false;
+    CHECK(!t.Run([&ran](const std::atomic<bool>&) { ran = true; return 0; }, nullptr, &code));
+    CHECK(!ran);
+    CHECK_EQ(t.Stop(), 1);
+
+    // VE_StartAsync while VE_Start's loop runs: rejected; VE_Stop from another thread ends it
+    std::thread caller([&] { CHECK(t.Run(idle.Body(6), idle.Wake(), &code)); });
+    idle.WaitStarted();
+    CHECK(t.Running());
+    CHECK(!t.Start(idle.Body(2), idle.Wake()));
+    CHECK_EQ(t.Stop(), 6);
+    caller.join();
+    CHECK_EQ(code, 6);
+    CHECK(!t.Running());
+    CHECK_EQ(idle.runs, 2);
+}
+
+int main() {
+    StartStop();
+    ReturnsOnItsOwn();
+    RunOnCaller();
+    return ve_test_result("vr_thread_test");
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer.
+//
+// The producer always owns one slot to write into, the consumer always owns one slot to
+// read from, and the third slot is the hand-over point between them. Publish() and Update()
+// never block, and the consumer is never handed a slot the producer is still writing.
+// Only the newest published slot is ever seen; older unread publishes are simply replaced.
+//
+// No platform dependencies so it can be reused for anything that hands "latest state"
+// from one thread to another (desktop frames, input snapshots, ...).
+template <typename T>
+class TripleBuffer {
+public:
+    // ---- Producer side ----
+
+    // Slot the producer may freely write into until the next Publish().
+    T&  WriteSlot() { return slots_[back_]; }
+    int WriteIndex() const { return back_; }
+
+    // Hand the write slot to the consumer and take the hand-over slot back for writing.
+    void Publish() {
+        uint8_t prev = middle_.exchange(uint8_t(back_ | kFreshBit), std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+    }
+
+    // ---- Consumer side ----
+
+    // Picks up the newest published slot. Returns true if it changed since the last call.
+    bool Update() {
+        if ((middle_.load(std::memory_order_acquire) & kFreshBit) == 0)
+            return false;
+        uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+
+    const T& ReadSlot() const { return slots_[front_]; }
+    T&       ReadSlot() { return slots_[front_]; }
+    int      ReadIndex() const { return front_; }
+
+    // ---- Setup / teardown (only while neither side is running) ----
+
+    T& Slot(int i) { return slots_[i]; }
+
+    void Reset() {
+        back_ = 0;
+        middle_.store(1, std::memory_order_relaxed);
+        front_ = 2;
+    }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFreshBit = 0x4;
+
+    T slots_[3]{};
+
+    // Keep the producer's, the shared and the consumer's index on separate cache lines.
+    alignas(64) uint8_t              back_ = 0;
+    alignas(64) std::atomic<uint8_t> middle_{ 1 };
+    alignas(64) uint8_t              front_ = 2;
+};
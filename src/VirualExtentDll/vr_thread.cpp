@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "vr_thread.h"
+
+bool VrThread::Start(Body body, Wake wake) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (running_.load(std::memory_order_acquire))
+        return false;
+    if (thread_.joinable())  // a previous body returned on its own
+        thread_.join();
+
+    wake_ = std::move(wake);
+    stop_.store(false, std::memory_order_release);
+    running_.store(true, std::memory_order_release);
+    exitCode_ = -1;
+    thread_ = std::thread([this, body = std::move(body)] {
+        exitCode_ = body(stop_);
+        running_.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+bool VrThread::Run(Body body, Wake wake, int* exitCode) {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (running_.load(std::memory_order_acquire))
+            return false;
+        if (thread_.joinable())
+            thread_.join();
+
+        wake_ = std::move(wake);
+        stop_.store(false, std::memory_order_release);
+        running_.store(true, std::memory_order_release);
+        runningHere_ = true;
+        exitCode_ = -1;
+    }
+    const int code = body(stop_);
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        exitCode_ = code;
+        runningHere_ = false;
+        running_.store(false, std::memory_order_release);
+        wake_ = nullptr;
+    }
+    ranDone_.notify_all();
+    if (exitCode)
+        *exitCode = code;
+    return true;
+}
+
+int VrThread::Stop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (runningHere_) {
+        // Run()'s caller owns that body: wait for it to return
+        stop_.store(true, std::memory_order_release);
+        if (wake_)
+            wake_();
+        ranDone_.wait(lk, [this] { return !runningHere_; });
+        return exitCode_;
+    }
+    if (!thread_.joinable())
+        return -1;
+
+    stop_.store(true, std::memory_order_release);
+    if (wake_)
+        wake_();
+    thread_.join();
+    wake_ = nullptr;
+    return exitCode_;
+}
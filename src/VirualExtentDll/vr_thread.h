@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Owns the thread the VR loop runs on, so the thread that injects/loads the dll returns at once.
+//
+// Start() runs the body (init, frame loop, shutdown) on a new thread; the body polls the stop
+// flag between iterations. Stop() sets the flag, calls the wake callback so a body blocked while
+// idle notices it, and joins. The body may also return on its own (the runtime ended the
+// session); the thread is then finished but still owned until Stop() or the next Start().
+// Run() is the blocking form: the body runs on the caller's thread under the same guard, so
+// only one body runs at a time whichever way it was started, and Stop() ends either.
+// Plain std::thread, so the lifecycle can be exercised with a stub body.
+class VrThread {
+public:
+    using Body = std::function<int(const std::atomic<bool>& stopRequested)>;
+    using Wake = std::function<void()>;
+
+    // Never joins: a global one is destroyed under the loader lock. Stop() before unloading.
+    ~VrThread() { if (thread_.joinable()) thread_.detach(); }
+
+    // False if a body is still running
+    bool Start(Body body, Wake wake);
+    // Runs the body on the calling thread; false (body not run) if one is already running
+    bool Run(Body body, Wake wake, int* exitCode);
+    // Requests a stop and waits for the body to return. Its exit code, or -1 if none was started.
+    int  Stop();
+
+    bool Running() const { return running_.load(std::memory_order_acquire); }
+    bool StopRequested() const { return stop_.load(std::memory_order_acquire); }
+
+private:
+    std::mutex        mutex_;    // serialises Start/Run/Stop callers
+    std::condition_variable ranDone_;
+    std::thread       thread_;
+    bool              runningHere_ = false;  // a Run() body, on its caller's thread
+    Wake              wake_;
+    std::atomic<bool> stop_ = false;
+    std::atomic<bool> running_ = false;
+    int               exitCode_ = -1;
+};